@@ -22,6 +22,21 @@
 extern "C" {
 #endif
 
+/** @brief Header of a memory block, which precedes the context data. */
+struct bt_conn_ctx_block_hdr {
+	/** Number of references to the context data. The connection holds
+	  * one reference until the context is freed, and each user holds one
+	  * until it releases the context. */
+	atomic_t ref;
+};
+
+/**@brief Helping macro for @ref BT_CONN_CTX_DEF, that gives the size of
+ *        the memory block header.
+ */
+#define _BT_CONN_CTX_BLOCK_HDR_SIZE                                            \
+	ROUND_UP(sizeof(struct bt_conn_ctx_block_hdr),                         \
+		 CONFIG_BT_CONN_CTX_MEM_BUF_ALIGN)
+
 /**@brief Macro for defining a Bluetooth connection context library instance.
  *
  * @param  _name	Name of the instance.
@@ -30,6 +45,7 @@ extern "C" {
  */
 #define BT_CONN_CTX_DEF(_name, _max_clients, _ctx_sz)                          \
 	K_MEM_SLAB_DEFINE(_name##_mem_slab,                                    \
+			  _BT_CONN_CTX_BLOCK_HDR_SIZE +                        \
 			  ROUND_UP(_ctx_sz, CONFIG_BT_CONN_CTX_MEM_BUF_ALIGN), \
 			  (_max_clients),                                      \
 			  CONFIG_BT_CONN_CTX_MEM_BUF_ALIGN);                   \
@@ -51,11 +67,12 @@ struct bt_conn_ctx {
 
 /** @brief Bluetooth connection context library structure. */
 struct bt_conn_ctx_lib {
-	/** Connection contexts. */
+	/** Connection contexts, indexed by bt_conn_index(). */
 	struct bt_conn_ctx ctx[CONFIG_BT_MAX_CONN];
 
-	/** Context data mutex that ensures that only one connection context is
-	  * manipulated at a time. */
+	/** Context data mutex. The library does not take it, as contexts
+	  * are reference counted. Users take it around every access to context
+	  * data that can be changed from more than one thread. */
 	struct k_mutex * const mutex;
 
 	/** Memory slab instance where the memory is allocated. */
@@ -67,11 +84,11 @@ struct bt_conn_ctx_lib {
  *
  * @param ctx_lib	Bluetooth connection context library instance.
  *
- * @return Block size in bytes.
+ * @return Size of the context data of a connection in bytes.
  */
 static inline size_t bt_conn_ctx_block_size_get(struct bt_conn_ctx_lib *ctx_lib)
 {
-	return ctx_lib->mem_slab->block_size;
+	return ctx_lib->mem_slab->block_size - _BT_CONN_CTX_BLOCK_HDR_SIZE;
 }
 
 /**
@@ -105,6 +122,10 @@ void *bt_conn_ctx_alloc(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn);
 /**
  * @brief Free the allocated memory for a connection.
  *
+ * The context of the connection is detached at once, so a new connection
+ * with the same index can allocate its context right away. The memory is
+ * returned to the pool when the last user of the old context releases it.
+ *
  * @param ctx_lib	Bluetooth connection context library instance.
  * @param conn		Bluetooth connection.
  *
@@ -124,7 +145,11 @@ void bt_conn_ctx_free_all(struct bt_conn_ctx_lib *ctx_lib);
  * @brief Get the context data of a connection from the memory pool.
  *
  * This function finds a connection's context data in the memory pool.
- * The link to find is identified by the connection object.
+ * The link to find is identified by the connection object, whose
+ * index gives the context directly. No lock is taken, so contexts of
+ * different connections can be used at the same time. The context is
+ * referenced until it is released, so that its data stays valid even if
+ * the connection context is freed in the meantime.
  *
  * This function should be used in conjunction with
  * @ref bt_conn_ctx_release to ensure proper operation.
@@ -144,17 +169,38 @@ void *bt_conn_ctx_get(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn);
  * object in the memory pool. The link to find is identified
  * by its index in the connection context array.
  *
+ * The connection context is copied to the caller, as the library reuses
+ * its own copy when the connection is freed and a new one gets the same
+ * index. The data of the copy stays valid until it is released, even if
+ * the connection is freed in the meantime.
+ *
  * This function should be used in conjunction with
  * @ref bt_conn_ctx_release to ensure proper operation.
  *
  * @param ctx_lib	Bluetooth connection context library instance.
- * @param conn		Bluetooth connection.
  * @param id		Connection context index.
+ * @param ctx		Connection context that is filled in.
  *
- * @return Pointer to the @ref bt_conn_ctx struct if the operation
- *         was successful. Otherwise NULL.
+ * @retval 0		If the operation was successful.
+ * @retval -ENOENT	If no context is allocated at the index.
+ */
+int bt_conn_ctx_get_by_id(struct bt_conn_ctx_lib *ctx_lib, u8_t id,
+			  struct bt_conn_ctx *ctx);
+
+/**
+ * @brief Call a function for each allocated connection context.
+ *
+ * Each context is referenced while the function is called for it,
+ * and the function gets a copy of the context.
+ *
+ * @param ctx_lib	Bluetooth connection context library instance.
+ * @param func		Function called for each connection context.
+ * @param user_data	Data passed to the function.
  */
-const struct bt_conn_ctx *bt_conn_ctx_get_by_id(struct bt_conn_ctx_lib *ctx_lib, u8_t id);
+void bt_conn_ctx_foreach(struct bt_conn_ctx_lib *ctx_lib,
+			 void (*func)(const struct bt_conn_ctx *ctx,
+				      void *user_data),
+			 void *user_data);
 
 /**
  * @brief Release a connection context from the memory pool.
@@ -14,6 +14,7 @@
  * @brief Module for GATT Discovery Manager.
  */
 
+#include <errno.h>
 #include <bluetooth/gatt.h>
 #include <bluetooth/uuid.h>
 
@@ -21,6 +22,9 @@
 extern "C" {
 #endif
 
+/** @brief Length of the peer database hash used as cache key. */
+#define BT_GATT_DM_DB_HASH_LEN 16
+
 /** @brief Discovery manager instance
  *
  * The instance of the manager used by most of the functions here.
@@ -247,9 +251,11 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
  * This function is asynchronous. Discovery results are passed through
  * the supplied callback.
  *
- * @note Only one discovery procedure can be started simultaneously. To start
- * another one, wait for the result of the previous procedure to finish
- * and call @ref bt_gatt_dm_data_release if it was successful.
+ * @note Only one discovery procedure can be started simultaneously on
+ * a connection, and at most CONFIG_BT_GATT_DM_MAX_INSTANCES procedures
+ * can run at the same time. To start another one, wait for the result of
+ * a previous procedure to finish and call @ref bt_gatt_dm_data_release
+ * if it was successful.
  *
  * @param[in]     conn Connection object.
  * @param[in]     svc_uuid UUID of target service
@@ -264,12 +270,74 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
  *
  * @retval 0 If the operation was successful.
  *           Otherwise, a (negative) error code is returned.
+ *           -EALREADY is returned if a discovery is already running
+ *           on this connection, and -ENOMEM if all instances are in use.
  */
 int bt_gatt_dm_start(struct bt_conn *conn,
 		     const struct bt_uuid *svc_uuid,
 		     const struct bt_gatt_dm_cb *cb,
 		     void *context);
 
+/** @brief Start service discovery using the discovery cache.
+ *
+ * This function works like @ref bt_gatt_dm_start, but first looks up
+ * the result of a previous discovery of the same service on the same peer.
+ * If the cache holds an entry for the peer identity address, @p svc_uuid,
+ * and @p db_hash, the attributes are restored from it and the completed
+ * callback is called from the system workqueue without any over-the-air
+ * traffic. Otherwise, the service is discovered and the result is stored
+ * in the cache.
+ *
+ * The cache is keyed by the peer identity address, so it is used only
+ * for bonded peers. For other peers, the service is discovered and the
+ * result is not stored. The cache is written to settings from the system
+ * workqueue. Clear the cache entries of a peer with
+ * @ref bt_gatt_dm_cache_clear when the bond is removed or the peer
+ * indicates a service change.
+ *
+ * @param[in]     conn Connection object.
+ * @param[in]     svc_uuid UUID of target service.
+ * @param[in]     db_hash Database hash of the peer,
+ *                @ref BT_GATT_DM_DB_HASH_LEN bytes long, or NULL if the
+ *                peer does not provide one.
+ * @param[in]     cb Callback structure.
+ * @param[in,out] context Context argument to be passed to
+ *                callback functions.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ *           -ENOTSUP is returned if CONFIG_BT_GATT_DM_CACHE is not set.
+ */
+#ifdef CONFIG_BT_GATT_DM_CACHE
+int bt_gatt_dm_start_cached(struct bt_conn *conn,
+			    const struct bt_uuid *svc_uuid,
+			    const u8_t *db_hash,
+			    const struct bt_gatt_dm_cb *cb,
+			    void *context);
+#else
+static inline int bt_gatt_dm_start_cached(struct bt_conn *conn,
+					  const struct bt_uuid *svc_uuid,
+					  const u8_t *db_hash,
+					  const struct bt_gatt_dm_cb *cb,
+					  void *context)
+{
+	return -ENOTSUP;
+}
+#endif
+
+/** @brief Remove cached discoveries.
+ *
+ * @param[in] addr Identity address of the peer whose entries are removed,
+ *                 or NULL to remove all entries.
+ */
+#ifdef CONFIG_BT_GATT_DM_CACHE
+void bt_gatt_dm_cache_clear(const bt_addr_le_t *addr);
+#else
+static inline void bt_gatt_dm_cache_clear(const bt_addr_le_t *addr)
+{
+}
+#endif
+
 /** @brief Continue service discovery.
  *
  * This function continues service discovery.
@@ -296,6 +364,16 @@ int bt_gatt_dm_continue(struct bt_gatt_dm *dm, void *context);
  */
 int bt_gatt_dm_data_release(struct bt_gatt_dm *dm);
 
+/** @brief Get the peak arena usage.
+ *
+ * The discovered UUIDs, service and characteristic values are stored in
+ * the arena of the instance, which is CONFIG_BT_GATT_DM_ARENA_SIZE bytes
+ * long. Use this function to tune the arena size.
+ *
+ * @return Highest number of arena bytes used by a discovery since boot.
+ */
+size_t bt_gatt_dm_arena_peak_get(void);
+
 /** @brief Print service discovery data.
  *
  * This function prints GATT attributes that belong to the discovered service.
@@ -135,6 +135,37 @@ void bt_gatt_pool_ccc_get(struct bt_gatt_service *svc,
 void bt_gatt_pool_ccc_put(struct bt_gatt_attr const *attr);
 
 #if CONFIG_BT_GATT_POOL_STATS != 0
+/** @brief Usage of one element pool. */
+struct bt_gatt_pool_usage {
+	/** Number of elements in the pool. */
+	u16_t size;
+	/** Number of elements currently taken. */
+	u16_t cnt;
+	/** Highest number of elements taken at the same time. */
+	u16_t peak;
+};
+
+/** @brief Usage of all element pools. */
+struct bt_gatt_pool_stats {
+	/** 16-bit UUID pool. */
+	struct bt_gatt_pool_usage uuid_16;
+	/** 32-bit UUID pool. */
+	struct bt_gatt_pool_usage uuid_32;
+	/** 128-bit UUID pool. */
+	struct bt_gatt_pool_usage uuid_128;
+	/** Characteristic descriptor pool. */
+	struct bt_gatt_pool_usage chrc;
+	/** CCC descriptor pool. */
+	struct bt_gatt_pool_usage ccc;
+};
+
+/** @brief Get the module statistics (containing pool size usage).
+ *
+ *  @param stats Structure to fill with the current and peak usage
+ *               of each pool.
+ */
+void bt_gatt_pool_stats_get(struct bt_gatt_pool_stats *stats);
+
 /** @brief Print basic module statistics (containing pool size usage).
  */
 void bt_gatt_pool_stats_print(void);
@@ -202,6 +202,70 @@ struct bt_scan_device_info {
 	const struct bt_le_conn_param *conn_param;
 };
 
+/**@brief Duplicate report cache statistics.
+ */
+struct bt_scan_dup_stats {
+	/** Number of reports dropped as duplicates. */
+	u32_t hit;
+
+	/** Number of reports forwarded. */
+	u32_t miss;
+
+	/** Number of cache entries replaced to make room for a new device. */
+	u32_t evicted;
+};
+
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+/**@brief Device table entry with aggregated advertising statistics.
+ */
+struct bt_scan_device_entry {
+	/** Device address. */
+	bt_addr_le_t addr;
+
+	/** Uptime in milliseconds when the device was first seen. */
+	u32_t first_seen;
+
+	/** Uptime in milliseconds when the device was last seen. */
+	u32_t last_seen;
+
+	/** Number of advertising reports received. */
+	u32_t report_cnt;
+
+	/** Sum of the RSSI of all reports, see @ref bt_scan_device_rssi_avg. */
+	s32_t rssi_sum;
+
+	/** Lowest RSSI in dBm. */
+	s8_t rssi_min;
+
+	/** Highest RSSI in dBm. */
+	s8_t rssi_max;
+
+	/** Advertising type of the last report. */
+	u8_t adv_type;
+
+	/** Length of the last advertising data. */
+	u8_t ad_len;
+
+	/** Last advertising data, truncated to
+	 *  CONFIG_BT_SCAN_DEVICE_TABLE_AD_MAX_LEN.
+	 */
+	u8_t ad[CONFIG_BT_SCAN_DEVICE_TABLE_AD_MAX_LEN];
+};
+
+/**@brief Function for getting the average RSSI of a device.
+ *
+ * @param[in] entry Device table entry.
+ *
+ * @return Average RSSI in dBm.
+ */
+static inline s8_t bt_scan_device_rssi_avg(
+		const struct bt_scan_device_entry *entry)
+{
+	return entry->report_cnt ? (entry->rssi_sum / (s32_t)entry->report_cnt)
+				 : 0;
+}
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
 /** @brief Scanning callback structure.
  *
  *  This structure is used for tracking the state of a scanning.
@@ -217,7 +281,10 @@ struct bt_scan_cb {
 	 *
 	 * @param[in] device_info Data needed to establish
 	 *                        connection and advertising information.
-	 * @param[in] filter_match Filter match status.
+	 * @param[in] filter_match Filter match status. In the normal filter
+	 *                         mode, evaluation stops at the first
+	 *                         matching filter, so only that filter is
+	 *                         reported.
 	 * @param[in] connectable Inform that device is connectable.
 	 */
 	void (*filter_match)(struct bt_scan_device_info *device_info,
@@ -252,6 +319,21 @@ struct bt_scan_cb {
 	void (*connecting)(struct bt_scan_device_info *device_info,
 			   struct bt_conn *conn);
 
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+	/**@brief Periodic device table snapshot.
+	 *
+	 * Called every CONFIG_BT_SCAN_DEVICE_TABLE_SNAPSHOT_INTERVAL
+	 * milliseconds from the system workqueue. The devices are a copy
+	 * of the table, taken before the call, so the table is not locked
+	 * and the callback can use the scanning API.
+	 *
+	 * @param[in] devices Tracked devices.
+	 * @param[in] cnt Number of tracked devices.
+	 */
+	void (*device_snapshot)(const struct bt_scan_device_entry *devices,
+				size_t cnt);
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
 	sys_snode_t node;
 };
 
@@ -360,6 +442,45 @@ void bt_scan_filter_remove_all(void);
 
 #endif /* CONFIG_BT_SCAN_FILTER_ENABLE */
 
+#if CONFIG_BT_SCAN_DUPLICATE_FILTER
+
+/**@brief Function for getting duplicate report cache statistics.
+ *
+ * @param[out] stats Pointer to the statistics structure.
+ */
+void bt_scan_dup_stats_get(struct bt_scan_dup_stats *stats);
+
+/**@brief Function for clearing the duplicate report cache.
+ *
+ * @details The function removes all cached devices and resets the
+ *          statistics. The next report of every device is forwarded.
+ */
+void bt_scan_dup_cache_clear(void);
+
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+
+/**@brief Function for iterating over the tracked devices.
+ *
+ * @details The table is locked while the function runs, so the callback
+ *          must not block.
+ *
+ * @param[in] func Callback called for each device. Return false to stop
+ *                 the iteration.
+ * @param[in] user_data Data passed to the callback.
+ */
+void bt_scan_device_table_foreach(
+		bool (*func)(const struct bt_scan_device_entry *entry,
+			     void *user_data),
+		void *user_data);
+
+/**@brief Function for removing all devices from the table.
+ */
+void bt_scan_device_table_clear(void);
+
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
 /**@brief Function for changing the scanning parameters.
  *
  * @details Use this function to change scanning parameters.
@@ -131,6 +131,19 @@ typedef void (*bt_gatt_hids_notif_handler_t) (enum bt_gatt_hids_notif_evt evt);
 typedef void (*bt_gatt_hids_rep_handler_t) (struct bt_gatt_hids_rep const *rep,
 					    struct bt_conn *conn);
 
+/** @brief Input Report merge function.
+ *
+ * Called when an Input Report is sent while an earlier one is still queued
+ * for the same connection. The function must fold the new report into the
+ * queued one, for example by adding the relative movement of a mouse.
+ *
+ * @param queued Queued report data, updated in place.
+ * @param rep    New report data.
+ * @param len    Length of the report.
+ */
+typedef void (*bt_gatt_hids_rep_merge_t) (u8_t *queued, u8_t const *rep,
+					  u8_t len);
+
 /** @brief Input Report.
  */
 struct bt_gatt_hids_inp_rep {
@@ -164,6 +177,23 @@ struct bt_gatt_hids_inp_rep {
 	 */
 	const u8_t *rep_mask;
 
+	/** Stored byte ranges of the report, as offset and length pairs.
+	 * Computed from @ref rep_mask on initialization.
+	 */
+	u8_t mask_spans[CONFIG_BT_GATT_HIDS_INP_REP_MASK_SPANS_MAX][2];
+
+	/** Number of used @ref mask_spans entries. 0 if the mask has more
+	 * ranges than fit, in which case the mask is applied byte by byte.
+	 */
+	u8_t mask_span_cnt;
+
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	/** Function merging queued reports. If NULL, the queued report is
+	 * replaced by the newest one.
+	 */
+	bt_gatt_hids_rep_merge_t merge;
+#endif
+
 	/** Callback with the notification event. */
 	bt_gatt_hids_notif_handler_t handler;
 };
@@ -386,6 +416,43 @@ struct bt_gatt_hids {
 	struct bt_conn_ctx_lib *conn_ctx;
 };
 
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+/** @brief Input Report notification queue of a connection.
+ */
+struct bt_gatt_hids_inp_rep_queue {
+	/** Notifications in flight, oldest first. */
+	struct {
+		/** Index of the Input Report. */
+		u8_t idx;
+
+		/** Notification complete callback of the application. */
+		bt_gatt_complete_func_t cb;
+	} inflight[CONFIG_BT_GATT_HIDS_INPUT_REP_MAX *
+		   CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DEPTH];
+
+	/** Index of the oldest notification in flight. */
+	u8_t inflight_head;
+
+	/** Number of notifications in flight. */
+	u8_t inflight_cnt;
+
+	/** Number of notifications in flight per Input Report. */
+	u8_t rep_inflight[CONFIG_BT_GATT_HIDS_INPUT_REP_MAX];
+
+	/** A notification is being sent on the connection. */
+	bool sending;
+
+	/** Bitmask of queued Input Reports. */
+	u16_t queued;
+
+	/** Notification complete callbacks of queued Input Reports. */
+	bt_gatt_complete_func_t queued_cb[CONFIG_BT_GATT_HIDS_INPUT_REP_MAX];
+
+	/** Queued Input Reports data, at the offsets of the reports. */
+	u8_t data[CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DATA_SIZE];
+};
+#endif
+
 /** @brief HID Connection context data structure.
  */
 struct bt_gatt_hids_conn_data {
@@ -409,14 +476,25 @@ struct bt_gatt_hids_conn_data {
 
 	/** Pointer to Feature Reports Context data. */
 	u8_t *feat_rep_ctx;
+
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	/** Input Report notification queue. */
+	struct bt_gatt_hids_inp_rep_queue inp_rep_queue;
+#endif
 };
 
 
 /** @brief Initialize the HIDS instance.
+ *
+ *  If CONFIG_BT_GATT_HIDS_INP_REP_QUEUE is enabled, only one HIDS instance
+ *  can be initialized at a time, and the Input Reports must fit in
+ *  CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DATA_SIZE bytes.
  *
  *  @param hids_obj Pointer to HIDS instance.
  *  @param init_param HIDS initialization descriptor.
  *
+ *  @retval -EALREADY If the Input Report queue is used by another instance.
+ *  @retval -ENOMEM If the Input Reports do not fit in the queue.
  *  @return 0 If the operation was successful. Otherwise, a (negative) error
  *	      code is returned.
  */
@@ -470,6 +548,13 @@ int bt_gatt_hids_notify_disconnected(struct bt_gatt_hids *hids_obj,
  *  @param len Length of report data.
  *  @param cb Notification complete callback (can be NULL).
  *
+ *  If CONFIG_BT_GATT_HIDS_INP_REP_QUEUE is enabled and @p conn is
+ *  not NULL, the report is queued when too many notifications of it are in
+ *  flight, the TX buffers are full, or another notification is being sent
+ *  on the connection. Queued reports are merged, and only the callback
+ *  passed with the newest of them is called. They are sent from the system
+ *  workqueue.
+ *
  *  @return 0 If the operation was successful. Otherwise, a (negative) error
  *	      code is returned.
  */
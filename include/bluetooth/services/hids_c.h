@@ -283,6 +283,16 @@ struct bt_gatt_hids_c {
 		 * current state of this process.
 		 */
 		u8_t rep_idx;
+#if CONFIG_BT_GATT_HIDS_C_READ_MULTIPLE
+		/** Number of values read by the current Read Multiple. */
+		u8_t cnt;
+		/** Result of the current Read Multiple, reported when
+		 *  the read completes.
+		 */
+		int err;
+		/** Handles read by the current Read Multiple. */
+		u16_t handles[CONFIG_BT_GATT_HIDS_C_READ_MULTIPLE_HANDLES_MAX];
+#endif
 	} init_repref;
 
 	struct {
@@ -463,6 +473,23 @@ int bt_gatt_hids_c_rep_write_wo_rsp(struct bt_gatt_hids_c *hids_c,
 				    struct bt_gatt_hids_c_rep_info *rep,
 				    const void *data, u8_t length);
 
+/**
+ * @brief Subscribe to notifications of all Input Reports.
+ *
+ * Subscribes to every Input Report that is not subscribed yet, excluding
+ * boot reports. All CCC writes are queued at once and sent one after
+ * another.
+ *
+ * @param hids_c HIDS client object.
+ * @param func   Function to be called to handle the notificated value.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned. Reports
+ *           subscribed before the error stay subscribed.
+ */
+int bt_gatt_hids_c_rep_subscribe_all(struct bt_gatt_hids_c *hids_c,
+				     bt_gatt_hids_c_read_cb func);
+
 /**
  * @brief Subscribe to report notifications.
  *
@@ -36,6 +36,9 @@ typedef void (*nus_received_cb_t)(const u8_t *const data, u16_t len);
 /** @brief Callback type for data sent. */
 typedef void (*nus_sent_cb_t)(const u8_t *data, u16_t len);
 
+/** @brief Callback type for space freed in the stream buffer. */
+typedef void (*nus_stream_space_cb_t)(size_t space);
+
 /** @brief Pointers to the callback functions for service events. */
 struct bt_nus_cb {
 
@@ -44,6 +47,9 @@ struct bt_nus_cb {
 
         /** Callback for data sent. **/
 	nus_sent_cb_t     sent_cb;
+
+        /** Callback for space freed in the stream buffer. **/
+	nus_stream_space_cb_t stream_space_cb;
 };
 
 /**@brief Initialize the service.
@@ -76,6 +82,29 @@ int nus_init(struct bt_nus_cb *callbacks);
  */
 int nus_send(const u8_t *data, u16_t len);
 
+/**@brief Queue data for streaming.
+ *
+ * @details This function copies as much of the data as fits into the stream
+ *          buffer and returns. The data is sent to the given connection as
+ *          notifications of up to ATT_MTU - 3 bytes, with up to
+ *          CONFIG_BT_GATT_NUS_STREAM_INFLIGHT_MAX notifications in flight.
+ *          When notifications complete, more data is sent and the
+ *          stream_space_cb callback reports the free space in the buffer.
+ *
+ *          Only one connection can be streamed to at a time. Data for
+ *          another connection is accepted after all queued data is sent.
+ *
+ * @param[in] conn Connection to send the data to.
+ * @param[in] data Pointer to a data buffer.
+ * @param[in] len  Length of the data in the buffer.
+ *
+ * @retval Number of bytes queued, which may be less than @p len.
+ * @retval -EFAULT If notifications are not enabled.
+ * @retval -EBUSY If data for another connection is still queued.
+ *           Otherwise, a negative value is returned.
+ */
+int nus_stream_send(struct bt_conn *conn, const u8_t *data, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,7 @@
 #define __GATT_THROUGHPUT_H
 
 #include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,6 +34,85 @@ struct metrics {
 	u32_t write_rate;
 };
 
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+/**@brief Header of a test packet. */
+struct throughput_pkt_hdr {
+
+        /** Sequence number of the packet. */
+	u32_t seq;
+
+        /** Sender time stamp in hardware clock cycles. */
+	u32_t timestamp;
+} __packed;
+
+/**@brief Test control command written by the client.
+ *
+ * Writing the command resets the metrics, like a write of one byte. The
+ * server then sends the requested number of test packets as
+ * notifications, at the same time as it receives writes.
+ */
+struct throughput_ctrl {
+
+        /** Number of test packets to notify (little endian), 0 to stop. */
+	u32_t notify_cnt;
+
+        /** Length of each notified test packet (little endian). */
+	u16_t notify_len;
+} __packed;
+
+/**@brief Histogram of times in microseconds. */
+struct throughput_hist {
+
+        /** Number of values in each logarithmic bin. */
+	u32_t bins[CONFIG_BT_GATT_THROUGHPUT_HIST_BINS];
+
+        /** Number of values. */
+	u32_t cnt;
+
+        /** Smallest value in microseconds. */
+	u32_t min;
+
+        /** Largest value in microseconds. */
+	u32_t max;
+
+        /** Sum of all values in microseconds. */
+	u64_t sum;
+};
+
+/**@brief Statistics of one direction of a throughput test. */
+struct throughput_stats {
+
+        /** Number of packets received. */
+	u32_t pkt_cnt;
+
+        /** Number of bytes received. */
+	u32_t bytes;
+
+        /** Number of packets missing from the sequence. */
+	u32_t lost;
+
+        /** Sequence number of the next expected packet. */
+	u32_t next_seq;
+
+        /** Uptime of the first packet in milliseconds. */
+	s64_t start;
+
+        /** Uptime of the last packet in milliseconds. */
+	s64_t last;
+
+        /** Hardware clock cycles at the last packet. */
+	u32_t last_cycles;
+
+        /** Time between received packets (inter-arrival time, not
+         *  latency).
+         */
+	struct throughput_hist interval;
+
+        /** Round-trip time of echoed packets. */
+	struct throughput_hist rtt;
+};
+#endif /* CONFIG_BT_GATT_THROUGHPUT_STATS */
+
 /** @brief Throughput characteristic UUID. */
 #define BT_UUID_THROUGHPUT_CHAR BT_UUID_DECLARE_16(0x1524)
 
@@ -46,6 +126,85 @@ struct metrics {
  */
 void throughput_init(void);
 
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+/**
+ * @brief Reset statistics.
+ *
+ * @param stats Statistics.
+ */
+void throughput_stats_reset(struct throughput_stats *stats);
+
+/**
+ * @brief Write the test packet header to a buffer.
+ *
+ * @param buf Packet buffer, at least the size of the header.
+ * @param seq Sequence number of the packet.
+ */
+void throughput_pkt_fill(u8_t *buf, u32_t seq);
+
+/**
+ * @brief Account a received test packet.
+ *
+ * Updates the byte and packet counts, the number of lost packets and the
+ * histogram of times between packets. Packets that do not start with
+ * the header are counted, but not checked for loss.
+ *
+ * @param stats Statistics.
+ * @param data  Packet data, starting with the header.
+ * @param len   Packet length.
+ */
+void throughput_stats_rx(struct throughput_stats *stats, const u8_t *data,
+			 u16_t len);
+
+/**
+ * @brief Account an echoed packet header.
+ *
+ * Adds the round-trip time of the packet to the histogram.
+ *
+ * @param stats Statistics.
+ * @param data  Echoed header.
+ * @param len   Length of the echoed data.
+ */
+void throughput_stats_echo(struct throughput_stats *stats, const u8_t *data,
+			   u16_t len);
+
+/**
+ * @brief Get a percentile of a histogram.
+ *
+ * @param hist    Histogram.
+ * @param percent Percentile, from 1 to 100.
+ *
+ * @return Upper bound of the bin that holds the percentile in
+ *         microseconds, or 0 if the histogram is empty.
+ */
+u32_t throughput_hist_percentile(const struct throughput_hist *hist,
+				 u8_t percent);
+
+/**
+ * @brief Print statistics as a single line of JSON.
+ *
+ * @param name  Name of the statistics in the output.
+ * @param stats Statistics.
+ */
+void throughput_stats_print(const char *name,
+			    const struct throughput_stats *stats);
+
+/**
+ * @brief Send a test packet to the client as a notification.
+ *
+ * The packet is longer than the header, so that the client can tell it
+ * apart from echoed headers.
+ *
+ * @param conn Connection.
+ * @param len  Packet length, larger than the header.
+ * @param cb   Notification complete callback (can be NULL).
+ *
+ * @return 0 or a negative error code.
+ */
+int throughput_send(struct bt_conn *conn, u16_t len,
+		    bt_gatt_complete_func_t cb);
+#endif /* CONFIG_BT_GATT_THROUGHPUT_STATS */
+
 #ifdef __cplusplus
 }
 #endif
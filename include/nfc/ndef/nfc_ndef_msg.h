@@ -53,7 +53,9 @@ struct nfc_ndef_msg_desc {
  *
  * @param ndef_msg_desc Pointer to the message descriptor.
  * @param msg_buffer Pointer to the message destination. If NULL, function
- * will calculate the expected size of the message.
+ * will calculate the expected size of the message. There is no need to
+ * calculate the size before encoding into a buffer, as the encoding fails
+ * without writing past the size of the available memory.
  * @param msg_len Size of the available memory for the message as input. Size
  * of the generated message as output.
  *
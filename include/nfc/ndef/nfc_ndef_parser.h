@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _NFC_NDEF_PARSER_H__
+#define _NFC_NDEF_PARSER_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <nfc/ndef/nfc_ndef_record.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ *
+ * @defgroup nfc_ndef_parser NDEF message parser
+ * @{
+ * @ingroup  nfc_modules
+ *
+ * @brief    Parsing of NFC NDEF messages in place.
+ *
+ */
+
+/**
+ * @brief Parsed NDEF record.
+ *
+ * The type, ID, and payload fields point into the parsed buffer, which
+ * must therefore stay valid as long as the record is used.
+ */
+struct nfc_ndef_parsed_record {
+	/** Value of the Type Name Format (TNF) field. */
+	enum nfc_ndef_record_tnf tnf;
+	/** Location of the record within the NDEF message. */
+	enum nfc_ndef_record_location location;
+	/** The record is a chunk of a payload that continues in the next
+	 *  record.
+	 */
+	bool chunked;
+	/** Length of the type field. */
+	u8_t type_length;
+	/** Pointer to the type field data. Not relevant if type_length is 0. */
+	u8_t const *type;
+	/** Length of the ID field. */
+	u8_t id_length;
+	/** Pointer to the ID field data. Not relevant if id_length is 0. */
+	u8_t const *id;
+	/** Length of the payload field. */
+	u32_t payload_length;
+	/** Pointer to the payload field data. Not relevant if payload_length
+	 *  is 0.
+	 */
+	u8_t const *payload;
+};
+
+/**
+ * @brief NDEF message parser.
+ *
+ * The members are internal to the parser.
+ */
+struct nfc_ndef_parser {
+	u8_t const *buffer;
+	u32_t length;
+	u32_t start;
+	u32_t offset;
+	bool chunk_pending;
+	bool message_end;
+};
+
+/**
+ * @brief Start parsing an NDEF message.
+ *
+ * The message is not copied, and nothing is allocated.
+ * If CONFIG_NFC_NDEF_MSG_WITH_NLEN is set, the message is expected to start
+ * with an NLEN field, which limits the length of the message.
+ *
+ * @param parser Pointer to the parser.
+ * @param msg_buffer Pointer to the message.
+ * @param msg_len Length of the buffer that holds the message.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nfc_ndef_parser_init(struct nfc_ndef_parser *parser,
+			 u8_t const *msg_buffer,
+			 u32_t msg_len);
+
+/**
+ * @brief Parse the next record of an NDEF message.
+ *
+ * Chunked payloads are not reassembled, as this would require a copy.
+ * Each chunk is returned as a record with the chunked flag set, except for
+ * the last chunk. Chunks that follow the first one have the
+ * @ref TNF_UNCHANGED type name format, and no type and ID fields.
+ *
+ * @param parser Pointer to the parser.
+ * @param record Pointer to the record that is filled in.
+ *
+ * @retval 0 If a record was parsed.
+ * @retval -ENOENT If the end of the message has been reached.
+ * @retval -EBADMSG If the message is malformed or truncated. The parser
+ *                  cannot be used further.
+ */
+int nfc_ndef_parser_next(struct nfc_ndef_parser *parser,
+			 struct nfc_ndef_parsed_record *record);
+
+/**
+ * @brief Check if a parsed record has a given type.
+ *
+ * @param record Pointer to the parsed record.
+ * @param tnf Type Name Format (TNF) value.
+ * @param type Pointer to the type.
+ * @param type_length Length of the type.
+ *
+ * @return True if the record has the given type, false otherwise.
+ */
+bool nfc_ndef_parsed_record_type_match(
+			struct nfc_ndef_parsed_record const *record,
+			enum nfc_ndef_record_tnf tnf,
+			u8_t const *type,
+			u8_t type_length);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NFC_NDEF_PARSER_H__ */
@@ -51,6 +51,11 @@ extern "C" {
  * payload will fit in the provided buffer. This must be checked by the caller
  * function.
  *
+ * The record encoder calls the constructor once per encode. With a NULL
+ * buffer, it calculates the size of the payload. Otherwise, it writes the
+ * payload directly after a short record header, with the memory left in
+ * the record buffer as the available size.
+ *
  * @retval 0 If the operation was successful.
  *           Otherwise, a (negative) error code is returned.
  */
@@ -244,7 +249,11 @@ struct nfc_ndef_bin_payload_desc {
  * @brief Encode an NDEF record.
  *
  * @details This function encodes an NDEF record according to the provided
- * record descriptor.
+ * record descriptor. Records with a payload of up to 255 bytes are encoded
+ * as short records, with a 1-byte Payload Length field. The payload
+ * constructor runs once and writes the payload behind a short record
+ * header. If the payload is longer than 255 bytes, it is moved by 3 bytes
+ * to make room for the 4-byte Payload Length field of a normal record.
  *
  * @param ndef_record_desc Pointer to the record descriptor.
  * @param record_location Location of the record within the NDEF message.
@@ -19,6 +19,7 @@
 
 #include <zephyr/types.h>
 #include <nfc/ndef/nfc_ndef_record.h>
+#include <nfc/ndef/nfc_ndef_parser.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -69,6 +70,24 @@ int nfc_text_rec_payload_constructor(
 		u8_t *buff,
 		u32_t *len);
 
+/**
+ * @brief Decode the payload of a parsed Text record.
+ *
+ * The language code and the text are not copied, and point into the parsed
+ * message.
+ *
+ * @param record Pointer to the parsed record.
+ * @param nfc_rec_text_payload_desc Pointer to the Text record description
+ * that is filled in.
+ *
+ * @retval 0 If the payload was decoded successfully.
+ * @retval -EINVAL If the record is not a Text record.
+ * @retval -ENOTSUP If the record is chunked.
+ * @retval -EBADMSG If the payload is malformed.
+ */
+int nfc_text_rec_parse(struct nfc_ndef_parsed_record const *record,
+		struct nfc_text_rec_payload_desc *nfc_rec_text_payload_desc);
+
 /**
  * @brief External reference to the type field of the Text record, defined in
  * the file @c nfc_text_rec.c. It is used in the
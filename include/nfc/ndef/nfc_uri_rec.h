@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <zephyr/types.h>
 #include <nfc/ndef/nfc_ndef_record.h>
+#include <nfc/ndef/nfc_ndef_parser.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,7 +81,7 @@ struct uri_payload_desc {
 	/** Pointer to a URI string. */
 	u8_t const *uri_data;
 	/** Length of the URI string. */
-	u8_t uri_data_len;
+	u32_t uri_data_len;
 };
 
 /**
@@ -110,6 +111,22 @@ int nfc_uri_payload_constructor(struct uri_payload_desc *input,
 				u8_t *buff,
 				u32_t *len);
 
+/**
+ * @brief Decode the payload of a parsed URI record.
+ *
+ * The URI string is not copied, and points into the parsed message.
+ *
+ * @param record Pointer to the parsed record.
+ * @param output Pointer to the description of the payload that is filled in.
+ *
+ * @retval 0 If the payload was decoded successfully.
+ * @retval -EINVAL If the record is not a URI record.
+ * @retval -ENOTSUP If the record is chunked.
+ * @retval -EBADMSG If the payload is malformed.
+ */
+int nfc_uri_rec_parse(struct nfc_ndef_parsed_record const *record,
+		      struct uri_payload_desc *output);
+
 /** @brief Macro for generating a description of a URI record.
  *
  * This macro initializes an instance of an NFC NDEF record description of a
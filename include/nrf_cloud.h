@@ -155,6 +155,33 @@ struct nrf_cloud_evt {
 	} param;
 };
 
+/**@brief Connection establishment statistics of the last connection.
+ *
+ * Durations are in milliseconds, zero if the phase was not completed.
+ */
+struct nrf_cloud_connect_stats {
+	/** Number of calls to @ref nrf_cloud_connect. */
+	u32_t connect_count;
+	/** Number of connections that were resumed using a cached data
+	 *  channel endpoint.
+	 */
+	u32_t resume_count;
+	/** Time spent in @ref nrf_cloud_connect (DNS, TCP and TLS). */
+	u32_t handshake_ms;
+	/** Time from @ref nrf_cloud_connect until the MQTT connection was
+	 *  acknowledged.
+	 */
+	u32_t transport_ms;
+	/** Time until the control channel subscription was acknowledged. */
+	u32_t cc_ms;
+	/** Time until the shadow confirmed the user association. */
+	u32_t ua_ms;
+	/** Time until the data channel subscription was acknowledged. */
+	u32_t dc_ms;
+	/** Time from @ref nrf_cloud_connect until @ref NRF_CLOUD_EVT_READY. */
+	u32_t total_ms;
+};
+
 /**
  * @brief  Event handler registered with the module to handle asynchronous
  * events from the module.
@@ -163,6 +190,16 @@ struct nrf_cloud_evt {
  */
 typedef void (*nrf_cloud_event_handler_t)(const struct nrf_cloud_evt *evt);
 
+/**
+ * @brief  Handler registered with the module to receive data published on
+ * an application topic.
+ *
+ * @param[in]  topic   The topic the data was received on.
+ * @param[in]  payload The received data.
+ */
+typedef void (*nrf_cloud_topic_handler_t)(const struct nrf_cloud_data *topic,
+					  const struct nrf_cloud_data *payload);
+
 /**@brief Initialization parameters for the module. */
 struct nrf_cloud_init_param {
 	/** Event handler that is registered with the module. */
@@ -267,6 +304,39 @@ int nrf_cloud_sensor_data_stream(const struct nrf_cloud_sensor_data *param);
  */
 int nrf_cloud_disconnect(void);
 
+/**
+ * @brief Register a handler for an application topic.
+ *
+ * The topic is subscribed to when the data channel is established, and
+ * data published on it is passed to the handler instead of being
+ * notified as @ref NRF_CLOUD_EVT_RX_DATA. At most
+ * CONFIG_NRF_CLOUD_APP_TOPICS_MAX topics can be registered.
+ *
+ * This API must be called after @ref nrf_cloud_init and before
+ * @ref nrf_cloud_connect. The topic buffer must remain valid as long as
+ * the module is in use.
+ *
+ * @param[in] topic   The topic to subscribe to.
+ * @param[in] handler Handler called for data received on the topic.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_cloud_topic_handler_register(const struct nrf_cloud_data *topic,
+				     nrf_cloud_topic_handler_t handler);
+
+/**
+ * @brief Get the connection establishment statistics.
+ *
+ * Requires CONFIG_NRF_CLOUD_CONNECT_STATS.
+ *
+ * @param[out] stats Statistics of the last connection.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_cloud_connect_stats_get(struct nrf_cloud_connect_stats *stats);
+
 /**
  * @brief Function that must be called periodically to keep the module
  * functional.
@@ -203,12 +203,70 @@ struct nrf_esb_payload {
 	u8_t data[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH]; /**< The payload data. */
 };
 
+/** @brief Enhanced ShockBurst payload buffer.
+ *
+ *  Describes a payload that is stored in a FIFO of the module and lent to
+ *  the application, so that the payload data can be accessed in place.
+ */
+struct nrf_esb_payload_buf {
+	u8_t *data;  /**< Payload data in the FIFO. */
+	u8_t length; /**< Length of the payload data. */
+	u8_t pipe;   /**< Pipe used for this payload. */
+	s8_t rssi;   /**< RSSI for the received packet. */
+	u8_t noack;  /**< Flag indicating that this packet will not be
+		       *  acknowledged.
+		       */
+	u8_t pid;    /**< PID assigned during communication. */
+};
+
 /** @brief Enhanced ShockBurst event. */
 struct nrf_esb_evt {
 	enum nrf_esb_evt_id evt_id;	/**< Enhanced ShockBurst event ID. */
 	u32_t tx_attempts;	/**< Number of TX retransmission attempts. */
 };
 
+#if CONFIG_NRF_ESB_STATS
+/** @brief Enhanced ShockBurst link statistics of a pipe. */
+struct nrf_esb_pipe_stats {
+	u32_t tx_success;	/**< Packets that were acknowledged, or sent
+				  *  without acknowledgment.
+				  */
+	u32_t tx_failed;	/**< Packets that ran out of retransmission
+				  *  attempts.
+				  */
+	/** Histogram of the TX attempts of acknowledged packets. Bin n counts
+	 *  the packets that were acknowledged after n + 1 attempts. The last
+	 *  bin also counts the packets that needed more attempts.
+	 */
+	u32_t tx_attempts[CONFIG_NRF_ESB_STATS_ATTEMPTS_BINS];
+	u32_t rx_packets;	/**< Packets received, including
+				  *  acknowledgment payloads.
+				  */
+	u32_t rx_crc_errors;	/**< Packets received with a CRC error. */
+	u32_t rx_duplicates;	/**< Retransmitted packets that were
+				  *  received again.
+				  */
+	s8_t rssi_avg;		/**< Moving average of the RSSI of received
+				  *  packets, in the unit of
+				  *  @ref nrf_esb_payload.rssi.
+				  */
+};
+#endif /* CONFIG_NRF_ESB_STATS */
+
+#if CONFIG_NRF_ESB_HOPPING
+/** @brief Channel of the hop sequence. */
+struct nrf_esb_hop_channel {
+	u8_t rf_channel;	/**< RF channel, between 0 and 100. */
+	u8_t quality;		/**< Moving average of the ratio of
+				  *  successful exchanges on the channel,
+				  *  where 255 stands for all of them.
+				  */
+	bool blacklisted;	/**< The PTX does not transmit on the
+				  *  channel.
+				  */
+};
+#endif /* CONFIG_NRF_ESB_HOPPING */
+
 /** @brief Definition of the event handler for the module. */
 typedef void (*nrf_esb_event_handler)(const struct nrf_esb_evt *event);
 
@@ -293,6 +351,47 @@ bool nrf_esb_is_idle(void);
  */
 int nrf_esb_write_payload(const struct nrf_esb_payload *payload);
 
+/** @brief Write several payloads for transmission or acknowledgement.
+ *
+ *  This function adds the payloads to the queue in the given order, as
+ *  @ref nrf_esb_write_payload does, but updates the queue only once.
+ *  Writing stops at the first payload that cannot be queued.
+ *
+ *  @param[in] payloads	The payloads.
+ *  @param[in] count	Number of payloads.
+ *
+ *  @return Number of queued payloads if at least one payload was queued.
+ *          Otherwise, a (negative) error code is returned.
+ *  @retval -EBUSY If another write is in progress or a buffer from
+ *          @ref nrf_esb_tx_payload_alloc is not submitted yet.
+ */
+int nrf_esb_write_payloads(const struct nrf_esb_payload *payloads,
+			   size_t count);
+
+/** @brief Get a buffer for a payload to transmit.
+ *
+ *  This function lends the next free slot of the TX queue to the
+ *  application. The application writes the payload data directly to
+ *  @p buf->data, sets the length, the pipe, and the noack flag, and queues
+ *  the payload with @ref nrf_esb_tx_payload_submit. Only one buffer can be
+ *  lent at a time, and payloads cannot be written until it is submitted.
+ *
+ *  @param[out] buf	Payload buffer.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_tx_payload_alloc(struct nrf_esb_payload_buf *buf);
+
+/** @brief Queue a payload buffer for transmission or acknowledgement.
+ *
+ *  @param[in] buf	Payload buffer from @ref nrf_esb_tx_payload_alloc.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_tx_payload_submit(const struct nrf_esb_payload_buf *buf);
+
 /** @brief Read a payload.
  *
  *  @param[in,out] payload	The payload to be received.
@@ -302,6 +401,41 @@ int nrf_esb_write_payload(const struct nrf_esb_payload *payload);
  */
 int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload);
 
+/** @brief Read several payloads.
+ *
+ *  @param[out] payloads	The payloads to be received.
+ *  @param[in]  count		Maximum number of payloads to read.
+ *
+ *  @return Number of read payloads if at least one payload was read.
+ *          Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_read_rx_payloads(struct nrf_esb_payload *payloads, size_t count);
+
+/** @brief Get a received payload without copying it.
+ *
+ *  This function lends the oldest received payload that is not lent yet to
+ *  the application. The payload stays in the RX queue until it is released
+ *  with @ref nrf_esb_rx_payload_release. Several payloads can be lent at a
+ *  time and must be released in the order they were received.
+ *
+ *  @note Flushing the RX queue invalidates all lent payloads.
+ *
+ *  @param[out] buf	Payload buffer.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_rx_payload_get(struct nrf_esb_payload_buf *buf);
+
+/** @brief Release a received payload.
+ *
+ *  @param[in] buf	The oldest lent payload buffer.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_rx_payload_release(const struct nrf_esb_payload_buf *buf);
+
 /** @brief Start transmitting data.
  *
  * @retval 0 If successful.
@@ -419,6 +553,8 @@ int nrf_esb_update_prefix(u8_t pipe, u8_t prefix);
  *  stop RX before changing the channel. After changing the channel, operation
  *  can be resumed.
  *
+ *  The channel is not used while channel hopping is on.
+ *
  *  @param[in] channel	Channel to use for radio.
  *
  * @retval 0 If successful.
@@ -427,6 +563,8 @@ int nrf_esb_update_prefix(u8_t pipe, u8_t prefix);
 int nrf_esb_set_rf_channel(u32_t channel);
 
 /** @brief Get the current radio channel.
+ *
+ *  With channel hopping, this is the current channel of the hop sequence.
  *
  *  @param[in, out] channel	Channel number.
  *
@@ -445,6 +583,9 @@ int nrf_esb_get_rf_channel(u32_t *channel);
 int nrf_esb_set_tx_power(enum nrf_esb_tx_power tx_output_power);
 
 /** @brief Set the packet retransmit delay.
+ *
+ *  With adaptive retransmission, the module chooses the delay from the
+ *  length of recent acknowledgments instead, and this value is not used.
  *
  *  @param[in] delay	Delay between retransmissions.
  *
@@ -454,6 +595,9 @@ int nrf_esb_set_tx_power(enum nrf_esb_tx_power tx_output_power);
 int nrf_esb_set_retransmit_delay(u16_t delay);
 
 /** @brief Set the number of retransmission attempts.
+ *
+ *  With adaptive retransmission, this value is the largest number of
+ *  retransmissions that the module uses.
  *
  *  @param[in] count	Number of retransmissions.
  *
@@ -485,6 +629,49 @@ int nrf_esb_set_bitrate(enum nrf_esb_bitrate bitrate);
  */
 int nrf_esb_reuse_pid(u8_t pipe);
 
+#if CONFIG_NRF_ESB_STATS
+/** @brief Get the link statistics of a pipe.
+ *
+ *  @param[in]  pipe	Pipe.
+ *  @param[out] stats	Statistics.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_get_pipe_stats(u8_t pipe, struct nrf_esb_pipe_stats *stats);
+
+/** @brief Reset the link statistics of all pipes. */
+void nrf_esb_reset_stats(void);
+#endif /* CONFIG_NRF_ESB_STATS */
+
+#if CONFIG_NRF_ESB_HOPPING
+/** @brief Set the hop sequence for channel hopping.
+ *
+ *  The PTX and the PRX must use the same hop sequence. The module starts at
+ *  the first channel of the sequence, and resets the quality of all
+ *  channels. The module must be in an idle state to call this function.
+ *
+ *  @param[in] channels	RF channels, between 0 and 100, in hop order.
+ *  @param[in] count	Number of channels. Must be less than or equal to
+ *			@ref CONFIG_NRF_ESB_HOP_CHANNELS_MAX. Zero turns
+ *			channel hopping off.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_set_hop_channels(const u8_t *channels, u8_t count);
+
+/** @brief Get the state of a channel of the hop sequence.
+ *
+ *  @param[in]  index	Position of the channel in the hop sequence.
+ *  @param[out] channel	Channel state.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_get_hop_channel(u8_t index, struct nrf_esb_hop_channel *channel);
+#endif /* CONFIG_NRF_ESB_HOPPING */
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef __NRF_ESB_SIM_H
+#define __NRF_ESB_SIM_H
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup nrf_esb_sim Enhanced ShockBurst radio simulation
+ * @{
+ * @ingroup nrf_esb
+ *
+ * @brief Simulated radio environment for running the Enhanced ShockBurst
+ *        module on native_posix.
+ *
+ * The simulation models the RADIO, TIMER, and PPI peripherals used by the
+ * module, and peer devices that communicate with it. When the module acts as
+ * a PTX, a simulated PRX receives its packets and acknowledges them. When the
+ * module acts as a PRX, simulated PTX devices send packets to it, each on
+ * its own pipe.
+ *
+ * The simulation runs in virtual time, which only advances in
+ * @ref nrf_esb_sim_run. The interrupt handlers of the module and the
+ * application event handler are called from that function.
+ */
+
+/** @brief Simulated radio environment configuration. */
+struct nrf_esb_sim_config {
+	/** Seed of the pseudo-random number generator. */
+	u32_t seed;
+	/** Probability, in percent, that a frame is lost on air. */
+	u8_t loss;
+	/** Additional delay, in microseconds, before a simulated peer
+	 *  sends an acknowledgment.
+	 */
+	u16_t latency_us;
+	/** Selective auto acknowledgement of the simulated PRX. When
+	 *  disabled, all packets are acknowledged.
+	 */
+	bool selective_auto_ack;
+	/** Length of the payloads in acknowledgments of the simulated PRX.
+	 *  Zero for acknowledgments without payload.
+	 */
+	u8_t ack_payload_length;
+	/** Number of simulated PTX devices. Device n transmits on pipe n. */
+	u8_t peer_count;
+	/** Average interval between new packets of each simulated PTX, in
+	 *  microseconds. The actual interval is random, between half and
+	 *  one and a half of this value.
+	 */
+	u32_t peer_interval_us;
+	/** Length of the payloads of the simulated PTX devices. The first
+	 *  four bytes hold a packet sequence number, in little endian.
+	 */
+	u8_t peer_payload_length;
+	/** Number of retransmission attempts of the simulated PTX devices. */
+	u8_t peer_retransmit_count;
+	/** Delay between retransmissions of the simulated PTX devices, in
+	 *  microseconds.
+	 */
+	u16_t peer_retransmit_delay;
+	/** Additional probability, in percent, that a frame is lost on air,
+	 *  for each RF channel. Array of 101 entries indexed by RF channel,
+	 *  or NULL.
+	 */
+	const u8_t *channel_loss;
+	/** Hop sequence of the simulated peers, or NULL if they do not hop.
+	 *  The simulated peers hop like the module does, with the same
+	 *  configuration. Requires CONFIG_NRF_ESB_HOPPING.
+	 */
+	const u8_t *hop_channels;
+	/** Number of channels in @ref nrf_esb_sim_config.hop_channels. */
+	u8_t hop_channel_count;
+};
+
+/** @brief Simulated radio environment statistics. */
+struct nrf_esb_sim_stats {
+	u64_t time_us;		/**< Virtual time, in microseconds. */
+	u32_t tx_frames;	/**< Frames transmitted by the module. */
+	u32_t rx_frames;	/**< Frames received by the module. */
+	u32_t lost_frames;	/**< Frames lost on air. */
+	u32_t collisions;	/**< Frames corrupted by overlapping
+				  *  transmissions.
+				  */
+	u32_t peer_rx_packets;	/**< New packets received by the
+				  *  simulated PRX.
+				  */
+	u32_t peer_rx_duplicates; /**< Retransmitted packets received again
+				    *  by the simulated PRX.
+				    */
+	u32_t peer_tx_packets;	/**< New packets sent by the simulated PTX
+				  *  devices.
+				  */
+	u32_t peer_tx_acked;	/**< Packets of the simulated PTX devices
+				  *  that were acknowledged.
+				  */
+	u32_t peer_tx_failed;	/**< Packets of the simulated PTX devices
+				  *  that ran out of retransmissions.
+				  */
+	u32_t peer_retransmits;	/**< Retransmissions of the simulated PTX
+				  *  devices.
+				  */
+};
+
+/** @brief Configure the simulated radio environment.
+ *
+ *  This function resets the simulated peers and the statistics. The virtual
+ *  time and the state of the simulated peripherals are kept.
+ *
+ *  @param[in] config	Configuration.
+ */
+void nrf_esb_sim_configure(const struct nrf_esb_sim_config *config);
+
+/** @brief Advance the virtual time.
+ *
+ *  This function processes all simulated events up to the given time,
+ *  calling the interrupt handlers of the module as they occur.
+ *
+ *  @param[in] duration_us	Time to advance, in microseconds.
+ */
+void nrf_esb_sim_run(u32_t duration_us);
+
+/** @brief Get the statistics of the simulated radio environment.
+ *
+ *  @param[out] stats	Statistics.
+ */
+void nrf_esb_sim_stats_get(struct nrf_esb_sim_stats *stats);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NRF_ESB_SIM_H */
@@ -15,6 +15,7 @@ LOG_MODULE_REGISTER(LOG_DOMAIN);
 #include <net/socket.h>
 #include <string.h>
 #include <init.h>
+#include <ring_buffer.h>
 
 #define CONFIG_UART_0_NAME 	"UART_0"
 #define CONFIG_UART_1_NAME 	"UART_1"
@@ -24,7 +25,12 @@ LOG_MODULE_REGISTER(LOG_DOMAIN);
 
 #define UART_RX_BUF_SIZE 	CONFIG_AT_HOST_UART_BUF_SIZE
 
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+/* The socket thread reads into static buffers, which the UART transmits. */
+#define THREAD_STACK_SIZE 	512
+#else
 #define THREAD_STACK_SIZE 	(CONFIG_AT_HOST_SOCKET_BUF_SIZE + 512)
+#endif
 #define THREAD_PRIORITY 	K_PRIO_PREEMPT(CONFIG_AT_HOST_THREAD_PRIO)
 
 /**
@@ -34,6 +40,12 @@ LOG_MODULE_REGISTER(LOG_DOMAIN);
  */
 #define AT_MAX_CMD_LEN		CONFIG_AT_HOST_UART_BUF_SIZE
 
+/**
+ * @brief Time in milliseconds without received data after which the UART
+ * reports the data that it has received so far.
+ */
+#define UART_RX_TIMEOUT_MS	10
+
 /** @brief Termination Modes. */
 enum term_modes {
 	MODE_NULL_TERM, /**< Null Termination */
@@ -63,6 +75,15 @@ static struct k_thread socket_thread;
 static K_THREAD_STACK_DEFINE(socket_thread_stack, THREAD_STACK_SIZE);
 static struct k_mutex socket_mutex;
 
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+static u8_t uart_rx_buf[2][CONFIG_AT_HOST_UART_DMA_BUF_SIZE];
+static u8_t uart_rx_next;
+static struct k_work uart_rx_work;
+RING_BUF_DECLARE(uart_rx_ring, CONFIG_AT_HOST_UART_RX_RING_SIZE);
+static u8_t uart_tx_buf[2][CONFIG_AT_HOST_SOCKET_BUF_SIZE];
+static K_SEM_DEFINE(uart_tx_sem, 1, 1);
+#endif
+
 
 static const char termination[3] = { '\0', '\r', '\n' };
 
@@ -80,7 +101,9 @@ static void at_cmd_send(struct k_work *work)
 		LOG_ERR("Could not send AT command to modem: %d", bytes_sent);
 	}
 
+#if !defined(CONFIG_AT_HOST_UART_ASYNC)
 	uart_irq_rx_enable(uart_dev);
+#endif
 }
 
 static void uart_rx_handler(u8_t character)
@@ -151,12 +174,107 @@ static void uart_rx_handler(u8_t character)
 
 	return;
 send:
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+	/* Commands are assembled in thread context, so the command can be
+	 * sent right away. The UART keeps receiving into the ring buffer
+	 * meanwhile.
+	 */
+	at_buf_len = cmd_len;
+	cmd_len = 0;
+	at_cmd_send(NULL);
+#else
 	uart_irq_rx_disable(uart_dev);
 	k_work_submit(&at_cmd_send_work);
 	at_buf_len = cmd_len;
 	cmd_len = 0;
+#endif
 }
 
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+static void uart_rx_process(struct k_work *work)
+{
+	u8_t data[CONFIG_AT_HOST_UART_DMA_BUF_SIZE];
+	u32_t len;
+
+	ARG_UNUSED(work);
+
+	while ((len = ring_buf_get(&uart_rx_ring, data, sizeof(data)))) {
+		for (size_t i = 0; i < len; i++) {
+			uart_rx_handler(data[i]);
+		}
+	}
+}
+
+static int uart_rx_start(void)
+{
+	uart_rx_next = 1;
+
+	return uart_rx_enable(uart_dev, uart_rx_buf[0], sizeof(uart_rx_buf[0]),
+			      UART_RX_TIMEOUT_MS);
+}
+
+static void uart_callback(struct uart_event *evt, void *user_data)
+{
+	u32_t written;
+	int err;
+
+	ARG_UNUSED(user_data);
+
+	switch (evt->type) {
+	case UART_TX_DONE:
+		/* Fall through. */
+	case UART_TX_ABORTED:
+		k_sem_give(&uart_tx_sem);
+		break;
+	case UART_RX_RDY:
+		written = ring_buf_put(&uart_rx_ring,
+				       &evt->data.rx.buf[evt->data.rx.offset],
+				       evt->data.rx.len);
+		if (written < evt->data.rx.len) {
+			LOG_ERR("Rx ring buffer full, dropping %u bytes",
+				(u32_t)(evt->data.rx.len - written));
+		}
+		k_work_submit(&uart_rx_work);
+		break;
+	case UART_RX_BUF_REQUEST:
+		/* The request arrives while the current buffer is still being
+		 * received into, so the next one must be the other buffer. The
+		 * current one is released once the UART has switched over,
+		 * and is free again by the next request.
+		 */
+		uart_rx_buf_rsp(uart_dev, uart_rx_buf[uart_rx_next],
+				sizeof(uart_rx_buf[0]));
+		uart_rx_next ^= 1;
+		break;
+	case UART_RX_DISABLED:
+		/* Reception stops after an error. Restart it. */
+		err = uart_rx_start();
+		if (err) {
+			LOG_ERR("Cannot restart UART reception: %d", err);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void uart_data_send(const u8_t *data, size_t len)
+{
+	int err;
+
+	/* Wait for the previous transmission, which uses the other
+	 * buffer.
+	 */
+	k_sem_take(&uart_tx_sem, K_FOREVER);
+
+	err = uart_tx(uart_dev, data, len, K_FOREVER);
+	if (err) {
+		LOG_ERR("UART transmission failed: %d", err);
+		k_sem_give(&uart_tx_sem);
+	}
+}
+#else
+
 static void isr(struct device *dev)
 {
 	u8_t character;
@@ -171,6 +289,7 @@ static void isr(struct device *dev)
 		uart_rx_handler(character);
 	}
 }
+#endif /* CONFIG_AT_HOST_UART_ASYNC */
 
 static int at_uart_init(char *uart_dev_name)
 {
@@ -187,13 +306,25 @@ static int at_uart_init(char *uart_dev_name)
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+	err = uart_callback_set(uart_dev, uart_callback, NULL);
+	if (err) {
+		LOG_ERR("Cannot set UART callback: %d", err);
+		return -EINVAL;
+	}
+#else
 	uart_irq_callback_set(uart_dev, isr);
+#endif
 	return err;
 }
 
 static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 {
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+	u8_t *at_read_buff = uart_tx_buf[0];
+#else
 	u8_t at_read_buff[CONFIG_AT_HOST_SOCKET_BUF_SIZE] = {0};
+#endif
 	int err;
 	int r_bytes;
 
@@ -211,18 +342,27 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 		k_mutex_lock(&socket_mutex, K_FOREVER);
 		/* Read AT socket in non-blocking mode. */
 		r_bytes = recv(at_socket_fd, at_read_buff,
-				sizeof(at_read_buff), MSG_DONTWAIT);
+				CONFIG_AT_HOST_SOCKET_BUF_SIZE, MSG_DONTWAIT);
 		k_mutex_unlock(&socket_mutex);
 
 		/* Forward the data over UART if any. */
 		/* If no data, errno is set to EGAIN and we will try again. */
 		if (r_bytes > 0) {
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+			/* Transmit the buffer, and read the next data from
+			 * the modem into the other buffer meanwhile.
+			 */
+			uart_data_send(at_read_buff, r_bytes);
+			at_read_buff = (at_read_buff == uart_tx_buf[0]) ?
+				       uart_tx_buf[1] : uart_tx_buf[0];
+#else
 			/* Poll out what is in the buffer gathered from
 			 * the modem.
 			 */
 			for (size_t i = 0; i < r_bytes; i++) {
 				uart_poll_out(uart_dev, at_read_buff[i]);
 			}
+#endif
 		}
 	}
 }
@@ -283,7 +423,16 @@ static int at_host_init(struct device *arg)
 			socket_thread_fn,
 			NULL, NULL, NULL,
 			THREAD_PRIORITY, 0, K_NO_WAIT);
+#if defined(CONFIG_AT_HOST_UART_ASYNC)
+	k_work_init(&uart_rx_work, uart_rx_process);
+	err = uart_rx_start();
+	if (err) {
+		LOG_ERR("Cannot start UART reception: %d", err);
+		return -EFAULT;
+	}
+#else
 	uart_irq_rx_enable(uart_dev);
+#endif
 
 	return err;
 }
@@ -47,7 +47,13 @@
 
 #define UART_BUF_SIZE           CONFIG_BT_GATT_NUS_UART_BUFFER_SIZE
 
+/* Time to wait for space in the stream buffer before checking that
+ * the connection is still there.
+ */
+#define STREAM_SPACE_TIMEOUT    K_MSEC(100)
+
 static K_SEM_DEFINE(ble_init_ok, 0, 2);
+static K_SEM_DEFINE(stream_space, 0, 1);
 
 static struct bt_conn *current_conn;
 
@@ -273,8 +279,14 @@ static void bt_receive_cb(const u8_t *const data, u16_t len)
 	uart_irq_tx_enable(uart);
 }
 
+static void bt_stream_space_cb(size_t space)
+{
+	k_sem_give(&stream_space);
+}
+
 static struct bt_nus_cb nus_cb = {
-	.received_cb = bt_receive_cb,
+	.received_cb     = bt_receive_cb,
+	.stream_space_cb = bt_stream_space_cb,
 };
 
 static void bt_ready(int err)
@@ -408,8 +420,28 @@ void ble_write_thread(void)
 		struct uart_data_t *buf = k_fifo_get(&fifo_uart_rx_data,
 						     K_FOREVER);
 
-		if (nus_send(buf->data, buf->len)) {
-			printk("Failed to send data over BLE connection\n");
+		for (u16_t pos = 0; pos < buf->len;) {
+			struct bt_conn *conn = current_conn;
+			int queued;
+
+			if (!conn) {
+				printk("Not connected, data dropped\n");
+				break;
+			}
+
+			queued = nus_stream_send(conn, &buf->data[pos],
+						 buf->len - pos);
+			if (queued < 0) {
+				printk("Failed to send data over BLE "
+				       "connection (err: %d)\n", queued);
+				break;
+			}
+
+			pos += queued;
+			if (pos < buf->len) {
+				/* Wait until notifications complete. */
+				k_sem_take(&stream_space, STREAM_SPACE_TIMEOUT);
+			}
 		}
 		k_free(buf);
 	}
@@ -13,6 +13,7 @@
 #include <misc/printk.h>
 #include <string.h>
 #include <zephyr/types.h>
+#include <misc/byteorder.h>
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/conn.h>
@@ -27,6 +28,15 @@
 #define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
 #define INTERVAL_MIN	0x140	/* 320 units, 400 ms */
 #define INTERVAL_MAX	0x140	/* 320 units, 400 ms */
+#define PKT_LEN		244
+#define NOTIFY_TIMEOUT	K_SECONDS(30)
+
+enum test_mode {
+	TEST_WRITE_CMD,
+	TEST_WRITE_REQ,
+	TEST_NOTIFY,
+	TEST_BOTH,
+};
 
 static u16_t char_handle;
 static volatile bool test_ready;
@@ -36,6 +46,14 @@ static struct bt_uuid *uuid128 = BT_UUID_THROUGHPUT;
 static struct bt_gatt_read_params read_param;
 static struct bt_gatt_exchange_params exchange_params;
 static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+static struct bt_gatt_write_params write_params;
+static struct throughput_stats client_stats;
+static u32_t notify_cnt;
+static u8_t write_err;
+static K_SEM_DEFINE(read_done, 0, 1);
+static K_SEM_DEFINE(write_done, 0, 1);
+static K_SEM_DEFINE(notify_done, 0, 1);
 static struct bt_le_conn_param *conn_param =
 	BT_LE_CONN_PARAM(INTERVAL_MIN, INTERVAL_MAX, 0, 400);
 
@@ -88,6 +106,29 @@ static struct bt_scan_cb scan_cb = {
 	.connecting_error = scan_connecting_error,
 };
 
+static u8_t notify_func(struct bt_conn *conn,
+			struct bt_gatt_subscribe_params *params,
+			const void *data, u16_t length)
+{
+	if (!data) {
+		params->value_handle = 0;
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (length == sizeof(struct throughput_pkt_hdr)) {
+		/* Header of a test packet echoed by the peer */
+		throughput_stats_echo(&client_stats, data, length);
+	} else {
+		/* Test packet notified by the peer */
+		throughput_stats_rx(&client_stats, data, length);
+		if (notify_cnt && (client_stats.next_seq == notify_cnt)) {
+			k_sem_give(&notify_done);
+		}
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
 static void exchange_func(struct bt_conn *conn, u8_t err,
 			  struct bt_gatt_exchange_params *params)
 {
@@ -97,6 +138,17 @@ static void exchange_func(struct bt_conn *conn, u8_t err,
 
 	err = bt_conn_get_info(conn, &info);
 	if (info.role == BT_CONN_ROLE_MASTER) {
+		/* The CCC descriptor follows the characteristic value. */
+		subscribe_params.notify = notify_func;
+		subscribe_params.value = BT_GATT_CCC_NOTIFY;
+		subscribe_params.value_handle = char_handle;
+		subscribe_params.ccc_handle = char_handle + 1;
+
+		err = bt_gatt_subscribe(conn, &subscribe_params);
+		if (err) {
+			printk("Subscribe failed (err %d)\n", err);
+		}
+
 		test_ready = true;
 	}
 }
@@ -264,6 +316,7 @@ static u8_t read_fn(struct bt_conn *conn, u8_t err,
 
 	if (err) {
 		printk("GATT read callback failed (err: %d)\n", err);
+		k_sem_give(&read_done);
 		return 0;
 	}
 
@@ -279,9 +332,65 @@ static u8_t read_fn(struct bt_conn *conn, u8_t err,
 		test_ready = true;
 	}
 
+	k_sem_give(&read_done);
+
 	return BT_GATT_ITER_STOP;
 }
 
+static void write_fn(struct bt_conn *conn, u8_t err,
+		     struct bt_gatt_write_params *params)
+{
+	write_err = err;
+	k_sem_give(&write_done);
+}
+
+static int test_write(enum test_mode mode, const void *data, u16_t len)
+{
+	int err;
+
+	if (mode != TEST_WRITE_REQ) {
+		return bt_gatt_write_without_response(default_conn,
+						      char_handle, data, len,
+						      false);
+	}
+
+	/* wait for the Write Response before sending the next packet */
+	write_params.func = write_fn;
+	write_params.handle = char_handle;
+	write_params.offset = 0;
+	write_params.data = data;
+	write_params.length = len;
+
+	err = bt_gatt_write(default_conn, &write_params);
+	if (err) {
+		return err;
+	}
+
+	k_sem_take(&write_done, K_FOREVER);
+
+	return write_err ? -EIO : 0;
+}
+
+static enum test_mode test_mode_get(void)
+{
+	printk("Ready, press a key to start:\n"
+	       " 1 - write without response (default)\n"
+	       " 2 - write with response\n"
+	       " 3 - notifications from the peer\n"
+	       " 4 - write without response and notifications\n");
+
+	switch (console_getchar()) {
+	case '2':
+		return TEST_WRITE_REQ;
+	case '3':
+		return TEST_NOTIFY;
+	case '4':
+		return TEST_BOTH;
+	default:
+		return TEST_WRITE_CMD;
+	}
+}
+
 static void test_run(void)
 {
 	int err;
@@ -289,14 +398,16 @@ static void test_run(void)
 	u32_t delta;
 	u32_t data = 0;
 	u32_t prog = 0;
+	u32_t seq = 0;
+	enum test_mode mode;
+	struct throughput_ctrl ctrl = {0};
 
 	/* a dummy data buffer */
 	static char dummy[256];
 
 
 	/* wait for user input to continue */
-	printk("Ready, press any key to start\n");
-	console_getchar();
+	mode = test_mode_get();
 
 	if (!test_ready) {
 		/* disconnected while blocking inside _getchar() */
@@ -305,16 +416,33 @@ static void test_run(void)
 
 	test_ready = false;
 
-	/* reset peer metrics */
+	throughput_stats_reset(&client_stats);
+	k_sem_reset(&read_done);
+	k_sem_reset(&notify_done);
+
+	notify_cnt = 0;
+	if ((mode == TEST_NOTIFY) || (mode == TEST_BOTH)) {
+		notify_cnt = IMG_SIZE;
+	}
+
+	/* reset peer metrics and request the notified test packets */
+	ctrl.notify_cnt = sys_cpu_to_le32(notify_cnt);
+	ctrl.notify_len = sys_cpu_to_le16(PKT_LEN);
 	err = bt_gatt_write_without_response(
-		default_conn, char_handle, dummy, 1, false);
+		default_conn, char_handle, &ctrl, sizeof(ctrl), false);
+	if (err) {
+		printk("GATT write failed (err %d)\n", err);
+		return;
+	}
 
 	/* get cycle stamp */
 	stamp = k_uptime_get_32();
 
-	while (prog < IMG_SIZE) {
-		err = bt_gatt_write_without_response(
-			default_conn, char_handle, dummy, 244, false);
+	while ((mode != TEST_NOTIFY) && (prog < IMG_SIZE)) {
+		/* the peer checks the sequence and echoes the header */
+		throughput_pkt_fill(dummy, seq++);
+
+		err = test_write(mode, dummy, PKT_LEN);
 		if (err) {
 			printk("GATT write failed (err %d)\n", err);
 			break;
@@ -322,15 +450,22 @@ static void test_run(void)
 
 		/* print graphics */
 		printk("%c", img[prog / IMG_X][prog % IMG_X]);
-		data += 244;
+		data += PKT_LEN;
 		prog++;
 	}
 
+	if (notify_cnt &&
+	    k_sem_take(&notify_done, NOTIFY_TIMEOUT)) {
+		printk("\nTimed out waiting for notifications\n");
+	}
+
 	delta = k_uptime_delta_32(&stamp);
 
 	printk("\nDone\n");
-	printk("[local] sent %u bytes (%u KB) in %u ms at %llu kbps\n",
-	       data, data / 1024, delta, ((u64_t)data * 8 / delta));
+	if (data && delta) {
+		printk("[local] sent %u bytes (%u KB) in %u ms at %llu kbps\n",
+		       data, data / 1024, delta, ((u64_t)data * 8 / delta));
+	}
 
 	/* read back char from peer */
 	read_param.single.handle = char_handle;
@@ -338,7 +473,12 @@ static void test_run(void)
 	err = bt_gatt_read(default_conn, &read_param);
 	if (err) {
 		printk("GATT read failed (err %d)\n", err);
+		return;
 	}
+
+	/* echoes that arrive after the read response are not printed */
+	k_sem_take(&read_done, K_FOREVER);
+	throughput_stats_print("client", &client_stats);
 }
 
 static bool le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
@@ -19,6 +19,9 @@
 
 #include "ndef_file_m.h"
 #include <nfc/ndef/nfc_ndef_msg.h>
+#include <nfc/ndef/nfc_ndef_parser.h>
+#include <nfc/ndef/nfc_text_rec.h>
+#include <nfc/ndef/nfc_uri_rec.h>
 
 #include <soc.h>
 #include <device.h>
@@ -63,6 +66,53 @@ static void flash_buffer_prepare(size_t data_length)
 
 }
 
+static void string_print(u8_t const *str, u32_t len)
+{
+	for (u32_t i = 0; i < len; i++) {
+		printk("%c", str[i]);
+	}
+}
+
+/**
+ * @brief Function for printing the records of an NDEF message.
+ *
+ * The message is parsed in place, and Text and URI records are decoded.
+ */
+static void ndef_msg_print(u8_t const *msg_buf, u32_t msg_len)
+{
+	struct nfc_ndef_parser parser;
+	struct nfc_ndef_parsed_record record;
+	struct nfc_text_rec_payload_desc text;
+	struct uri_payload_desc uri;
+	int err;
+
+	err = nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+	if (err < 0) {
+		printk("Cannot parse NDEF message!\n");
+		return;
+	}
+
+	while ((err = nfc_ndef_parser_next(&parser, &record)) == 0) {
+		if (nfc_text_rec_parse(&record, &text) == 0) {
+			printk("Text record: ");
+			string_print(text.data, text.data_len);
+			printk("\n");
+		} else if (nfc_uri_rec_parse(&record, &uri) == 0) {
+			printk("URI record, identifier code 0x%02x: ",
+			       uri.uri_id_code);
+			string_print(uri.uri_data, uri.uri_data_len);
+			printk("\n");
+		} else {
+			printk("Record with TNF %u and %u bytes of payload.\n",
+			       record.tnf, record.payload_length);
+		}
+	}
+
+	if (err != -ENOENT) {
+		printk("Malformed NDEF message!\n");
+	}
+}
+
 /**
  * @brief Callback function for handling NFC events.
  */
@@ -196,6 +246,7 @@ int main(void)
 		}
 		printk("Default NDEF message restored!\n");
 	}
+	ndef_msg_print(ndef_msg_buf, sizeof(ndef_msg_buf));
 	/* Set up NFC */
 	int err = nfc_t4t_setup(nfc_callback, NULL);
 
@@ -223,6 +274,7 @@ int main(void)
 				printk("Cannot flash NDEF message!\n");
 			} else {
 				printk("NDEF message successfully flashed.\n");
+				ndef_msg_print(flash_buf, flash_buf_len);
 			}
 
 			atomic_set(&op_flags, FLASH_WRITE_FINISHED);
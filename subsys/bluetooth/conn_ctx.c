@@ -9,99 +9,137 @@
 
 LOG_MODULE_REGISTER(bt_conn_ctx, CONFIG_BT_CONN_CTX_LOG_LEVEL);
 
-static void bt_conn_ctx_mem_free(struct k_mem_slab *mem_slab, void **data)
+static struct bt_conn_ctx *ctx_by_conn(struct bt_conn_ctx_lib *ctx_lib,
+				       struct bt_conn *conn)
 {
-	k_mem_slab_free(mem_slab, data);
-	*data = NULL;
-}
+	u8_t index = bt_conn_index(conn);
 
-void *bt_conn_ctx_alloc(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn)
-{
-	__ASSERT_NO_MSG(conn != NULL);
-	__ASSERT_NO_MSG(ctx_lib != NULL);
+	__ASSERT_NO_MSG(index < ARRAY_SIZE(ctx_lib->ctx));
 
-	int err = -ENOMEM;
-	struct bt_conn_ctx *ctx;
+	return &ctx_lib->ctx[index];
+}
 
-	k_mutex_lock(ctx_lib->mutex, K_FOREVER);
+static struct bt_conn_ctx_block_hdr *ctx_block_hdr(void *data)
+{
+	return (struct bt_conn_ctx_block_hdr *)((u8_t *)data -
+						_BT_CONN_CTX_BLOCK_HDR_SIZE);
+}
 
-	for (size_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
-		ctx = &ctx_lib->ctx[i];
+/* Called with interrupts locked, so that the context is not freed before
+ * it is referenced.
+ */
+static void ctx_ref_get(void *data)
+{
+	atomic_inc(&ctx_block_hdr(data)->ref);
+}
 
-		if (!ctx->conn && !ctx->data) {
-			err = k_mem_slab_alloc(ctx_lib->mem_slab,
-					       &ctx->data,
-					       K_NO_WAIT);
-			if (!err) {
-				ctx->conn = conn;
+static void ctx_ref_put(struct bt_conn_ctx_lib *ctx_lib, void *data)
+{
+	struct bt_conn_ctx_block_hdr *hdr = ctx_block_hdr(data);
 
-				LOG_DBG("The memory for the connection context "
-					"has been allocated, conn %p, index: %u",
-					conn, i);
+	__ASSERT_NO_MSG(atomic_get(&hdr->ref) > 0);
 
-				return ctx->data;
+	if (atomic_dec(&hdr->ref) == 1) {
+		void *block = hdr;
 
-			} else {
-				break;
-			}
+		k_mem_slab_free(ctx_lib->mem_slab, &block);
 
-		}
+		LOG_DBG("The context memory has been released");
 	}
+}
 
-	LOG_WRN("Memory can not be allocated");
-	k_mutex_unlock(ctx_lib->mutex);
+/* Detaches the context from the connection slot and drops the reference
+ * of the connection. The slot can be allocated again at once.
+ */
+static void ctx_detach(struct bt_conn_ctx_lib *ctx_lib,
+		       struct bt_conn_ctx *ctx, unsigned int key)
+{
+	void *data = ctx->data;
 
-	return NULL;
+	ctx->data = NULL;
+	ctx->conn = NULL;
+	irq_unlock(key);
+
+	ctx_ref_put(ctx_lib, data);
 }
 
-int bt_conn_ctx_free(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn)
+void *bt_conn_ctx_alloc(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn)
 {
 	__ASSERT_NO_MSG(conn != NULL);
 	__ASSERT_NO_MSG(ctx_lib != NULL);
 
-	k_mutex_lock(ctx_lib->mutex, K_FOREVER);
+	struct bt_conn_ctx *ctx = ctx_by_conn(ctx_lib, conn);
+	struct bt_conn_ctx_block_hdr *hdr;
+	unsigned int key = irq_lock();
+	void *block;
+	int err;
 
-	for (size_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
-		struct bt_conn_ctx *ctx = &ctx_lib->ctx[i];
+	if (ctx->conn) {
+		irq_unlock(key);
+		LOG_WRN("The context of this connection is still in use");
+		return NULL;
+	}
+
+	err = k_mem_slab_alloc(ctx_lib->mem_slab, &block, K_NO_WAIT);
+	if (err) {
+		irq_unlock(key);
+		LOG_WRN("Memory can not be allocated");
+		return NULL;
+	}
 
-		if (ctx->conn == conn) {
-			bt_conn_ctx_mem_free(ctx_lib->mem_slab, &ctx->data);
-			ctx->conn = NULL;
-			ctx->data = NULL;
+	hdr = block;
+	/* One reference for the connection and one for the caller. */
+	atomic_set(&hdr->ref, 2);
 
-			LOG_DBG("The context memory for the connection "
-				"has been released, conn %p index %u",
-				conn, i);
+	ctx->data = (u8_t *)block + _BT_CONN_CTX_BLOCK_HDR_SIZE;
+	ctx->conn = conn;
+	irq_unlock(key);
 
-			k_mutex_unlock(ctx_lib->mutex);
+	LOG_DBG("The memory for the connection context "
+		"has been allocated, conn %p, index: %u",
+		conn, bt_conn_index(conn));
 
-			return 0;
-		}
+	return ctx->data;
+}
+
+int bt_conn_ctx_free(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn)
+{
+	__ASSERT_NO_MSG(conn != NULL);
+	__ASSERT_NO_MSG(ctx_lib != NULL);
+
+	struct bt_conn_ctx *ctx = ctx_by_conn(ctx_lib, conn);
+	unsigned int key = irq_lock();
+
+	if (ctx->conn != conn) {
+		irq_unlock(key);
+		LOG_WRN("There is no allocated memory for this connection");
+		return -EINVAL;
 	}
 
-	LOG_WRN("There is no allocated memory for this connection");
-	k_mutex_unlock(ctx_lib->mutex);
+	/* The memory is freed when the last user releases the context. */
+	ctx_detach(ctx_lib, ctx, key);
+
+	LOG_DBG("The context for the connection has been freed, "
+		"conn %p index %u", conn, bt_conn_index(conn));
 
-	return  -EINVAL;
+	return 0;
 }
 
 void bt_conn_ctx_free_all(struct bt_conn_ctx_lib *ctx_lib)
 {
 	__ASSERT_NO_MSG(ctx_lib != NULL);
 
-	k_mutex_lock(ctx_lib->mutex, K_FOREVER);
-
 	for (size_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
 		struct bt_conn_ctx *ctx = &ctx_lib->ctx[i];
+		unsigned int key = irq_lock();
 
-		if (ctx->data != NULL) {
-			k_mem_slab_free(ctx_lib->mem_slab, &ctx->data);
-			ctx->conn = NULL;
-			ctx->data = NULL;
+		if (ctx->conn == NULL) {
+			irq_unlock(key);
+			continue;
 		}
-	}
 
-	k_mutex_unlock(ctx_lib->mutex);
+		ctx_detach(ctx_lib, ctx, key);
+	}
 
 	LOG_DBG("All allocated memory has been released");
 }
@@ -111,57 +149,78 @@ void *bt_conn_ctx_get(struct bt_conn_ctx_lib *ctx_lib, struct bt_conn *conn)
 	__ASSERT_NO_MSG(conn != NULL);
 	__ASSERT_NO_MSG(ctx_lib != NULL);
 
-	k_mutex_lock(ctx_lib->mutex, K_FOREVER);
-
-	for (size_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
-		struct bt_conn_ctx *ctx = &ctx_lib->ctx[i];
+	struct bt_conn_ctx *ctx = ctx_by_conn(ctx_lib, conn);
+	unsigned int key = irq_lock();
+	void *data = NULL;
 
-		if (ctx->conn == conn) {
-			LOG_DBG("Memory block found for the connection");
-
-			return ctx->data;
-		}
+	if (ctx->conn == conn) {
+		data = ctx->data;
+		ctx_ref_get(data);
 	}
+	irq_unlock(key);
 
-	LOG_WRN("No memory block for connection");
+	if (!data) {
+		LOG_WRN("No memory block for connection");
+		return NULL;
+	}
 
-	k_mutex_unlock(ctx_lib->mutex);
+	LOG_DBG("Memory block found for the connection");
 
-	return NULL;
+	return data;
 }
 
-const struct bt_conn_ctx *bt_conn_ctx_get_by_id(struct bt_conn_ctx_lib *ctx_lib, u8_t id)
+int bt_conn_ctx_get_by_id(struct bt_conn_ctx_lib *ctx_lib, u8_t id,
+			  struct bt_conn_ctx *ctx)
 {
 	__ASSERT_NO_MSG(ctx_lib != NULL);
+	__ASSERT_NO_MSG(ctx != NULL);
 	__ASSERT_NO_MSG(id < bt_conn_ctx_count(ctx_lib));
 
-	k_mutex_lock(ctx_lib->mutex, K_FOREVER);
+	unsigned int key = irq_lock();
 
-	struct bt_conn_ctx *ctx = &ctx_lib->ctx[id];
-
-	if (ctx_lib->ctx[id].conn != NULL) {
-		return ctx;
+	*ctx = ctx_lib->ctx[id];
+	if (ctx->conn == NULL) {
+		irq_unlock(key);
+		return -ENOENT;
 	}
 
-	k_mutex_unlock(ctx_lib->mutex);
+	ctx_ref_get(ctx->data);
+	irq_unlock(key);
 
-	return NULL;
+	return 0;
 }
 
-void bt_conn_ctx_release(struct bt_conn_ctx_lib *ctx_lib, void *ctx_data)
+void bt_conn_ctx_foreach(struct bt_conn_ctx_lib *ctx_lib,
+			 void (*func)(const struct bt_conn_ctx *ctx,
+				      void *user_data),
+			 void *user_data)
 {
 	__ASSERT_NO_MSG(ctx_lib != NULL);
-	__ASSERT_NO_MSG(ctx_data != NULL);
+	__ASSERT_NO_MSG(func != NULL);
 
 	for (size_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
-		struct bt_conn_ctx *ctx = &ctx_lib->ctx[i];
+		struct bt_conn_ctx ctx;
+		unsigned int key = irq_lock();
 
-		if (ctx->data == ctx_data) {
-			k_mutex_unlock(ctx_lib->mutex);
-
-			return;
+		ctx = ctx_lib->ctx[i];
+		if (ctx.conn == NULL) {
+			irq_unlock(key);
+			continue;
 		}
+
+		ctx_ref_get(ctx.data);
+		irq_unlock(key);
+
+		func(&ctx, user_data);
+
+		ctx_ref_put(ctx_lib, ctx.data);
 	}
+}
+
+void bt_conn_ctx_release(struct bt_conn_ctx_lib *ctx_lib, void *ctx_data)
+{
+	__ASSERT_NO_MSG(ctx_lib != NULL);
+	__ASSERT_NO_MSG(ctx_data != NULL);
 
-	__ASSERT_NO_MSG(false);
+	ctx_ref_put(ctx_lib, ctx_data);
 }
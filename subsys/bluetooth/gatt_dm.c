@@ -10,15 +10,20 @@
 
 #include <bluetooth/gatt_dm.h>
 
-LOG_MODULE_REGISTER(bt_gatt_dm, CONFIG_BT_GATT_DM_LOG_LEVEL);
+#if CONFIG_BT_GATT_DM_CACHE
+#include <stdlib.h>
+#include <init.h>
+#include <misc/byteorder.h>
+#include <settings/settings.h>
+#endif
 
-/* Available sizes: 128, 512, 2048... */
-#define CHUNK_SIZE (128 - sizeof(struct k_mem_block_id))
+LOG_MODULE_REGISTER(bt_gatt_dm, CONFIG_BT_GATT_DM_LOG_LEVEL);
 
 /* Flags for parsed attribute array state */
 enum {
 	STATE_ATTRS_LOCKED,
 	STATE_ATTRS_RELEASE_PENDING,
+	STATE_CACHE_STORE,
 	STATE_NUM
 };
 
@@ -38,75 +43,62 @@ struct bt_gatt_dm {
 	/* Flags with the status of the attributes */
 	ATOMIC_DEFINE(state_flags, STATE_NUM);
 
-	/* user data chunks */
+	/* user data arena */
 	struct {
-		/* The pointers to the dynamically allocated memory */
-		u8_t *chunks[CONFIG_BT_GATT_DM_MAX_MEM_CHUNKS];
-		/* Currently processed index */
-		size_t cur_id;
-		/* The used length of the current chunk */
-		size_t cur_len;
-	} data_chunk;
+		/* Memory for the attribute user data and UUIDs */
+		u8_t mem[CONFIG_BT_GATT_DM_ARENA_SIZE] __aligned(sizeof(void *));
+		/* The used length */
+		size_t len;
+	} arena;
 
 	/* The pointer to callback structure */
 	const struct bt_gatt_dm_cb *callback;
+
+#if CONFIG_BT_GATT_DM_CACHE
+	/* Database hash of the peer the discovery is cached with */
+	u8_t db_hash[BT_GATT_DM_DB_HASH_LEN];
+	/* Work reporting a discovery restored from the cache */
+	struct k_work cache_work;
+#endif
 };
 
-/* Currently only one instance is supported */
-static struct bt_gatt_dm bt_gatt_dm_inst;
+/* Instance pool, one discovery can run on each connection at a time */
+static struct bt_gatt_dm bt_gatt_dm_inst[CONFIG_BT_GATT_DM_MAX_INSTANCES];
 
+/* Highest arena usage of all instances */
+static size_t arena_peak;
 
 static void *user_data_store(struct bt_gatt_dm *dm,
 			     const void *user_data,
 			     size_t len)
 {
 	u8_t *user_data_loc;
-	size_t cur_chunk_id = dm->data_chunk.cur_id;
-
-	__ASSERT_NO_MSG(len <= CHUNK_SIZE);
-
-	if (!(dm->data_chunk.chunks[cur_chunk_id])) {
-		dm->data_chunk.chunks[cur_chunk_id] = k_malloc(CHUNK_SIZE);
-		dm->data_chunk.cur_len = 0;
+	size_t offset = ROUND_UP(dm->arena.len, sizeof(void *));
 
-		if (!(dm->data_chunk.chunks[cur_chunk_id])) {
-			return NULL;
-		}
+	if (offset + len > sizeof(dm->arena.mem)) {
+		LOG_ERR("Not enough arena memory");
+		return NULL;
 	}
 
-	if (dm->data_chunk.cur_len + len > CHUNK_SIZE) {
-		cur_chunk_id++;
-		dm->data_chunk.cur_id = cur_chunk_id;
-		if ((dm->data_chunk.chunks[cur_chunk_id]) ||
-		    (cur_chunk_id >= ARRAY_SIZE(dm->data_chunk.chunks))) {
-			LOG_ERR("Not enough data chunks");
-			return NULL;
-		}
+	user_data_loc = &dm->arena.mem[offset];
+	memcpy(user_data_loc, user_data, len);
+	dm->arena.len = offset + len;
 
-		return user_data_store(dm, user_data, len);
+	if (dm->arena.len > arena_peak) {
+		arena_peak = dm->arena.len;
 	}
 
-	user_data_loc =
-		&dm->data_chunk.chunks[cur_chunk_id][dm->data_chunk.cur_len];
-	memcpy(user_data_loc, user_data, len);
-	dm->data_chunk.cur_len += len;
-
 	return user_data_loc;
 }
 
 static void svc_attr_memory_release(struct bt_gatt_dm *dm)
 {
-	LOG_DBG("Attr memory release");
+	LOG_DBG("Attr memory release, arena used: %zu", dm->arena.len);
 	/* Clear attributes */
 	memset(dm->attrs, 0, sizeof(dm->attrs));
 	dm->cur_attr_id = 0;
-	/* Release dynamic memory data chunks */
-	for (size_t i = 0; i <= dm->data_chunk.cur_id; i++) {
-		k_free(dm->data_chunk.chunks[i]);
-		dm->data_chunk.chunks[i] = NULL;
-	}
-	dm->data_chunk.cur_id = 0;
-	dm->data_chunk.cur_len = 0;
+	/* Release the arena */
+	dm->arena.len = 0;
 }
 
 static struct bt_gatt_attr *attr_store(struct bt_gatt_dm *dm,
@@ -217,9 +209,345 @@ static struct bt_uuid *uuid_store(struct bt_gatt_dm *dm,
 	}
 }
 
+#if CONFIG_BT_GATT_DM_CACHE
+
+#define CACHE_KEY_PREFIX "bt_dm"
+#define CACHE_KEY_LEN (sizeof(CACHE_KEY_PREFIX) + 4)
+
+/* Cached discovery, the stored part of it ends at the used data length */
+struct dm_cache_entry {
+	bt_addr_le_t addr;
+	u8_t db_hash[BT_GATT_DM_DB_HASH_LEN];
+	/* Length of the used data, 0 if the entry is empty */
+	u16_t len;
+	/* Service UUID followed by the encoded attributes */
+	u8_t data[CONFIG_BT_GATT_DM_CACHE_DATA_SIZE];
+};
+
+static struct dm_cache_slot {
+	struct dm_cache_entry entry;
+	/* Sequence number of the last use, for replacement */
+	u32_t last_used;
+	/* The entry changed and is not saved in settings yet */
+	bool save_pending;
+} dm_cache[CONFIG_BT_GATT_DM_CACHE_SIZE];
+
+static u32_t dm_cache_seq;
+
+K_MUTEX_DEFINE(dm_cache_mutex);
+
+/* Storage of a decoded UUID of any supported type */
+union dm_cache_uuid {
+	struct bt_uuid uuid;
+	struct bt_uuid_16 u16;
+	struct bt_uuid_128 u128;
+};
+
+struct dm_cache_buf {
+	u8_t *data;
+	size_t size;
+	size_t off;
+	bool err;
+};
+
+static void cache_put_u8(struct dm_cache_buf *buf, u8_t val)
+{
+	if (buf->off + sizeof(val) > buf->size) {
+		buf->err = true;
+		return;
+	}
+	buf->data[buf->off++] = val;
+}
+
+static void cache_put_u16(struct dm_cache_buf *buf, u16_t val)
+{
+	if (buf->off + sizeof(val) > buf->size) {
+		buf->err = true;
+		return;
+	}
+	sys_put_le16(val, &buf->data[buf->off]);
+	buf->off += sizeof(val);
+}
+
+static void cache_put_uuid(struct dm_cache_buf *buf,
+			   const struct bt_uuid *uuid)
+{
+	cache_put_u8(buf, uuid->type);
+
+	switch (uuid->type) {
+	case BT_UUID_TYPE_16:
+		cache_put_u16(buf, BT_UUID_16(uuid)->val);
+		break;
+	case BT_UUID_TYPE_128:
+		if (buf->off + sizeof(BT_UUID_128(uuid)->val) > buf->size) {
+			buf->err = true;
+			break;
+		}
+		memcpy(&buf->data[buf->off], BT_UUID_128(uuid)->val,
+		       sizeof(BT_UUID_128(uuid)->val));
+		buf->off += sizeof(BT_UUID_128(uuid)->val);
+		break;
+	default:
+		buf->err = true;
+		break;
+	}
+}
+
+static u8_t cache_get_u8(struct dm_cache_buf *buf)
+{
+	if (buf->off + sizeof(u8_t) > buf->size) {
+		buf->err = true;
+		return 0;
+	}
+	return buf->data[buf->off++];
+}
+
+static u16_t cache_get_u16(struct dm_cache_buf *buf)
+{
+	u16_t val;
+
+	if (buf->off + sizeof(val) > buf->size) {
+		buf->err = true;
+		return 0;
+	}
+	val = sys_get_le16(&buf->data[buf->off]);
+	buf->off += sizeof(val);
+
+	return val;
+}
+
+static void cache_get_uuid(struct dm_cache_buf *buf,
+			   union dm_cache_uuid *uuid)
+{
+	uuid->uuid.type = cache_get_u8(buf);
+
+	switch (uuid->uuid.type) {
+	case BT_UUID_TYPE_16:
+		uuid->u16.val = cache_get_u16(buf);
+		break;
+	case BT_UUID_TYPE_128:
+		if (buf->off + sizeof(uuid->u128.val) > buf->size) {
+			buf->err = true;
+			break;
+		}
+		memcpy(uuid->u128.val, &buf->data[buf->off],
+		       sizeof(uuid->u128.val));
+		buf->off += sizeof(uuid->u128.val);
+		break;
+	default:
+		buf->err = true;
+		break;
+	}
+}
+
+static void cache_key_get(const struct dm_cache_slot *slot, char *key)
+{
+	snprintk(key, CACHE_KEY_LEN, CACHE_KEY_PREFIX "/%u",
+		 (unsigned int)(slot - dm_cache));
+}
+
+/* Entries are saved from the system workqueue, so that the flash is not
+ * written from the Bluetooth RX thread.
+ */
+static void cache_save_work_handler(struct k_work *work)
+{
+	/* Copy of the entry, so that the mutex is not held while saving */
+	static struct dm_cache_entry entry;
+	char key[CACHE_KEY_LEN];
+
+	for (size_t i = 0; i < ARRAY_SIZE(dm_cache); i++) {
+		struct dm_cache_slot *slot = &dm_cache[i];
+		bool save;
+		int err;
+
+		k_mutex_lock(&dm_cache_mutex, K_FOREVER);
+		save = slot->save_pending;
+		if (save) {
+			slot->save_pending = false;
+			memcpy(&entry, &slot->entry,
+			       offsetof(struct dm_cache_entry, data) +
+			       slot->entry.len);
+		}
+		k_mutex_unlock(&dm_cache_mutex);
+
+		if (!save) {
+			continue;
+		}
+
+		cache_key_get(slot, key);
+		if (entry.len) {
+			err = settings_save_one(key, &entry,
+					offsetof(struct dm_cache_entry, data) +
+					entry.len);
+		} else {
+			err = settings_save_one(key, NULL, 0);
+		}
+
+		if (err) {
+			LOG_ERR("Cannot store discovery cache (err %d)", err);
+		}
+	}
+}
+
+static K_WORK_DEFINE(cache_save_work, cache_save_work_handler);
+
+/* Called with dm_cache_mutex held */
+static void cache_slot_save(struct dm_cache_slot *slot)
+{
+	slot->save_pending = true;
+	k_work_submit(&cache_save_work);
+}
+
+static void cache_slot_remove(struct dm_cache_slot *slot)
+{
+	slot->entry.len = 0;
+	cache_slot_save(slot);
+}
+
+/* Size of the service UUID at the start of the entry data */
+static size_t cache_svc_uuid_encode(const struct bt_uuid *svc_uuid,
+				    u8_t *data, size_t size)
+{
+	struct dm_cache_buf buf = {
+		.data = data,
+		.size = size,
+	};
+
+	cache_put_uuid(&buf, svc_uuid);
+
+	return buf.err ? 0 : buf.off;
+}
+
+static struct dm_cache_slot *cache_find(const bt_addr_le_t *addr,
+					const u8_t *db_hash,
+					const struct bt_uuid *svc_uuid)
+{
+	u8_t svc[1 + sizeof(BT_UUID_128(svc_uuid)->val)];
+	size_t svc_len = cache_svc_uuid_encode(svc_uuid, svc, sizeof(svc));
+
+	for (size_t i = 0; i < ARRAY_SIZE(dm_cache); i++) {
+		const struct dm_cache_entry *entry = &dm_cache[i].entry;
+
+		if ((entry->len >= svc_len) &&
+		    !bt_addr_le_cmp(&entry->addr, addr) &&
+		    !memcmp(entry->data, svc, svc_len) &&
+		    (!db_hash ||
+		     !memcmp(entry->db_hash, db_hash, sizeof(entry->db_hash)))) {
+			return &dm_cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct dm_cache_slot *cache_slot_get(const bt_addr_le_t *addr,
+					    const struct bt_uuid *svc_uuid)
+{
+	struct dm_cache_slot *slot;
+
+	/* Replace the entry of the same service, whatever its hash */
+	slot = cache_find(addr, NULL, svc_uuid);
+	if (slot) {
+		return slot;
+	}
+
+	slot = &dm_cache[0];
+	for (size_t i = 0; i < ARRAY_SIZE(dm_cache); i++) {
+		if (!dm_cache[i].entry.len) {
+			return &dm_cache[i];
+		}
+		if (dm_cache[i].last_used < slot->last_used) {
+			slot = &dm_cache[i];
+		}
+	}
+
+	return slot;
+}
+
+/* The cache is keyed by the peer address, which identifies the peer only
+ * if it is bonded.
+ */
+static bool cache_peer_bonded(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	if (bt_conn_get_info(conn, &info)) {
+		return false;
+	}
+
+	return bt_addr_le_is_bonded(info.id, bt_conn_get_dst(conn));
+}
+
+static void cache_store(struct bt_gatt_dm *dm)
+{
+	const bt_addr_le_t *addr = bt_conn_get_dst(dm->conn);
+	const struct bt_uuid *svc_uuid =
+		bt_gatt_dm_attr_service_val(&dm->attrs[0])->uuid;
+	struct dm_cache_slot *slot;
+	struct dm_cache_buf buf;
+
+	if (!cache_peer_bonded(dm->conn)) {
+		LOG_DBG("Peer not bonded, discovery not cached");
+		return;
+	}
+
+	k_mutex_lock(&dm_cache_mutex, K_FOREVER);
+
+	slot = cache_slot_get(addr, svc_uuid);
+	buf.data = slot->entry.data;
+	buf.size = sizeof(slot->entry.data);
+	buf.off = 0;
+	buf.err = false;
+
+	cache_put_uuid(&buf, svc_uuid);
+
+	for (size_t i = 0; i < dm->cur_attr_id; i++) {
+		const struct bt_gatt_attr *attr = &dm->attrs[i];
+		const struct bt_gatt_service_val *service_val;
+		const struct bt_gatt_chrc *chrc;
+
+		cache_put_u16(&buf, attr->handle);
+		cache_put_uuid(&buf, attr->uuid);
+
+		service_val = bt_gatt_dm_attr_service_val(attr);
+		chrc = bt_gatt_dm_attr_chrc_val(attr);
+		if (service_val) {
+			cache_put_u16(&buf, service_val->end_handle);
+			cache_put_uuid(&buf, service_val->uuid);
+		} else if (chrc) {
+			cache_put_u8(&buf, chrc->properties);
+			cache_put_uuid(&buf, chrc->uuid);
+		}
+	}
+
+	if (buf.err) {
+		LOG_WRN("Discovery does not fit in the cache");
+		if (slot->entry.len) {
+			cache_slot_remove(slot);
+		}
+	} else {
+		bt_addr_le_copy(&slot->entry.addr, addr);
+		memcpy(slot->entry.db_hash, dm->db_hash,
+		       sizeof(slot->entry.db_hash));
+		slot->entry.len = buf.off;
+		slot->last_used = ++dm_cache_seq;
+		cache_slot_save(slot);
+		LOG_DBG("Discovery cached, %zu bytes", buf.off);
+	}
+
+	k_mutex_unlock(&dm_cache_mutex);
+}
+
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
 static void discovery_complete(struct bt_gatt_dm *dm)
 {
 	LOG_DBG("Discovery complete.");
+#if CONFIG_BT_GATT_DM_CACHE
+	if (atomic_test_and_clear_bit(dm->state_flags, STATE_CACHE_STORE)) {
+		cache_store(dm);
+	}
+#endif
 	atomic_set_bit(dm->state_flags, STATE_ATTRS_RELEASE_PENDING);
 	if (dm->callback->completed) {
 		dm->callback->completed(dm, dm->context);
@@ -273,12 +601,16 @@ static u8_t discovery_process_service(struct bt_gatt_dm *dm,
 	cur_attr->uuid = uuid_store(dm, attr->uuid);
 	service_val = user_data_store(dm, service_val,
 				      sizeof(*service_val));
+	if (!cur_attr->uuid || !service_val) {
+		LOG_ERR("Not enough memory for service attribute data.");
+		discovery_complete_error(dm, -ENOMEM);
+		return BT_GATT_ITER_STOP;
+	}
+
 	service_val->uuid = uuid_store(dm, service_val->uuid);
 	cur_attr->user_data = service_val;
-
-	if (!cur_attr->uuid || !service_val ||
-	    !service_val->uuid) {
-		LOG_ERR("Not enough memory for service attribute data.");
+	if (!service_val->uuid) {
+		LOG_ERR("Not enough memory for service UUID.");
 		discovery_complete_error(dm, -ENOMEM);
 		return BT_GATT_ITER_STOP;
 	}
@@ -366,9 +698,18 @@ static u8_t discovery_process_characteristic(
 
 	gatt_chrc = attr->user_data;
 	gatt_chrc = user_data_store(dm, gatt_chrc, sizeof(*gatt_chrc));
+	if (!gatt_chrc) {
+		LOG_ERR("Not enough memory for characteristic at handle %u.",
+			attr->handle);
+		discovery_complete_error(dm, -ENOMEM);
+		return BT_GATT_ITER_STOP;
+	}
+
 	gatt_chrc->uuid = uuid_store(dm, gatt_chrc->uuid);
 	cur_attr->user_data = gatt_chrc;
-	if (!gatt_chrc || !gatt_chrc->uuid) {
+	if (!gatt_chrc->uuid) {
+		LOG_ERR("Not enough memory for UUID at handle %u.",
+			attr->handle);
 		discovery_complete_error(dm, -ENOMEM);
 		return BT_GATT_ITER_STOP;
 	}
@@ -380,13 +721,16 @@ static u8_t discovery_callback(struct bt_conn *conn,
 			       const struct bt_gatt_attr *attr,
 			       struct bt_gatt_discover_params *params)
 {
+	struct bt_gatt_dm *dm =
+		CONTAINER_OF(params, struct bt_gatt_dm, discover_params);
+
 	if (!attr) {
 		LOG_DBG("NULL attribute");
 	} else {
 		LOG_DBG("Attr: handle %u", attr->handle);
 	}
 
-	if (conn != bt_gatt_dm_inst.conn) {
+	if (conn != dm->conn) {
 		LOG_ERR("Unexpected conn object. Aborting.");
 		return BT_GATT_ITER_STOP;
 	}
@@ -394,15 +738,11 @@ static u8_t discovery_callback(struct bt_conn *conn,
 	switch (params->type) {
 	case BT_GATT_DISCOVER_PRIMARY:
 	case BT_GATT_DISCOVER_SECONDARY:
-		return discovery_process_service(&bt_gatt_dm_inst,
-						 attr, params);
+		return discovery_process_service(dm, attr, params);
 	case BT_GATT_DISCOVER_DESCRIPTOR:
-		return discovery_process_descriptor(&bt_gatt_dm_inst,
-						    attr, params);
+		return discovery_process_descriptor(dm, attr, params);
 	case BT_GATT_DISCOVER_CHARACTERISTIC:
-		return discovery_process_characteristic(&bt_gatt_dm_inst,
-							attr,
-							params);
+		return discovery_process_characteristic(dm, attr, params);
 	default:
 		/* This should not be possible */
 		__ASSERT(false, "Unknown param type.");
@@ -536,14 +876,42 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
 	return curr;
 }
 
+static int dm_alloc(struct bt_conn *conn, struct bt_gatt_dm **dm_out)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(bt_gatt_dm_inst); i++) {
+		struct bt_gatt_dm *dm = &bt_gatt_dm_inst[i];
 
-int bt_gatt_dm_start(struct bt_conn *conn,
-		     const struct bt_uuid *svc_uuid,
-		     const struct bt_gatt_dm_cb *cb,
-		     void *context)
+		if (atomic_test_bit(dm->state_flags, STATE_ATTRS_LOCKED) &&
+		    (dm->conn == conn)) {
+			/* Discovery already in progress on this link */
+			return -EALREADY;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(bt_gatt_dm_inst); i++) {
+		struct bt_gatt_dm *dm = &bt_gatt_dm_inst[i];
+
+		/* An instance taken in the meantime by another thread is
+		 * skipped.
+		 */
+		if (!atomic_test_and_set_bit(dm->state_flags,
+					     STATE_ATTRS_LOCKED)) {
+			*dm_out = dm;
+			return 0;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+static int dm_prepare(struct bt_conn *conn,
+		      const struct bt_uuid *svc_uuid,
+		      const struct bt_gatt_dm_cb *cb,
+		      void *context,
+		      struct bt_gatt_dm **dm_out)
 {
-	int err;
 	struct bt_gatt_dm *dm;
+	int err;
 
 	if (svc_uuid &&
 	    (svc_uuid->type != BT_UUID_TYPE_16) &&
@@ -555,18 +923,17 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 		return -EINVAL;
 	}
 
-	dm = &bt_gatt_dm_inst;
-
-	if (atomic_test_and_set_bit(dm->state_flags, STATE_ATTRS_LOCKED)) {
-		return -EALREADY;
+	err = dm_alloc(conn, &dm);
+	if (err) {
+		return err;
 	}
 
 	dm->conn = conn;
 	dm->context = context;
 	dm->callback = cb;
 	dm->cur_attr_id = 0;
-	dm->data_chunk.cur_len = 0;
-	dm->data_chunk.cur_id = 0;
+	dm->arena.len = 0;
+	atomic_clear_bit(dm->state_flags, STATE_CACHE_STORE);
 
 	dm->discover_params.uuid = svc_uuid ? uuid_store(dm, svc_uuid) : NULL;
 	dm->discover_params.func = discovery_callback;
@@ -574,7 +941,16 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 	dm->discover_params.end_handle = 0xffff;
 	dm->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
 
-	err = bt_gatt_discover(conn, &dm->discover_params);
+	*dm_out = dm;
+
+	return 0;
+}
+
+static int dm_discover(struct bt_gatt_dm *dm)
+{
+	int err;
+
+	err = bt_gatt_discover(dm->conn, &dm->discover_params);
 	if (err) {
 		LOG_ERR("Discover failed, error: %d.", err);
 		atomic_clear_bit(dm->state_flags, STATE_ATTRS_LOCKED);
@@ -583,6 +959,262 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 	return err;
 }
 
+int bt_gatt_dm_start(struct bt_conn *conn,
+		     const struct bt_uuid *svc_uuid,
+		     const struct bt_gatt_dm_cb *cb,
+		     void *context)
+{
+	int err;
+	struct bt_gatt_dm *dm;
+
+	err = dm_prepare(conn, svc_uuid, cb, context, &dm);
+	if (err) {
+		return err;
+	}
+
+	return dm_discover(dm);
+}
+
+#if CONFIG_BT_GATT_DM_CACHE
+
+static int cache_restore(struct bt_gatt_dm *dm,
+			 struct dm_cache_entry *entry)
+{
+	union dm_cache_uuid uuid;
+	struct dm_cache_buf buf = {
+		.data = entry->data,
+		.size = entry->len,
+	};
+
+	/* Skip the service UUID the entry is looked up with */
+	cache_get_uuid(&buf, &uuid);
+
+	while (!buf.err && (buf.off < buf.size)) {
+		struct bt_gatt_attr attr = { 0 };
+		struct bt_gatt_attr *cur_attr;
+		union dm_cache_uuid val_uuid;
+
+		attr.handle = cache_get_u16(&buf);
+		cache_get_uuid(&buf, &uuid);
+		attr.uuid = &uuid.uuid;
+
+		if (buf.err) {
+			break;
+		}
+
+		cur_attr = attr_store(dm, &attr);
+		if (!cur_attr) {
+			return -ENOMEM;
+		}
+		cur_attr->uuid = uuid_store(dm, attr.uuid);
+		if (!cur_attr->uuid) {
+			return -ENOMEM;
+		}
+
+		if (!bt_uuid_cmp(BT_UUID_GATT_PRIMARY, attr.uuid) ||
+		    !bt_uuid_cmp(BT_UUID_GATT_SECONDARY, attr.uuid)) {
+			struct bt_gatt_service_val *service_val;
+			struct bt_gatt_service_val val;
+
+			val.end_handle = cache_get_u16(&buf);
+			cache_get_uuid(&buf, &val_uuid);
+			if (buf.err) {
+				break;
+			}
+
+			service_val = user_data_store(dm, &val, sizeof(val));
+			if (!service_val) {
+				return -ENOMEM;
+			}
+			service_val->uuid = uuid_store(dm, &val_uuid.uuid);
+			if (!service_val->uuid) {
+				return -ENOMEM;
+			}
+			cur_attr->user_data = service_val;
+		} else if (!bt_uuid_cmp(BT_UUID_GATT_CHRC, attr.uuid)) {
+			struct bt_gatt_chrc *gatt_chrc;
+			struct bt_gatt_chrc val;
+
+			val.properties = cache_get_u8(&buf);
+			cache_get_uuid(&buf, &val_uuid);
+			if (buf.err) {
+				break;
+			}
+
+			gatt_chrc = user_data_store(dm, &val, sizeof(val));
+			if (!gatt_chrc) {
+				return -ENOMEM;
+			}
+			gatt_chrc->uuid = uuid_store(dm, &val_uuid.uuid);
+			if (!gatt_chrc->uuid) {
+				return -ENOMEM;
+			}
+			cur_attr->user_data = gatt_chrc;
+		}
+	}
+
+	if (buf.err || !dm->cur_attr_id ||
+	    !bt_gatt_dm_attr_service_val(&dm->attrs[0])) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void cache_work_handler(struct k_work *work)
+{
+	struct bt_gatt_dm *dm = CONTAINER_OF(work, struct bt_gatt_dm,
+					     cache_work);
+
+	discovery_complete(dm);
+}
+
+int bt_gatt_dm_start_cached(struct bt_conn *conn,
+			    const struct bt_uuid *svc_uuid,
+			    const u8_t *db_hash,
+			    const struct bt_gatt_dm_cb *cb,
+			    void *context)
+{
+	int err;
+	struct bt_gatt_dm *dm;
+	struct dm_cache_slot *slot;
+
+	if (!svc_uuid) {
+		return -EINVAL;
+	}
+
+	err = dm_prepare(conn, svc_uuid, cb, context, &dm);
+	if (err) {
+		return err;
+	}
+
+	if (db_hash) {
+		memcpy(dm->db_hash, db_hash, sizeof(dm->db_hash));
+	} else {
+		memset(dm->db_hash, 0, sizeof(dm->db_hash));
+	}
+
+	if (!cache_peer_bonded(conn)) {
+		LOG_DBG("Peer not bonded, cache not used");
+		return dm_discover(dm);
+	}
+
+	k_mutex_lock(&dm_cache_mutex, K_FOREVER);
+
+	slot = cache_find(bt_conn_get_dst(conn), dm->db_hash, svc_uuid);
+	if (slot) {
+		err = cache_restore(dm, &slot->entry);
+		if (!err) {
+			/* Leave the state as after an over-the-air discovery */
+			dm->discover_params.uuid = NULL;
+			dm->discover_params.end_handle =
+				bt_gatt_dm_attr_service_val(
+					&dm->attrs[0])->end_handle;
+
+			slot->last_used = ++dm_cache_seq;
+			k_mutex_unlock(&dm_cache_mutex);
+
+			LOG_DBG("Discovery restored from cache");
+			k_work_init(&dm->cache_work, cache_work_handler);
+			k_work_submit(&dm->cache_work);
+
+			return 0;
+		}
+
+		/* Drop the broken entry and discover over the air */
+		LOG_WRN("Cannot restore discovery from cache (err %d)", err);
+		cache_slot_remove(slot);
+		k_mutex_unlock(&dm_cache_mutex);
+
+		svc_attr_memory_release(dm);
+		atomic_clear_bit(dm->state_flags, STATE_ATTRS_LOCKED);
+
+		return bt_gatt_dm_start_cached(conn, svc_uuid, db_hash, cb,
+					       context);
+	}
+
+	k_mutex_unlock(&dm_cache_mutex);
+
+	atomic_set_bit(dm->state_flags, STATE_CACHE_STORE);
+
+	return dm_discover(dm);
+}
+
+void bt_gatt_dm_cache_clear(const bt_addr_le_t *addr)
+{
+	k_mutex_lock(&dm_cache_mutex, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(dm_cache); i++) {
+		struct dm_cache_slot *slot = &dm_cache[i];
+
+		if (slot->entry.len &&
+		    (!addr || !bt_addr_le_cmp(&slot->entry.addr, addr))) {
+			cache_slot_remove(slot);
+		}
+	}
+
+	k_mutex_unlock(&dm_cache_mutex);
+}
+
+static int cache_settings_set(int argc, char **argv, void *val_ctx)
+{
+	struct dm_cache_slot *slot;
+	unsigned long id;
+	char *end;
+	int len;
+
+	if (argc != 1) {
+		return -ENOENT;
+	}
+
+	id = strtoul(argv[0], &end, 10);
+	if ((*end != '\0') || (id >= ARRAY_SIZE(dm_cache))) {
+		LOG_WRN("Cache entry %s not supported", argv[0]);
+		return 0;
+	}
+
+	slot = &dm_cache[id];
+	len = settings_val_read_cb(val_ctx, &slot->entry,
+				   sizeof(slot->entry));
+	if ((len < (int)offsetof(struct dm_cache_entry, data)) ||
+	    (slot->entry.len !=
+	     len - offsetof(struct dm_cache_entry, data))) {
+		/* Removed or corrupted entry */
+		slot->entry.len = 0;
+	}
+	slot->last_used = 0;
+
+	return 0;
+}
+
+static int cache_init(struct device *dev)
+{
+	static struct settings_handler sh = {
+		.name = CACHE_KEY_PREFIX,
+		.h_set = cache_settings_set,
+	};
+	int err;
+
+	ARG_UNUSED(dev);
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Cannot initialize settings (err %d)", err);
+		return err;
+	}
+
+	err = settings_register(&sh);
+	if (err) {
+		LOG_ERR("Cannot register settings handler (err %d)", err);
+	}
+
+	return err;
+}
+
+SYS_INIT(cache_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif /* CONFIG_BT_GATT_DM_CACHE */
+
 int bt_gatt_dm_continue(struct bt_gatt_dm *dm, void *context)
 {
 	int err;
@@ -618,6 +1250,11 @@ int bt_gatt_dm_continue(struct bt_gatt_dm *dm, void *context)
 	return err;
 }
 
+size_t bt_gatt_dm_arena_peak_get(void)
+{
+	return arena_peak;
+}
+
 int bt_gatt_dm_data_release(struct bt_gatt_dm *dm)
 {
 	if (!atomic_test_and_clear_bit(dm->state_flags,
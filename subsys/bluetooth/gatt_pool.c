@@ -9,6 +9,12 @@
 struct svc_el_pool {
 	void *elements;
 	atomic_t *locks;
+#if CONFIG_BT_GATT_POOL_STATS != 0
+	/* Number of taken elements */
+	atomic_t cnt;
+	/* Highest number of taken elements */
+	atomic_t peak;
+#endif
 };
 
 #if CONFIG_BT_GATT_UUID16_POOL_SIZE != 0
@@ -93,19 +99,61 @@ static struct svc_el_pool ccc_pool = {
 #define ADDR_2_INDEX(pool, el)                                                 \
 	((((u32_t)el) - ((u32_t)pool)) / (sizeof(pool[0])))
 
+#define LOCK_BITS (sizeof(atomic_t) * 8)
+
+static void pool_usage_inc(struct svc_el_pool *el_pool)
+{
+#if CONFIG_BT_GATT_POOL_STATS != 0
+	atomic_val_t cnt = atomic_inc(&el_pool->cnt) + 1;
+	atomic_val_t peak;
+
+	do {
+		peak = atomic_get(&el_pool->peak);
+	} while ((cnt > peak) && !atomic_cas(&el_pool->peak, peak, cnt));
+#endif
+}
+
+static void pool_usage_dec(struct svc_el_pool *el_pool)
+{
+#if CONFIG_BT_GATT_POOL_STATS != 0
+	atomic_dec(&el_pool->cnt);
+#endif
+}
+
 static size_t free_element_find(struct svc_el_pool *el_pool, size_t el_cnt)
 {
 	__ASSERT((el_pool->elements != NULL) && (el_pool->locks != NULL),
 		 "Pool uninitialized");
 
-	for (size_t i = 0; i < el_cnt; i++) {
-		if (!atomic_test_and_set_bit(el_pool->locks, i)) {
-			return i;
+	/* Take the first clear bit of each lock word, without a lock */
+	for (size_t word = 0; word * LOCK_BITS < el_cnt; word++) {
+		atomic_t *lock = &el_pool->locks[word];
+		atomic_val_t val;
+		size_t bit;
+
+		do {
+			val = atomic_get(lock);
+			bit = find_lsb_set(~val);
+			if ((bit == 0) ||
+			    (word * LOCK_BITS + bit - 1 >= el_cnt)) {
+				break;
+			}
+		} while (!atomic_cas(lock, val, val | BIT(bit - 1)));
+
+		if ((bit != 0) && (word * LOCK_BITS + bit - 1 < el_cnt)) {
+			pool_usage_inc(el_pool);
+			return word * LOCK_BITS + bit - 1;
 		}
 	}
 	return el_cnt;
 }
 
+static void element_release(struct svc_el_pool *el_pool, size_t ind)
+{
+	atomic_clear_bit(el_pool->locks, ind);
+	pool_usage_dec(el_pool);
+}
+
 static void uuid_16_get(struct bt_uuid **uuid, struct svc_el_pool *uuid_pool)
 {
 	size_t ind = free_element_find(uuid_pool,
@@ -156,8 +204,7 @@ static void chrc_get(struct bt_gatt_chrc **chrc)
 static void chrc_release(struct bt_gatt_chrc const *chrc)
 {
 	EL_IN_POOL_VERIFY(BT_GATT_CHRC_TAB, chrc);
-	atomic_clear_bit(chrc_pool.locks,
-			 ADDR_2_INDEX(BT_GATT_CHRC_TAB, chrc));
+	element_release(&chrc_pool, ADDR_2_INDEX(BT_GATT_CHRC_TAB, chrc));
 }
 
 static void ccc_get(struct _bt_gatt_ccc **ccc)
@@ -173,8 +220,7 @@ static void ccc_get(struct _bt_gatt_ccc **ccc)
 static void ccc_release(struct _bt_gatt_ccc const *ccc)
 {
 	EL_IN_POOL_VERIFY(BT_GATT_CCC_TAB, ccc);
-	atomic_clear_bit(ccc_pool.locks,
-			 ADDR_2_INDEX(BT_GATT_CCC_TAB, ccc));
+	element_release(&ccc_pool, ADDR_2_INDEX(BT_GATT_CCC_TAB, ccc));
 }
 
 static void uuid_register(struct bt_uuid **dest_uuid,
@@ -209,24 +255,24 @@ static void uuid_unregister(struct bt_uuid const *uuid)
 	case BT_UUID_TYPE_16:
 		EL_IN_POOL_VERIFY(BT_UUID_16_TAB, uuid);
 #if CONFIG_BT_GATT_UUID16_POOL_SIZE != 0
-		atomic_clear_bit(uuid_16_pool.locks,
-				 ADDR_2_INDEX(BT_UUID_16_TAB, uuid));
+		element_release(&uuid_16_pool,
+				ADDR_2_INDEX(BT_UUID_16_TAB, uuid));
 #endif
 		break;
 
 	case BT_UUID_TYPE_32:
 		EL_IN_POOL_VERIFY(BT_UUID_32_TAB, uuid);
 #if CONFIG_BT_GATT_UUID32_POOL_SIZE != 0
-		atomic_clear_bit(uuid_32_pool.locks,
-				 ADDR_2_INDEX(BT_UUID_32_TAB, uuid));
+		element_release(&uuid_32_pool,
+				ADDR_2_INDEX(BT_UUID_32_TAB, uuid));
 #endif
 		break;
 
 	case BT_UUID_TYPE_128:
 		EL_IN_POOL_VERIFY(BT_UUID_128_TAB, uuid);
 #if CONFIG_BT_GATT_UUID128_POOL_SIZE != 0
-		atomic_clear_bit(uuid_128_pool.locks,
-				 ADDR_2_INDEX(BT_UUID_128_TAB, uuid));
+		element_release(&uuid_128_pool,
+				ADDR_2_INDEX(BT_UUID_128_TAB, uuid));
 #endif
 		break;
 
@@ -351,71 +397,45 @@ void bt_gatt_pool_ccc_put(struct bt_gatt_attr const *attr)
 }
 
 #if CONFIG_BT_GATT_POOL_STATS != 0
-static size_t mask_print(atomic_t *mask, size_t mask_size)
+static void pool_usage_get(struct bt_gatt_pool_usage *usage,
+			   struct svc_el_pool *el_pool, size_t size)
 {
-	size_t used_el_cnt = 0;
+	usage->size = size;
+	usage->cnt = atomic_get(&el_pool->cnt);
+	usage->peak = atomic_get(&el_pool->peak);
+}
 
-	for (size_t i = 0; i < mask_size; i++) {
-		u32_t state_part = mask[mask_size - i - 1];
+void bt_gatt_pool_stats_get(struct bt_gatt_pool_stats *stats)
+{
+	pool_usage_get(&stats->uuid_16, &uuid_16_pool,
+		       CONFIG_BT_GATT_UUID16_POOL_SIZE);
+	pool_usage_get(&stats->uuid_32, &uuid_32_pool,
+		       CONFIG_BT_GATT_UUID32_POOL_SIZE);
+	pool_usage_get(&stats->uuid_128, &uuid_128_pool,
+		       CONFIG_BT_GATT_UUID128_POOL_SIZE);
+	pool_usage_get(&stats->chrc, &chrc_pool,
+		       CONFIG_BT_GATT_CHRC_POOL_SIZE);
+	pool_usage_get(&stats->ccc, &ccc_pool,
+		       CONFIG_BT_GATT_CCC_POOL_SIZE);
+}
 
-		printk("%08X", state_part);
-		used_el_cnt += popcount(state_part);
-	}
-	return used_el_cnt;
+static void usage_print(const char *name,
+			const struct bt_gatt_pool_usage *usage)
+{
+	printk("%s Pool element usage: %u out of %u, peak %u\n", name,
+	       usage->cnt, usage->size, usage->peak);
 }
 
 void bt_gatt_pool_stats_print(void)
 {
-	size_t used_el_cnt;
+	struct bt_gatt_pool_stats stats;
 
-#if CONFIG_BT_GATT_UUID16_POOL_SIZE != 0
-	printk("UUID 16 Pool. Locked elements mask:\n");
+	bt_gatt_pool_stats_get(&stats);
 
-	used_el_cnt = mask_print(BT_UUID_16_LOCKS,
-				 ARRAY_SIZE(BT_UUID_16_LOCKS));
-
-	printk("\nPool element usage: %d out of %d\n\n", used_el_cnt,
-	       CONFIG_BT_GATT_UUID16_POOL_SIZE);
-#endif
-
-#if CONFIG_BT_GATT_UUID32_POOL_SIZE != 0
-	printk("UUID 32 Pool. Locked elements mask:\n");
-
-	used_el_cnt = mask_print(BT_UUID_32_LOCKS,
-				 ARRAY_SIZE(BT_UUID_32_LOCKS));
-
-	printk("\nPool element usage: %d out of %d\n\n", used_el_cnt,
-	       CONFIG_BT_GATT_UUID32_POOL_SIZE);
-#endif
-
-#if CONFIG_BT_GATT_UUID128_POOL_SIZE != 0
-	printk("UUID 128 Pool. Locked elements mask:\n");
-
-	used_el_cnt = mask_print(BT_UUID_128_LOCKS,
-				 ARRAY_SIZE(BT_UUID_128_LOCKS));
-
-	printk("\nPool element usage: %d out of %d\n\n", used_el_cnt,
-	       CONFIG_BT_GATT_UUID128_POOL_SIZE);
-#endif
-
-#if CONFIG_BT_GATT_CHRC_POOL_SIZE != 0
-	printk("Characteristic Pool. Locked elements mask:\n");
-
-	used_el_cnt = mask_print(BT_GATT_CHRC_LOCKS,
-				 ARRAY_SIZE(BT_GATT_CHRC_LOCKS));
-
-	printk("\nPool element usage: %d out of %d\n\n", used_el_cnt,
-	       CONFIG_BT_GATT_CHRC_POOL_SIZE);
-#endif
-
-#if CONFIG_BT_GATT_CCC_POOL_SIZE != 0
-	printk("CCC Pool. Locked elements mask:\n");
-
-	used_el_cnt = mask_print(BT_GATT_CCC_LOCKS,
-				 ARRAY_SIZE(BT_GATT_CCC_LOCKS));
-
-	printk("\nPool element usage: %d out of %d\n\n", used_el_cnt,
-	       CONFIG_BT_GATT_CCC_POOL_SIZE);
-#endif
+	usage_print("UUID 16", &stats.uuid_16);
+	usage_print("UUID 32", &stats.uuid_32);
+	usage_print("UUID 128", &stats.uuid_128);
+	usage_print("Characteristic", &stats.chrc);
+	usage_print("CCC", &stats.ccc);
 }
 #endif
@@ -7,6 +7,7 @@
 #include <zephyr.h>
 #include <misc/byteorder.h>
 #include <string.h>
+#include <stdlib.h>
 #include <bluetooth/scan.h>
 
 #include <logging/log.h>
@@ -18,9 +19,49 @@ LOG_MODULE_REGISTER(nrf_bt_scan, CONFIG_BT_SCAN_LOG_LEVEL);
 	BT_SCAN_SHORT_NAME_FILTER | BT_SCAN_APPEARANCE_FILTER | \
 	BT_SCAN_UUID_FILTER)
 
+/* Size of the hash tables of the compiled filters. Kept above twice the
+ * number of entries so that probe sequences stay short.
+ */
+#define ADDR_HASH_SIZE (2 * CONFIG_BT_SCAN_ADDRESS_CNT + 1)
+#define NAME_HASH_SIZE (2 * CONFIG_BT_SCAN_NAME_CNT + 1)
+
+#define FNV_SEED 2166136261U
+#define FNV_PRIME 16777619U
+
+BUILD_ASSERT_MSG(CONFIG_BT_SCAN_UUID_CNT <= 32,
+		 "UUID filter match mask is 32 bits wide");
+
 /* Scan filter add mutex. */
 K_MUTEX_DEFINE(scan_add_mutex);
 
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+/* Device table mutex. */
+K_MUTEX_DEFINE(device_table_mutex);
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
+/* Duplicate report cache entry. */
+struct bt_scan_dup_entry {
+	/* Device address. */
+	bt_addr_le_t addr;
+
+	/* Hash of the advertising type and data of the last forwarded
+	 * report.
+	 */
+	u32_t ad_hash;
+
+	/* Time when a report was last forwarded. */
+	u32_t forwarded;
+
+	/* Time when the entry was last used, for the LRU replacement. */
+	u32_t used;
+
+	/* RSSI of the last forwarded report. */
+	s8_t rssi;
+
+	/* Entry holds valid data. */
+	bool valid;
+};
+
 /* Scanning control structure used to
  * compare matching filters, their mode and event generation.
  */
@@ -34,6 +75,9 @@ struct bt_scan_control {
 	/* Indicates whether at least one filter has been fitted. */
 	bool filter_match;
 
+	/* UUID filters found in the advertising data. */
+	u32_t uuid_match_mask;
+
 	/* Indicates in which mode filters operate. */
 	bool all_mode;
 
@@ -171,6 +215,51 @@ struct bt_scan_filters {
 	bool all_mode;
 };
 
+/* Filters compiled into lookup structures. Rebuilt whenever the filter
+ * set or the enabled filters change, so that an advertising report is
+ * evaluated in a single pass without per-report setup.
+ */
+struct bt_scan_compiled {
+	/* Enabled filter types, see @ref BT_SCAN_FILTER_MODE. */
+	u8_t mode;
+
+	/* Number of enabled filter types. */
+	u8_t filter_cnt;
+
+	/* Filter mode. */
+	bool all_mode;
+
+	/* Address filter hash table. Entries are filter index + 1,
+	 * 0 marks a free slot.
+	 */
+	u8_t addr_hash[ADDR_HASH_SIZE];
+
+	/* Name filter hash table, same layout as the address table. */
+	u8_t name_hash[NAME_HASH_SIZE];
+
+	/* Name filter lengths. */
+	u8_t name_len[CONFIG_BT_SCAN_NAME_CNT];
+
+	/* Short name filter lengths. */
+	u8_t short_name_len[CONFIG_BT_SCAN_SHORT_NAME_CNT];
+
+	/* UUID filter values grouped by type, with their filter index. */
+	u16_t uuid16[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid16_idx[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid16_cnt;
+
+	u32_t uuid32[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid32_idx[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid32_cnt;
+
+	const u8_t *uuid128[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid128_idx[CONFIG_BT_SCAN_UUID_CNT];
+	u8_t uuid128_cnt;
+
+	/* Mask of all UUID filters, used in the multifilter mode. */
+	u32_t uuid_all_mask;
+};
+
 /* Scan module instance. Options for the different scanning modes.
  * This structure stores all module settings. It is used to enable
  * or disable scanning modes and to configure filters.
@@ -179,6 +268,36 @@ static struct bt_scan {
 	/* Filter data. */
 	struct bt_scan_filters scan_filters;
 
+	/* Compiled filter data. */
+	struct bt_scan_compiled compiled;
+
+#if CONFIG_BT_SCAN_DUPLICATE_FILTER
+	/* Duplicate report cache. */
+	struct bt_scan_dup_entry dup_cache[CONFIG_BT_SCAN_DUPLICATE_CACHE_SIZE];
+
+	/* Duplicate report cache statistics. */
+	struct bt_scan_dup_stats dup_stats;
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+	/* Tracked devices. Entries below device_cnt are in use. */
+	struct bt_scan_device_entry devices[CONFIG_BT_SCAN_DEVICE_TABLE_SIZE];
+
+	/* Number of tracked devices. */
+	u8_t device_cnt;
+
+	/* Periodic snapshot work. */
+	struct k_delayed_work snapshot_work;
+
+	/* Copy of the table passed to the snapshot callbacks, so that they
+	 * run without the table locked.
+	 */
+	struct bt_scan_device_entry snapshot[CONFIG_BT_SCAN_DEVICE_TABLE_SIZE];
+
+	/* The snapshot work has been initialized. */
+	bool snapshot_work_ready;
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
 	/* If set to true, the module automatically connects
 	 * after a filter match.
 	 */
@@ -288,40 +407,6 @@ static void scan_connect_with_target(struct bt_scan_control *control,
 	}
 }
 
-static bool adv_addr_compare(const bt_addr_le_t *target_addr)
-{
-	const bt_addr_le_t *addr =
-			bt_scan.scan_filters.addr.target_addr;
-	u8_t counter = bt_scan.scan_filters.addr.cnt;
-
-	for (size_t i = 0; i < counter; i++) {
-		if (bt_addr_le_cmp(target_addr, &addr[i]) == 0) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static bool is_addr_filter_enabled(void)
-{
-	return bt_scan.scan_filters.addr.enabled;
-}
-
-static void check_addr(struct bt_scan_control *control,
-		       const bt_addr_le_t *addr)
-{
-	if (is_addr_filter_enabled()) {
-		if (adv_addr_compare(addr)) {
-			control->filter_match_cnt++;
-
-			/* Information about the filters matched. */
-			control->filter_status.address = true;
-			control->filter_match = true;
-		}
-	}
-}
-
 static int scan_addr_filter_add(const bt_addr_le_t *target_addr)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
@@ -357,51 +442,6 @@ static int scan_addr_filter_add(const bt_addr_le_t *target_addr)
 	return 0;
 }
 
-static bool adv_name_cmp(const u8_t *data,
-			 u8_t data_len,
-			 const char *target_name)
-{
-	return strncmp(target_name, data, data_len) == 0;
-}
-
-static bool adv_name_compare(const struct bt_data *data)
-{
-	struct bt_scan_name_filter const *name_filter =
-			&bt_scan.scan_filters.name;
-	u8_t counter = bt_scan.scan_filters.name.cnt;
-	u8_t data_len = data->data_len;
-
-	/* Compare the name found with the name filter. */
-	for (size_t i = 0; i < counter; i++) {
-		if (adv_name_cmp(data->data,
-				 data_len,
-				 name_filter->target_name[i])) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static bool is_name_filter_enabled(void)
-{
-	return bt_scan.scan_filters.name.enabled;
-}
-
-static void name_check(struct bt_scan_control *control,
-		       const struct bt_data *data)
-{
-	if (is_name_filter_enabled()) {
-		if (adv_name_compare(data)) {
-			control->filter_match_cnt++;
-
-			/* Information about the filters matched. */
-			control->filter_status.name = true;
-			control->filter_match = true;
-		}
-	}
-}
-
 static int scan_name_filter_add(const char *name)
 {
 	u8_t counter = bt_scan.scan_filters.name.cnt;
@@ -427,6 +467,8 @@ static int scan_name_filter_add(const char *name)
 	}
 
 	/* Add name to filter. */
+	memset(bt_scan.scan_filters.name.target_name[counter], 0,
+	       CONFIG_BT_SCAN_NAME_MAX_LEN);
 	memcpy(bt_scan.scan_filters.name.target_name[counter],
 	       name, name_len);
 
@@ -437,58 +479,6 @@ static int scan_name_filter_add(const char *name)
 	return 0;
 }
 
-static bool adv_short_name_cmp(const u8_t *data,
-			       u8_t data_len,
-			       const char *target_name,
-			       u8_t short_name_min_len)
-{
-	if ((data_len >= short_name_min_len) &&
-	    (strncmp(target_name, data, data_len) == 0)) {
-		return true;
-	}
-
-	return false;
-}
-
-static bool adv_short_name_compare(const struct bt_data *data)
-{
-	const struct bt_scan_short_name_filter *name_filter =
-			&bt_scan.scan_filters.short_name;
-	u8_t counter = bt_scan.scan_filters.short_name.cnt;
-	u8_t data_len = data->data_len;
-
-	/* Compare the name found with the name filters. */
-	for (size_t i = 0; i < counter; i++) {
-		if (adv_short_name_cmp(data->data,
-				       data_len,
-				       name_filter->name[i].target_name,
-				       name_filter->name[i].min_len)) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static bool is_short_name_filter_enabled(void)
-{
-	return bt_scan.scan_filters.short_name.enabled;
-}
-
-static void short_name_check(struct bt_scan_control *control,
-			     const struct bt_data *data)
-{
-	if (is_short_name_filter_enabled()) {
-		if (adv_short_name_compare(data)) {
-			control->filter_match_cnt++;
-
-			/* Information about the filters matched. */
-			control->filter_status.short_name = true;
-			control->filter_match = true;
-		}
-	}
-}
-
 static int scan_short_name_filter_add(const struct bt_scan_short_name *short_name)
 {
 	u8_t counter =
@@ -520,6 +510,8 @@ static int scan_short_name_filter_add(const struct bt_scan_short_name *short_nam
 
 	/* Add name to the filter. */
 	short_name_filter->name[counter].min_len = short_name->min_len;
+	memset(short_name_filter->name[counter].target_name, 0,
+	       CONFIG_BT_SCAN_SHORT_NAME_MAX_LEN);
 	memcpy(short_name_filter->name[counter].target_name,
 	       short_name->name,
 	       name_len);
@@ -531,125 +523,6 @@ static int scan_short_name_filter_add(const struct bt_scan_short_name *short_nam
 	return 0;
 }
 
-static bool find_uuid(const u8_t *data,
-		      u8_t data_len,
-		      u8_t uuid_type,
-		      const struct bt_scan_uuid *target_uuid)
-{
-	u8_t uuid_len;
-
-	switch (uuid_type) {
-	case BT_UUID_TYPE_16:
-		uuid_len = sizeof(u16_t);
-		break;
-
-	case BT_UUID_TYPE_32:
-		uuid_len = sizeof(u32_t);
-		break;
-
-	case BT_UUID_TYPE_128:
-		uuid_len = BT_SCAN_UUID_128_SIZE * sizeof(u8_t);
-		break;
-
-	default:
-		return false;
-	}
-
-	for (size_t i = 0; i < data_len; i += uuid_len) {
-		struct bt_uuid *uuid;
-		u16_t uuid_16;
-		u32_t uuid_32;
-		struct bt_uuid_128 uuid_128 = {
-			.uuid.type = BT_UUID_TYPE_128,
-		};
-
-
-		switch (uuid_type) {
-		case BT_UUID_TYPE_16:
-			memcpy(&uuid_16, &data[i], uuid_len);
-			uuid = BT_UUID_DECLARE_16(sys_le16_to_cpu(uuid_16));
-			break;
-
-		case BT_UUID_TYPE_32:
-			memcpy(&uuid_32, &data[i], uuid_len);
-			uuid = BT_UUID_DECLARE_32(sys_le32_to_cpu(uuid_32));
-			break;
-
-		case BT_UUID_TYPE_128:
-			memcpy(uuid_128.val, &data[i], uuid_len);
-			uuid = (struct bt_uuid *)&uuid_128;
-			break;
-
-		default:
-			return false;
-		}
-
-		if (bt_uuid_cmp(uuid, target_uuid->uuid) == 0) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static bool adv_uuid_compare(const struct bt_data *data, u8_t uuid_type)
-{
-	const struct bt_scan_uuid_filter *uuid_filter =
-			&bt_scan.scan_filters.uuid;
-	const bool all_filters_mode = bt_scan.scan_filters.all_mode;
-	const u8_t counter = bt_scan.scan_filters.uuid.cnt;
-	u8_t data_len = data->data_len;
-	u8_t uuid_match_cnt = 0;
-
-	for (size_t i = 0; i < counter; i++) {
-
-		if (find_uuid(data->data, data_len, uuid_type,
-			      &uuid_filter->uuid[i])) {
-			uuid_match_cnt++;
-
-			/* In the normal filter mode,
-			 * only one UUID is needed to match.
-			 */
-			if (!all_filters_mode) {
-				break;
-			}
-
-		} else if (all_filters_mode) {
-			break;
-		}
-	}
-
-	/* In the multifilter mode, all UUIDs must be found in
-	 * the advertisement packets.
-	 */
-	if ((all_filters_mode && (uuid_match_cnt == counter)) ||
-	    ((!all_filters_mode) && (uuid_match_cnt > 0))) {
-		return true;
-	}
-
-	return false;
-}
-
-static bool is_uuid_filter_enabled(void)
-{
-	return bt_scan.scan_filters.uuid.enabled;
-}
-
-static void uuid_check(struct bt_scan_control *control,
-		       const struct bt_data *data,
-		       u8_t type)
-{
-	if (is_uuid_filter_enabled()) {
-		if (adv_uuid_compare(data, type)) {
-			control->filter_match_cnt++;
-
-			/* Information about the filters matched. */
-			control->filter_status.uuid = true;
-			control->filter_match = true;
-		}
-	}
-}
-
 static int scan_uuid_filter_add(struct bt_uuid *uuid)
 {
 	struct bt_scan_uuid *uuid_filter = bt_scan.scan_filters.uuid.uuid;
@@ -706,89 +579,184 @@ static int scan_uuid_filter_add(struct bt_uuid *uuid)
 	return 0;
 }
 
-static bool find_appearance(const u8_t *data,
-			    u8_t data_len,
-			    const u16_t *appearance)
+static int scan_appearance_filter_add(u16_t appearance)
 {
-	if (data_len != sizeof(u16_t)) {
-		return false;
+	u16_t *appearance_filter = bt_scan.scan_filters.appearance.appearance;
+	u8_t counter = bt_scan.scan_filters.appearance.cnt;
+
+	/* If no memory. */
+	if (counter >= CONFIG_BT_SCAN_APPEARANCE_CNT) {
+		return -ENOMEM;
 	}
 
-	u16_t decoded_appearance = sys_get_be16(data);
+	/* Check for duplicated filter. */
+	for (size_t i = 0; i < counter; i++) {
+		if (appearance_filter[i] == appearance) {
+			return 0;
+		}
+	}
+
+	/* Add appearance to the filter. */
+	appearance_filter[counter] = appearance;
+	bt_scan.scan_filters.appearance.cnt++;
+
+	LOG_DBG("Added filter on appearance %x", appearance);
+
+	return 0;
+}
+
+static u32_t fnv_hash(const u8_t *data, size_t len)
+{
+	u32_t hash = FNV_SEED;
 
-	if (decoded_appearance == *appearance) {
-		return true;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
 	}
 
-	/* Could not find the appearance among the encoded data. */
-	return false;
+	return hash;
 }
 
-static bool adv_appearance_compare(const struct bt_data *data)
+static u32_t addr_hash(const bt_addr_le_t *addr)
 {
-	const struct bt_scan_appearance_filter *appearance_filter =
-			&bt_scan.scan_filters.appearance;
-	const u8_t counter =
-			bt_scan.scan_filters.appearance.cnt;
-	u8_t data_len = data->data_len;
+	return fnv_hash((const u8_t *)addr, sizeof(*addr));
+}
 
-	/* Verify if the advertised appearance matches
-	 * the provided appearance.
-	 */
-	for (size_t i = 0; i < counter; i++) {
-		if (find_appearance(data->data,
-				    data_len,
-				    &appearance_filter->appearance[i])) {
-			return true;
-		}
+/* Insert a filter index in a hash table using linear probing. */
+static void hash_insert(u8_t *table, size_t size, u32_t hash, u8_t idx)
+{
+	size_t slot = hash % size;
+
+	while (table[slot] != 0) {
+		slot = (slot + 1) % size;
 	}
 
-	return false;
+	table[slot] = idx + 1;
 }
 
-static bool is_appearance_filter_enabled(void)
+static void addr_filter_compile(struct bt_scan_compiled *compiled)
 {
-	return bt_scan.scan_filters.appearance.enabled;
+	const struct bt_scan_addr_filter *filter = &bt_scan.scan_filters.addr;
+
+	memset(compiled->addr_hash, 0, sizeof(compiled->addr_hash));
+
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		hash_insert(compiled->addr_hash, ADDR_HASH_SIZE,
+			    addr_hash(&filter->target_addr[i]), i);
+	}
 }
 
-static void appearance_check(struct bt_scan_control *control,
-			     const struct bt_data *data)
+static void name_filter_compile(struct bt_scan_compiled *compiled)
 {
-	if (is_appearance_filter_enabled()) {
-		if (adv_appearance_compare(data)) {
-			control->filter_match_cnt++;
+	const struct bt_scan_name_filter *filter = &bt_scan.scan_filters.name;
 
-			/* Information about the filters matched. */
-			control->filter_status.appearance = true;
-			control->filter_match = true;
-		}
+	memset(compiled->name_hash, 0, sizeof(compiled->name_hash));
+
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		compiled->name_len[i] = strnlen(filter->target_name[i],
+						CONFIG_BT_SCAN_NAME_MAX_LEN);
+		hash_insert(compiled->name_hash, NAME_HASH_SIZE,
+			    fnv_hash(filter->target_name[i],
+				     compiled->name_len[i]),
+			    i);
 	}
 }
 
-static int scan_appearance_filter_add(u16_t appearance)
+static void short_name_filter_compile(struct bt_scan_compiled *compiled)
 {
-	u16_t *appearance_filter = bt_scan.scan_filters.appearance.appearance;
-	u8_t counter = bt_scan.scan_filters.appearance.cnt;
+	const struct bt_scan_short_name_filter *filter =
+			&bt_scan.scan_filters.short_name;
 
-	/* If no memory. */
-	if (counter >= CONFIG_BT_SCAN_APPEARANCE_CNT) {
-		return -ENOMEM;
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		compiled->short_name_len[i] =
+			strnlen(filter->name[i].target_name,
+				CONFIG_BT_SCAN_SHORT_NAME_MAX_LEN);
 	}
+}
 
-	/* Check for duplicated filter. */
-	for (size_t i = 0; i < counter; i++) {
-		if (appearance_filter[i] == appearance) {
-			return 0;
+static void uuid_filter_compile(struct bt_scan_compiled *compiled)
+{
+	const struct bt_scan_uuid_filter *filter = &bt_scan.scan_filters.uuid;
+
+	compiled->uuid16_cnt = 0;
+	compiled->uuid32_cnt = 0;
+	compiled->uuid128_cnt = 0;
+	compiled->uuid_all_mask = 0;
+
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		const struct bt_uuid *uuid = filter->uuid[i].uuid;
+
+		switch (uuid->type) {
+		case BT_UUID_TYPE_16:
+			compiled->uuid16[compiled->uuid16_cnt] =
+					BT_UUID_16(uuid)->val;
+			compiled->uuid16_idx[compiled->uuid16_cnt++] = i;
+			break;
+
+		case BT_UUID_TYPE_32:
+			compiled->uuid32[compiled->uuid32_cnt] =
+					BT_UUID_32(uuid)->val;
+			compiled->uuid32_idx[compiled->uuid32_cnt++] = i;
+			break;
+
+		case BT_UUID_TYPE_128:
+			compiled->uuid128[compiled->uuid128_cnt] =
+					BT_UUID_128(uuid)->val;
+			compiled->uuid128_idx[compiled->uuid128_cnt++] = i;
+			break;
+
+		default:
+			continue;
 		}
+
+		compiled->uuid_all_mask |= BIT(i);
 	}
+}
 
-	/* Add appearance to the filter. */
-	appearance_filter[counter] = appearance;
-	bt_scan.scan_filters.appearance.cnt++;
+/* Rebuild the compiled filters. Must be called with scan_add_mutex held. */
+static void filters_compile(void)
+{
+	const struct bt_scan_filters *filters = &bt_scan.scan_filters;
+	struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	u8_t mode = 0;
+	u8_t filter_cnt = 0;
+
+	/* Disable matching while the tables are rebuilt. */
+	compiled->mode = 0;
+
+	addr_filter_compile(compiled);
+	name_filter_compile(compiled);
+	short_name_filter_compile(compiled);
+	uuid_filter_compile(compiled);
+
+	if (filters->addr.enabled) {
+		mode |= BT_SCAN_ADDR_FILTER;
+		filter_cnt++;
+	}
 
-	LOG_DBG("Added filter on appearance %x", appearance);
+	if (filters->name.enabled) {
+		mode |= BT_SCAN_NAME_FILTER;
+		filter_cnt++;
+	}
 
-	return 0;
+	if (filters->short_name.enabled) {
+		mode |= BT_SCAN_SHORT_NAME_FILTER;
+		filter_cnt++;
+	}
+
+	if (filters->uuid.enabled) {
+		mode |= BT_SCAN_UUID_FILTER;
+		filter_cnt++;
+	}
+
+	if (filters->appearance.enabled) {
+		mode |= BT_SCAN_APPEARANCE_FILTER;
+		filter_cnt++;
+	}
+
+	compiled->all_mode = filters->all_mode;
+	compiled->filter_cnt = filter_cnt;
+	compiled->mode = mode;
 }
 
 static bool check_filter_mode(u8_t mode)
@@ -859,6 +827,10 @@ int bt_scan_filter_add(enum bt_scan_filter_type type,
 		break;
 	}
 
+	if (!err) {
+		filters_compile();
+	}
+
 	k_mutex_unlock(&scan_add_mutex);
 
 	return err;
@@ -888,10 +860,12 @@ void bt_scan_filter_remove_all(void)
 			&bt_scan.scan_filters.appearance;
 	appearance_filter->cnt = 0;
 
+	filters_compile();
+
 	k_mutex_unlock(&scan_add_mutex);
 }
 
-void bt_scan_filter_disable(void)
+static void scan_filter_disable(void)
 {
 	/* Disable all filters. */
 	bt_scan.scan_filters.name.enabled = false;
@@ -901,6 +875,16 @@ void bt_scan_filter_disable(void)
 	bt_scan.scan_filters.appearance.enabled = false;
 }
 
+void bt_scan_filter_disable(void)
+{
+	k_mutex_lock(&scan_add_mutex, K_FOREVER);
+
+	scan_filter_disable();
+	filters_compile();
+
+	k_mutex_unlock(&scan_add_mutex);
+}
+
 int bt_scan_filter_enable(u8_t mode, bool match_all)
 {
 	/* Check if the mode is correct. */
@@ -908,8 +892,10 @@ int bt_scan_filter_enable(u8_t mode, bool match_all)
 		return -EINVAL;
 	}
 
+	k_mutex_lock(&scan_add_mutex, K_FOREVER);
+
 	/* Disable filters. */
-	bt_scan_filter_disable();
+	scan_filter_disable();
 
 	struct bt_scan_filters *filters = &bt_scan.scan_filters;
 
@@ -937,6 +923,11 @@ int bt_scan_filter_enable(u8_t mode, bool match_all)
 	/* Select the filter mode. */
 	filters->all_mode = match_all;
 
+	/* Compile the filters for matching. */
+	filters_compile();
+
+	k_mutex_unlock(&scan_add_mutex);
+
 	return 0;
 }
 
@@ -968,10 +959,149 @@ int bt_scan_stop(void)
 	return bt_le_scan_stop();
 }
 
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+static struct bt_scan_device_entry *device_entry_get(const bt_addr_le_t *addr)
+{
+	struct bt_scan_device_entry *lru;
+
+	for (size_t i = 0; i < bt_scan.device_cnt; i++) {
+		if (bt_addr_le_cmp(&bt_scan.devices[i].addr, addr) == 0) {
+			return &bt_scan.devices[i];
+		}
+	}
+
+	if (bt_scan.device_cnt < ARRAY_SIZE(bt_scan.devices)) {
+		lru = &bt_scan.devices[bt_scan.device_cnt++];
+	} else {
+		/* Replace the device that was seen least recently. */
+		lru = &bt_scan.devices[0];
+
+		for (size_t i = 1; i < ARRAY_SIZE(bt_scan.devices); i++) {
+			if ((s32_t)(bt_scan.devices[i].last_seen -
+				    lru->last_seen) < 0) {
+				lru = &bt_scan.devices[i];
+			}
+		}
+	}
+
+	memset(lru, 0, sizeof(*lru));
+	bt_addr_le_copy(&lru->addr, addr);
+
+	return lru;
+}
+
+static void device_table_update(const bt_addr_le_t *addr, s8_t rssi,
+				u8_t type, const struct net_buf_simple *ad)
+{
+	struct bt_scan_device_entry *entry;
+	u32_t now = k_uptime_get_32();
+
+	k_mutex_lock(&device_table_mutex, K_FOREVER);
+
+	entry = device_entry_get(addr);
+
+	if (entry->report_cnt == 0) {
+		entry->first_seen = now;
+		entry->rssi_min = rssi;
+		entry->rssi_max = rssi;
+	} else {
+		entry->rssi_min = MIN(entry->rssi_min, rssi);
+		entry->rssi_max = MAX(entry->rssi_max, rssi);
+	}
+
+	entry->last_seen = now;
+	entry->report_cnt++;
+	entry->rssi_sum += rssi;
+	entry->adv_type = type;
+	entry->ad_len = MIN(ad->len, sizeof(entry->ad));
+	memcpy(entry->ad, ad->data, entry->ad_len);
+
+	k_mutex_unlock(&device_table_mutex);
+}
+
+void bt_scan_device_table_foreach(
+		bool (*func)(const struct bt_scan_device_entry *entry,
+			     void *user_data),
+		void *user_data)
+{
+	k_mutex_lock(&device_table_mutex, K_FOREVER);
+
+	for (size_t i = 0; i < bt_scan.device_cnt; i++) {
+		if (!func(&bt_scan.devices[i], user_data)) {
+			break;
+		}
+	}
+
+	k_mutex_unlock(&device_table_mutex);
+}
+
+void bt_scan_device_table_clear(void)
+{
+	k_mutex_lock(&device_table_mutex, K_FOREVER);
+
+	bt_scan.device_cnt = 0;
+
+	k_mutex_unlock(&device_table_mutex);
+}
+
+static void notify_device_snapshot(size_t cnt)
+{
+	struct bt_scan_cb *cb;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&callback_list, cb, node) {
+		if (cb->device_snapshot) {
+			cb->device_snapshot(bt_scan.snapshot, cnt);
+		}
+	}
+}
+
+static void snapshot_work_handler(struct k_work *work)
+{
+	size_t cnt;
+
+	/* Copy the table, so that the callbacks do not block the reception
+	 * of advertising reports and can call the scanning API.
+	 */
+	k_mutex_lock(&device_table_mutex, K_FOREVER);
+	cnt = bt_scan.device_cnt;
+	memcpy(bt_scan.snapshot, bt_scan.devices,
+	       cnt * sizeof(bt_scan.snapshot[0]));
+	k_mutex_unlock(&device_table_mutex);
+
+	notify_device_snapshot(cnt);
+
+	k_delayed_work_submit(&bt_scan.snapshot_work,
+			      CONFIG_BT_SCAN_DEVICE_TABLE_SNAPSHOT_INTERVAL);
+}
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
 void bt_scan_init(const struct bt_scan_init_param *init)
 {
 	/* Disable all scanning filters. */
 	memset(&bt_scan.scan_filters, 0, sizeof(bt_scan.scan_filters));
+	memset(&bt_scan.compiled, 0, sizeof(bt_scan.compiled));
+
+#if CONFIG_BT_SCAN_DUPLICATE_FILTER
+	bt_scan_dup_cache_clear();
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+	bt_scan_device_table_clear();
+
+	if (CONFIG_BT_SCAN_DEVICE_TABLE_SNAPSHOT_INTERVAL > 0) {
+		/* The work can be pending if the module is initialized
+		 * again, so it is initialized only once. Submitting it again
+		 * restarts the interval.
+		 */
+		if (!bt_scan.snapshot_work_ready) {
+			k_delayed_work_init(&bt_scan.snapshot_work,
+					    snapshot_work_handler);
+			bt_scan.snapshot_work_ready = true;
+		}
+		k_delayed_work_submit(&bt_scan.snapshot_work,
+			CONFIG_BT_SCAN_DEVICE_TABLE_SNAPSHOT_INTERVAL);
+	}
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
 
 	/* If the pointer to the initialization structure exist,
 	 * use it to scan the configuration.
@@ -1001,74 +1131,293 @@ void bt_scan_init(const struct bt_scan_init_param *init)
 	}
 }
 
-static void check_enabled_filters(struct bt_scan_control *control)
+/* Check if the outcome of the filtering is known. In the multifilter mode,
+ * this is when all enabled filters are matched. Otherwise, when one
+ * filter is matched.
+ */
+static bool filter_decided(const struct bt_scan_control *control)
+{
+	if (control->all_mode) {
+		return control->filter_match_cnt == control->filter_cnt;
+	}
+
+	return control->filter_match;
+}
+
+static void filter_matched(struct bt_scan_control *control, u8_t filter)
+{
+	control->filter_match_cnt++;
+	control->filter_match = true;
+
+	/* Information about the filters matched. */
+	switch (filter) {
+	case BT_SCAN_ADDR_FILTER:
+		control->filter_status.address = true;
+		break;
+
+	case BT_SCAN_NAME_FILTER:
+		control->filter_status.name = true;
+		break;
+
+	case BT_SCAN_SHORT_NAME_FILTER:
+		control->filter_status.short_name = true;
+		break;
+
+	case BT_SCAN_UUID_FILTER:
+		control->filter_status.uuid = true;
+		break;
+
+	case BT_SCAN_APPEARANCE_FILTER:
+		control->filter_status.appearance = true;
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void check_addr(struct bt_scan_control *control,
+		       const bt_addr_le_t *addr)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	const bt_addr_le_t *target = bt_scan.scan_filters.addr.target_addr;
+	size_t slot = addr_hash(addr) % ADDR_HASH_SIZE;
+
+	while (compiled->addr_hash[slot] != 0) {
+		u8_t idx = compiled->addr_hash[slot] - 1;
+
+		if (bt_addr_le_cmp(addr, &target[idx]) == 0) {
+			filter_matched(control, BT_SCAN_ADDR_FILTER);
+			return;
+		}
+
+		slot = (slot + 1) % ADDR_HASH_SIZE;
+	}
+}
+
+static void name_check(struct bt_scan_control *control,
+		       const u8_t *data, u8_t data_len)
 {
-	control->filter_cnt = 0;
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	size_t slot = fnv_hash(data, data_len) % NAME_HASH_SIZE;
+
+	while (compiled->name_hash[slot] != 0) {
+		u8_t idx = compiled->name_hash[slot] - 1;
 
-	if (is_addr_filter_enabled()) {
-		control->filter_cnt++;
+		if ((compiled->name_len[idx] == data_len) &&
+		    (memcmp(bt_scan.scan_filters.name.target_name[idx],
+			    data, data_len) == 0)) {
+			filter_matched(control, BT_SCAN_NAME_FILTER);
+			return;
+		}
+
+		slot = (slot + 1) % NAME_HASH_SIZE;
 	}
+}
+
+static void short_name_check(struct bt_scan_control *control,
+			     const u8_t *data, u8_t data_len)
+{
+	const struct bt_scan_short_name_filter *filter =
+			&bt_scan.scan_filters.short_name;
+	const u8_t *name_len = bt_scan.compiled.short_name_len;
 
-	if (is_name_filter_enabled()) {
-		control->filter_cnt++;
+	/* The advertised short name must be a prefix of the filter name,
+	 * and at least as long as the minimum length of the filter.
+	 */
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		if ((data_len >= filter->name[i].min_len) &&
+		    (data_len <= name_len[i]) &&
+		    (memcmp(filter->name[i].target_name, data,
+			    data_len) == 0)) {
+			filter_matched(control, BT_SCAN_SHORT_NAME_FILTER);
+			return;
+		}
 	}
+}
+
+static void appearance_check(struct bt_scan_control *control,
+			     const u8_t *data, u8_t data_len)
+{
+	const struct bt_scan_appearance_filter *filter =
+			&bt_scan.scan_filters.appearance;
+	u16_t appearance;
 
-	if (is_short_name_filter_enabled()) {
-		control->filter_cnt++;
+	if (data_len != sizeof(u16_t)) {
+		return;
 	}
 
-	if (is_uuid_filter_enabled()) {
-		control->filter_cnt++;
+	appearance = sys_get_be16(data);
+
+	for (u8_t i = 0; i < filter->cnt; i++) {
+		if (filter->appearance[i] == appearance) {
+			filter_matched(control, BT_SCAN_APPEARANCE_FILTER);
+			return;
+		}
 	}
+}
+
+static u32_t uuid16_find(const u8_t *data, u8_t data_len)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	u32_t found = 0;
+
+	for (size_t i = 0; i + sizeof(u16_t) <= data_len;
+	     i += sizeof(u16_t)) {
+		u16_t uuid = sys_get_le16(&data[i]);
+
+		for (u8_t j = 0; j < compiled->uuid16_cnt; j++) {
+			if (compiled->uuid16[j] == uuid) {
+				found |= BIT(compiled->uuid16_idx[j]);
+			}
+		}
+	}
+
+	return found;
+}
+
+static u32_t uuid32_find(const u8_t *data, u8_t data_len)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	u32_t found = 0;
+
+	for (size_t i = 0; i + sizeof(u32_t) <= data_len;
+	     i += sizeof(u32_t)) {
+		u32_t uuid = sys_get_le32(&data[i]);
+
+		for (u8_t j = 0; j < compiled->uuid32_cnt; j++) {
+			if (compiled->uuid32[j] == uuid) {
+				found |= BIT(compiled->uuid32_idx[j]);
+			}
+		}
+	}
+
+	return found;
+}
+
+static u32_t uuid128_find(const u8_t *data, u8_t data_len)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	u32_t found = 0;
+
+	for (size_t i = 0; i + BT_SCAN_UUID_128_SIZE <= data_len;
+	     i += BT_SCAN_UUID_128_SIZE) {
+		for (u8_t j = 0; j < compiled->uuid128_cnt; j++) {
+			if (memcmp(compiled->uuid128[j], &data[i],
+				   BT_SCAN_UUID_128_SIZE) == 0) {
+				found |= BIT(compiled->uuid128_idx[j]);
+			}
+		}
+	}
+
+	return found;
+}
+
+static void uuid_check(struct bt_scan_control *control, u32_t found)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	bool was_matched;
+
+	if (!found) {
+		return;
+	}
+
+	/* In the normal filter mode, only one UUID is needed to match.
+	 * In the multifilter mode, all UUIDs must be found in the
+	 * advertising data.
+	 */
+	was_matched = control->all_mode ?
+		(control->uuid_match_mask == compiled->uuid_all_mask) :
+		(control->uuid_match_mask != 0);
+
+	control->uuid_match_mask |= found;
 
-	if (is_appearance_filter_enabled()) {
-		control->filter_cnt++;
+	if (!was_matched &&
+	    (!control->all_mode ||
+	     (control->uuid_match_mask == compiled->uuid_all_mask))) {
+		filter_matched(control, BT_SCAN_UUID_FILTER);
 	}
 }
 
-static bool adv_data_found(struct bt_data *data, void *user_data)
+static void adv_data_check(struct bt_scan_control *control, u8_t type,
+			   const u8_t *data, u8_t data_len)
 {
-	struct bt_scan_control *scan_control =
-			(struct bt_scan_control *)user_data;
+	u8_t mode = bt_scan.compiled.mode;
 
-	switch (data->type) {
+	switch (type) {
 	case BT_DATA_NAME_COMPLETE:
-		/* Check the name filter. */
-		name_check(scan_control, data);
+		if ((mode & BT_SCAN_NAME_FILTER) &&
+		    !control->filter_status.name) {
+			name_check(control, data, data_len);
+		}
 		break;
 
 	case BT_DATA_NAME_SHORTENED:
-		/* Check the short name filter. */
-		short_name_check(scan_control, data);
+		if ((mode & BT_SCAN_SHORT_NAME_FILTER) &&
+		    !control->filter_status.short_name) {
+			short_name_check(control, data, data_len);
+		}
 		break;
 
 	case BT_DATA_GAP_APPEARANCE:
-		/* Check the appearance filter. */
-		appearance_check(scan_control, data);
+		if ((mode & BT_SCAN_APPEARANCE_FILTER) &&
+		    !control->filter_status.appearance) {
+			appearance_check(control, data, data_len);
+		}
 		break;
 
 	case BT_DATA_UUID16_SOME:
 	case BT_DATA_UUID16_ALL:
-		/* Check the UUID filter. */
-		uuid_check(scan_control, data, BT_UUID_TYPE_16);
+		if (mode & BT_SCAN_UUID_FILTER) {
+			uuid_check(control, uuid16_find(data, data_len));
+		}
 		break;
 
 	case BT_DATA_UUID32_SOME:
 	case BT_DATA_UUID32_ALL:
-		uuid_check(scan_control, data, BT_UUID_TYPE_32);
+		if (mode & BT_SCAN_UUID_FILTER) {
+			uuid_check(control, uuid32_find(data, data_len));
+		}
 		break;
 
 	case BT_DATA_UUID128_SOME:
 	case BT_DATA_UUID128_ALL:
-		/* Check the UUID filter. */
-		uuid_check(scan_control, data, BT_UUID_TYPE_128);
+		if (mode & BT_SCAN_UUID_FILTER) {
+			uuid_check(control, uuid128_find(data, data_len));
+		}
 		break;
 
 	default:
 		break;
 	}
+}
+
+/* Walk the advertising data once, stopping as soon as the outcome of the
+ * filtering is known.
+ */
+static void adv_data_parse(struct bt_scan_control *control,
+			   const struct net_buf_simple *ad)
+{
+	const u8_t *data = ad->data;
+	u16_t len = ad->len;
+
+	while (len > 1) {
+		u8_t field_len = data[0];
+
+		/* Check for early termination. */
+		if ((field_len == 0) || (field_len >= len)) {
+			return;
+		}
+
+		adv_data_check(control, data[1], &data[2], field_len - 1);
 
-	return true;
+		if (filter_decided(control)) {
+			return;
+		}
+
+		data += field_len + 1;
+		len -= field_len + 1;
+	}
 }
 
 static void filter_state_check(struct bt_scan_control *control,
@@ -1096,16 +1445,111 @@ static void filter_state_check(struct bt_scan_control *control,
 	}
 }
 
-static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
-			      struct net_buf_simple *ad)
+#if CONFIG_BT_SCAN_DUPLICATE_FILTER
+static u32_t ad_hash(u8_t type, const struct net_buf_simple *ad)
 {
-	struct bt_scan_control scan_control;
+	u32_t hash = fnv_hash(ad->data, ad->len);
+
+	hash ^= type;
+	hash *= FNV_PRIME;
+
+	return hash;
+}
+
+/* Check if the report repeats a recently forwarded one. Updates the
+ * cache with the report if it is to be forwarded.
+ */
+static bool dup_report_check(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
+			     const struct net_buf_simple *ad)
+{
+	struct bt_scan_dup_entry *entry = NULL;
+	struct bt_scan_dup_entry *lru = &bt_scan.dup_cache[0];
+	u32_t hash = ad_hash(type, ad);
+	u32_t now = k_uptime_get_32();
+
+	for (size_t i = 0; i < ARRAY_SIZE(bt_scan.dup_cache); i++) {
+		struct bt_scan_dup_entry *e = &bt_scan.dup_cache[i];
+
+		if (!e->valid) {
+			lru = e;
+			continue;
+		}
+
+		if (bt_addr_le_cmp(&e->addr, addr) == 0) {
+			entry = e;
+			break;
+		}
+
+		if (lru->valid && ((s32_t)(e->used - lru->used) < 0)) {
+			lru = e;
+		}
+	}
+
+	if (entry) {
+		entry->used = now;
+
+		if ((entry->ad_hash == hash) &&
+		    ((now - entry->forwarded) <
+		     CONFIG_BT_SCAN_DUPLICATE_TIMEOUT) &&
+		    (abs(rssi - entry->rssi) <
+		     CONFIG_BT_SCAN_DUPLICATE_RSSI_THRESHOLD)) {
+			bt_scan.dup_stats.hit++;
+			return true;
+		}
+	} else {
+		if (lru->valid) {
+			bt_scan.dup_stats.evicted++;
+		}
+
+		entry = lru;
+		entry->valid = true;
+		entry->used = now;
+		bt_addr_le_copy(&entry->addr, addr);
+	}
+
+	/* The entry of the device is updated in place, also when its
+	 * advertising data changes.
+	 */
+	entry->ad_hash = hash;
+	entry->forwarded = now;
+	entry->rssi = rssi;
+	bt_scan.dup_stats.miss++;
 
-	memset(&scan_control, 0, sizeof(scan_control));
+	return false;
+}
 
-	scan_control.all_mode = bt_scan.scan_filters.all_mode;
+void bt_scan_dup_stats_get(struct bt_scan_dup_stats *stats)
+{
+	*stats = bt_scan.dup_stats;
+}
 
-	check_enabled_filters(&scan_control);
+void bt_scan_dup_cache_clear(void)
+{
+	memset(bt_scan.dup_cache, 0, sizeof(bt_scan.dup_cache));
+	memset(&bt_scan.dup_stats, 0, sizeof(bt_scan.dup_stats));
+}
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
+
+static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
+			      struct net_buf_simple *ad)
+{
+	const struct bt_scan_compiled *compiled = &bt_scan.compiled;
+	struct bt_scan_control scan_control = {
+		.filter_cnt = compiled->filter_cnt,
+		.all_mode = compiled->all_mode,
+	};
+
+#if CONFIG_BT_SCAN_DEVICE_TABLE
+	/* Every report is accounted for, including duplicates. */
+	device_table_update(addr, rssi, type, ad);
+#endif /* CONFIG_BT_SCAN_DEVICE_TABLE */
+
+#if CONFIG_BT_SCAN_DUPLICATE_FILTER
+	/* A repeated report gives the same filter result, drop it. */
+	if (dup_report_check(addr, rssi, type, ad)) {
+		return;
+	}
+#endif /* CONFIG_BT_SCAN_DUPLICATE_FILTER */
 
 	/* Check id device is connectable. */
 	if (type == BT_LE_ADV_IND ||
@@ -1115,9 +1559,17 @@ static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
 	}
 
 	/* Check the address filter. */
-	check_addr(&scan_control, addr);
+	if (compiled->mode & BT_SCAN_ADDR_FILTER) {
+		check_addr(&scan_control, addr);
+	}
 
-	bt_data_parse(ad, adv_data_found, (void *)&scan_control);
+	/* The advertising data needs to be parsed only if there are
+	 * filters on it and the outcome is not known yet.
+	 */
+	if ((compiled->mode & ~BT_SCAN_ADDR_FILTER) &&
+	    !filter_decided(&scan_control)) {
+		adv_data_parse(&scan_control, ad);
+	}
 
 	scan_control.device_info.addr = addr;
 	scan_control.device_info.conn_param = &bt_scan.conn_param;
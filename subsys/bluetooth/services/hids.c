@@ -46,6 +46,13 @@ enum {
 	HIDS_FEATURE = 0x03,
 };
 
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+/* HIDS instance that uses the Input Report queue. Notification complete
+ * callbacks carry only the connection, so only one instance is supported.
+ */
+static struct bt_gatt_hids *queue_hids;
+#endif
+
 int bt_gatt_hids_notify_connected(struct bt_gatt_hids *hids_obj,
 				  struct bt_conn *conn)
 {
@@ -701,6 +708,45 @@ static u8_t hid_information_encode(u8_t *buffer,
 	return len;
 }
 
+static void inp_rep_mask_spans_compute(struct bt_gatt_hids_inp_rep *hids_inp_rep)
+{
+	const u8_t *rep_mask = hids_inp_rep->rep_mask;
+	size_t span_cnt = 0;
+	size_t i = 0;
+
+	hids_inp_rep->mask_span_cnt = 0;
+
+	if (!rep_mask) {
+		return;
+	}
+
+	while (i < hids_inp_rep->size) {
+		size_t start;
+
+		if ((rep_mask[i / 8] & BIT(i % 8)) == 0) {
+			i++;
+			continue;
+		}
+
+		start = i;
+		while ((i < hids_inp_rep->size) &&
+		       ((rep_mask[i / 8] & BIT(i % 8)) != 0)) {
+			i++;
+		}
+
+		if (span_cnt >= ARRAY_SIZE(hids_inp_rep->mask_spans)) {
+			LOG_DBG("Report mask too fragmented, using byte mask");
+			return;
+		}
+
+		hids_inp_rep->mask_spans[span_cnt][0] = start;
+		hids_inp_rep->mask_spans[span_cnt][1] = i - start;
+		span_cnt++;
+	}
+
+	hids_inp_rep->mask_span_cnt = span_cnt;
+}
+
 static void
 hids_input_reports_register(struct bt_gatt_hids *hids_obj,
 			    const struct bt_gatt_hids_init_param *init_param)
@@ -722,6 +768,7 @@ hids_input_reports_register(struct bt_gatt_hids *hids_obj,
 		hids_inp_rep->att_ind = hids_obj->svc.attr_count;
 		hids_inp_rep->offset = offset;
 		hids_inp_rep->idx = i;
+		inp_rep_mask_spans_compute(hids_inp_rep);
 
 		BT_GATT_POOL_DESC_GET(
 		    &hids_obj->svc,
@@ -821,6 +868,24 @@ int bt_gatt_hids_init(struct bt_gatt_hids *hids_obj,
 {
 	LOG_DBG("Initializing HIDS.");
 
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	if (queue_hids && (queue_hids != hids_obj)) {
+		LOG_ERR("Input Report queue is used by another instance");
+		return -EALREADY;
+	}
+
+	size_t inp_rep_len = 0;
+
+	for (size_t i = 0; i < init_param->inp_rep_group_init.cnt; i++) {
+		inp_rep_len += init_param->inp_rep_group_init.reports[i].size;
+	}
+
+	if (inp_rep_len > CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DATA_SIZE) {
+		LOG_ERR("Input Reports do not fit in the queue");
+		return -ENOMEM;
+	}
+#endif
+
 	hids_obj->pm.evt_handler = init_param->pm_evt_handler;
 	hids_obj->cp.evt_handler = init_param->cp_evt_handler;
 
@@ -946,7 +1011,16 @@ int bt_gatt_hids_init(struct bt_gatt_hids *hids_obj,
 			       NULL, hids_ctrl_point_write, &hids_obj->cp));
 
 	/* Register HIDS attributes in GATT database. */
-	return bt_gatt_service_register(&hids_obj->svc);
+	int err = bt_gatt_service_register(&hids_obj->svc);
+
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	if (!err) {
+		k_work_init(&inp_rep_queue_work, inp_rep_queue_work_handler);
+		queue_hids = hids_obj;
+	}
+#endif
+
+	return err;
 }
 
 int bt_gatt_hids_uninit(struct bt_gatt_hids *hids_obj)
@@ -1030,6 +1104,12 @@ int bt_gatt_hids_uninit(struct bt_gatt_hids *hids_obj)
 	/* Free all allocated memory. */
 	bt_conn_ctx_free_all(hids_obj->conn_ctx);
 
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	if (queue_hids == hids_obj) {
+		queue_hids = NULL;
+	}
+#endif
+
 	/* Reset HIDS instance. */
 	memset(hids_obj, 0, sizeof(*hids_obj));
 	hids_obj->svc.attrs = attr_start;
@@ -1046,6 +1126,20 @@ static void store_input_report(struct bt_gatt_hids_inp_rep *hids_inp_rep,
 		return;
 	}
 
+	if (hids_inp_rep->mask_span_cnt) {
+		for (size_t i = 0; i < hids_inp_rep->mask_span_cnt; i++) {
+			const u8_t *span = hids_inp_rep->mask_spans[i];
+
+			if (span[0] >= len) {
+				break;
+			}
+
+			memcpy(&rep_data[span[0]], &rep[span[0]],
+			       MIN(span[1], len - span[0]));
+		}
+		return;
+	}
+
 	const u8_t *rep_mask = hids_inp_rep->rep_mask;
 
 	for (size_t i = 0; i < len; i++) {
@@ -1055,48 +1149,304 @@ static void store_input_report(struct bt_gatt_hids_inp_rep *hids_inp_rep,
 	}
 }
 
+struct inp_rep_notify_all_ctx {
+	struct bt_gatt_hids_inp_rep *hids_inp_rep;
+	u8_t const *rep;
+	u8_t len;
+	bool notify;
+};
+
+static void inp_rep_store_ctx(const struct bt_conn_ctx *ctx, void *user_data)
+{
+	struct inp_rep_notify_all_ctx *notify_ctx = user_data;
+	struct bt_gatt_hids_inp_rep *hids_inp_rep = notify_ctx->hids_inp_rep;
+	struct bt_gatt_hids_conn_data *conn_data = ctx->data;
+
+	if (hids_is_notification_enabled(ctx->conn, hids_inp_rep->ccc)) {
+		store_input_report(hids_inp_rep,
+				   conn_data->inp_rep_ctx +
+				   hids_inp_rep->offset,
+				   notify_ctx->rep, notify_ctx->len);
+		notify_ctx->notify = true;
+	}
+}
+
 static int inp_rep_notify_all(struct bt_gatt_hids *hids_obj,
 			      struct bt_gatt_hids_inp_rep *hids_inp_rep,
 			      u8_t const *rep, u8_t len,
 			      bt_gatt_complete_func_t cb)
 {
-	struct bt_gatt_hids_conn_data *conn_data;
-	u8_t *rep_data = NULL;
+	struct inp_rep_notify_all_ctx notify_ctx = {
+		.hids_inp_rep = hids_inp_rep,
+		.rep = rep,
+		.len = len,
+	};
+
+	/* Store the report for all links, each of which is referenced while
+	 * it is stored, then send one notification to all of them.
+	 */
+	bt_conn_ctx_foreach(hids_obj->conn_ctx, inp_rep_store_ctx,
+			    &notify_ctx);
+
+	if (notify_ctx.notify) {
+		return bt_gatt_notify_cb(
+		    NULL, &hids_obj->svc.attrs[hids_inp_rep->att_ind], rep,
+		    hids_inp_rep->size, cb);
+	} else {
+		return -ENODATA;
+	}
+}
 
-	const size_t contexts =
-	    bt_conn_ctx_count(hids_obj->conn_ctx);
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+/* The queue of a connection is protected by irq_lock, which is held only
+ * around queue updates. Notifications are sent with no lock held, by one
+ * sender per connection at a time, which the sending flag marks. This keeps
+ * the order of the in-flight entries the order in which the notifications
+ * complete. Reports queued in the meantime are sent from the queue work.
+ */
+static struct k_work inp_rep_queue_work;
 
-	for (size_t i = 0; i < contexts; i++) {
-		const struct bt_conn_ctx *ctx =
-			bt_conn_ctx_get_by_id(hids_obj->conn_ctx, i);
-
-		if (ctx) {
-			bool notification_enabled =
-			    hids_is_notification_enabled(ctx->conn,
-							 hids_inp_rep->ccc);
-			if (notification_enabled) {
-				conn_data = ctx->data;
-				rep_data = conn_data->inp_rep_ctx +
-					   hids_inp_rep->offset;
-
-				store_input_report(hids_inp_rep, rep_data, rep,
-						   len);
+static void inp_rep_queue_complete(struct bt_conn *conn);
+
+/* Called with interrupts locked. Reserves an in-flight entry, and makes the
+ * caller the sender of the connection.
+ */
+static void inp_rep_queue_reserve(struct bt_gatt_hids_inp_rep_queue *queue,
+				  struct bt_gatt_hids_inp_rep *hids_inp_rep,
+				  bt_gatt_complete_func_t cb)
+{
+	size_t tail = (queue->inflight_head + queue->inflight_cnt) %
+		      ARRAY_SIZE(queue->inflight);
+
+	__ASSERT_NO_MSG(queue->inflight_cnt < ARRAY_SIZE(queue->inflight));
+
+	/* The entry is recorded before the notification is sent, as it can
+	 * complete before bt_gatt_notify_cb returns.
+	 */
+	queue->inflight[tail].idx = hids_inp_rep->idx;
+	queue->inflight[tail].cb = cb;
+	queue->inflight_cnt++;
+	queue->rep_inflight[hids_inp_rep->idx]++;
+	queue->sending = true;
+}
+
+/* Called with interrupts locked. The sender reserved the newest entry, and
+ * no other entry was reserved since.
+ */
+static void inp_rep_queue_rollback(struct bt_gatt_hids_inp_rep_queue *queue,
+				   struct bt_gatt_hids_inp_rep *hids_inp_rep)
+{
+	queue->inflight_cnt--;
+	queue->rep_inflight[hids_inp_rep->idx]--;
+}
+
+/* Called with interrupts locked. */
+static void inp_rep_queue_store(struct bt_gatt_hids_inp_rep_queue *queue,
+				struct bt_gatt_hids_inp_rep *hids_inp_rep,
+				u8_t const *rep, bt_gatt_complete_func_t cb)
+{
+	u8_t *queued = queue->data + hids_inp_rep->offset;
+
+	if ((queue->queued & BIT(hids_inp_rep->idx)) && hids_inp_rep->merge) {
+		hids_inp_rep->merge(queued, rep, hids_inp_rep->size);
+	} else {
+		memcpy(queued, rep, hids_inp_rep->size);
+	}
+
+	queue->queued |= BIT(hids_inp_rep->idx);
+	queue->queued_cb[hids_inp_rep->idx] = cb;
+}
+
+static int inp_rep_queue_send(struct bt_gatt_hids *hids_obj,
+			      struct bt_gatt_hids_conn_data *conn_data,
+			      struct bt_conn *conn,
+			      struct bt_gatt_hids_inp_rep *hids_inp_rep,
+			      u8_t const *rep, bt_gatt_complete_func_t cb)
+{
+	struct bt_gatt_hids_inp_rep_queue *queue = &conn_data->inp_rep_queue;
+	unsigned int key = irq_lock();
+	bool pending;
+	int err;
+
+	if (queue->sending || (queue->queued & BIT(hids_inp_rep->idx)) ||
+	    (queue->rep_inflight[hids_inp_rep->idx] >=
+	     CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DEPTH)) {
+		inp_rep_queue_store(queue, hids_inp_rep, rep, cb);
+		pending = !queue->sending;
+		irq_unlock(key);
+
+		/* Otherwise, the sender submits the work when it is done. */
+		if (pending) {
+			k_work_submit(&inp_rep_queue_work);
+		}
+
+		return 0;
+	}
+
+	inp_rep_queue_reserve(queue, hids_inp_rep, cb);
+	irq_unlock(key);
+
+	err = bt_gatt_notify_cb(conn,
+				&hids_obj->svc.attrs[hids_inp_rep->att_ind],
+				rep, hids_inp_rep->size,
+				inp_rep_queue_complete);
+
+	key = irq_lock();
+	queue->sending = false;
+	if (err) {
+		inp_rep_queue_rollback(queue, hids_inp_rep);
+		if ((err == -ENOMEM) && (queue->inflight_cnt > 0)) {
+			/* Sent when a notification in flight completes. */
+			inp_rep_queue_store(queue, hids_inp_rep, rep, cb);
+			err = 0;
+		}
+	}
+	pending = (queue->queued != 0);
+	irq_unlock(key);
+
+	if (pending) {
+		k_work_submit(&inp_rep_queue_work);
+	}
+
+	return err;
+}
+
+static void inp_rep_queue_flush(const struct bt_conn_ctx *ctx,
+				void *user_data)
+{
+	struct bt_gatt_hids *hids_obj = user_data;
+	struct bt_gatt_hids_conn_data *conn_data = ctx->data;
+	struct bt_gatt_hids_inp_rep_queue *queue = &conn_data->inp_rep_queue;
+	u8_t rep[CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DATA_SIZE];
+
+	for (size_t i = 0; i < hids_obj->inp_rep_group.cnt; i++) {
+		struct bt_gatt_hids_inp_rep *hids_inp_rep =
+		    &hids_obj->inp_rep_group.reports[i];
+		bt_gatt_complete_func_t cb;
+		unsigned int key = irq_lock();
+		int err;
+
+		if (queue->sending) {
+			irq_unlock(key);
+			break;
+		}
+
+		if (!(queue->queued & BIT(i)) ||
+		    (queue->rep_inflight[i] >=
+		     CONFIG_BT_GATT_HIDS_INP_REP_QUEUE_DEPTH)) {
+			irq_unlock(key);
+			continue;
+		}
+
+		/* The report is sent from a copy, so that newer reports can
+		 * be queued while it is sent.
+		 */
+		memcpy(rep, queue->data + hids_inp_rep->offset,
+		       hids_inp_rep->size);
+		cb = queue->queued_cb[i];
+		queue->queued &= ~BIT(i);
+		inp_rep_queue_reserve(queue, hids_inp_rep, cb);
+		irq_unlock(key);
+
+		err = bt_gatt_notify_cb(ctx->conn,
+				&hids_obj->svc.attrs[hids_inp_rep->att_ind],
+				rep, hids_inp_rep->size,
+				inp_rep_queue_complete);
+
+		key = irq_lock();
+		queue->sending = false;
+		if (err) {
+			inp_rep_queue_rollback(queue, hids_inp_rep);
+		}
+		if ((err == -ENOMEM) && (queue->inflight_cnt > 0)) {
+			/* Queue the report again, folded into a newer one
+			 * if there is one, and retry when a notification in
+			 * flight completes.
+			 */
+			if (!(queue->queued & BIT(i))) {
+				inp_rep_queue_store(queue, hids_inp_rep, rep,
+						    cb);
+			} else if (hids_inp_rep->merge) {
+				hids_inp_rep->merge(
+					queue->data + hids_inp_rep->offset,
+					rep, hids_inp_rep->size);
 			}
+			irq_unlock(key);
+			break;
+		}
+		irq_unlock(key);
 
-			bt_conn_ctx_release(hids_obj->conn_ctx,
-					    (void *)ctx->data);
+		if (err) {
+			LOG_WRN("Queued Input Report %u dropped, err: %d",
+				i, err);
 		}
 	}
+}
 
-	if (rep_data != NULL) {
-		return bt_gatt_notify_cb(
-		    NULL, &hids_obj->svc.attrs[hids_inp_rep->att_ind], rep,
-		    hids_inp_rep->size, cb);
-	} else {
-		return -ENODATA;
+static void inp_rep_queue_work_handler(struct k_work *work)
+{
+	struct bt_gatt_hids *hids_obj = queue_hids;
+
+	if (!hids_obj) {
+		return;
 	}
+
+	bt_conn_ctx_foreach(hids_obj->conn_ctx, inp_rep_queue_flush, hids_obj);
 }
 
+static void inp_rep_queue_complete(struct bt_conn *conn)
+{
+	struct bt_gatt_hids *hids_obj = queue_hids;
+	struct bt_gatt_hids_conn_data *conn_data;
+	struct bt_gatt_hids_inp_rep_queue *queue;
+	bt_gatt_complete_func_t cb;
+	unsigned int key;
+	bool pending;
+
+	if (!hids_obj) {
+		return;
+	}
+
+	conn_data = bt_conn_ctx_get(hids_obj->conn_ctx, conn);
+	if (!conn_data) {
+		/* The peer has disconnected in the meantime. */
+		return;
+	}
+
+	queue = &conn_data->inp_rep_queue;
+
+	key = irq_lock();
+
+	if (queue->inflight_cnt == 0) {
+		irq_unlock(key);
+		bt_conn_ctx_release(hids_obj->conn_ctx, (void *)conn_data);
+		return;
+	}
+
+	cb = queue->inflight[queue->inflight_head].cb;
+	queue->rep_inflight[queue->inflight[queue->inflight_head].idx]--;
+	queue->inflight_head = (queue->inflight_head + 1) %
+			       ARRAY_SIZE(queue->inflight);
+	queue->inflight_cnt--;
+	pending = (queue->queued != 0);
+
+	irq_unlock(key);
+
+	bt_conn_ctx_release(hids_obj->conn_ctx, (void *)conn_data);
+
+	/* The queued reports are sent from the work, not from the TX
+	 * complete context of the stack.
+	 */
+	if (pending) {
+		k_work_submit(&inp_rep_queue_work);
+	}
+
+	if (cb) {
+		cb(conn);
+	}
+}
+#endif /* CONFIG_BT_GATT_HIDS_INP_REP_QUEUE */
+
 int bt_gatt_hids_inp_rep_send(struct bt_gatt_hids *hids_obj,
 			      struct bt_conn *conn, u8_t rep_index,
 			      u8_t const *rep, u8_t len,
@@ -1129,9 +1479,14 @@ int bt_gatt_hids_inp_rep_send(struct bt_gatt_hids *hids_obj,
 	rep_data = conn_data->inp_rep_ctx + hids_inp_rep->offset;
 
 	store_input_report(hids_inp_rep, rep_data, rep, len);
+#if CONFIG_BT_GATT_HIDS_INP_REP_QUEUE
+	int err = inp_rep_queue_send(hids_obj, conn_data, conn, hids_inp_rep,
+				     rep, cb);
+#else
 	int err =
 	    bt_gatt_notify_cb(conn, &hids_obj->svc.attrs[hids_inp_rep->att_ind],
 			      rep, hids_inp_rep->size, cb);
+#endif
 
 	bt_conn_ctx_release(hids_obj->conn_ctx, (void *)conn_data);
 
@@ -1154,38 +1509,37 @@ static int boot_mouse_inp_report_notify_all(
 	const size_t contexts = bt_conn_ctx_count(hids_obj->conn_ctx);
 
 	for (size_t i = 0; i < contexts; i++) {
-		const struct bt_conn_ctx *ctx =
-			bt_conn_ctx_get_by_id(hids_obj->conn_ctx, i);
-
-		if (ctx) {
-			bool notification_enabled =
-			    hids_is_notification_enabled(
-				ctx->conn, boot_mouse_inp_rep->ccc);
-
-			if (notification_enabled) {
-				conn_data = ctx->data;
-				rep_data =
-				    conn_data->hids_boot_mouse_inp_rep_ctx;
-
-				if (buttons) {
-					/* If buttons data is not given
-					 * use old values.
-					 */
-					rep_data[0] = *buttons;
-				}
-
-				rep_buff[0] = rep_data[0];
+		struct bt_conn_ctx ctx;
+
+		if (bt_conn_ctx_get_by_id(hids_obj->conn_ctx, i, &ctx)) {
+			continue;
+		}
+
+		bool notification_enabled =
+		    hids_is_notification_enabled(ctx.conn,
+						 boot_mouse_inp_rep->ccc);
+
+		if (notification_enabled) {
+			conn_data = ctx.data;
+			rep_data = conn_data->hids_boot_mouse_inp_rep_ctx;
+
+			if (buttons) {
+				/* If buttons data is not given
+				 * use old values.
+				 */
+				rep_data[0] = *buttons;
 			}
 
-			bt_conn_ctx_release(hids_obj->conn_ctx,
-					    (void *)ctx->data);
+			rep_buff[0] = rep_data[0];
 		}
+
+		bt_conn_ctx_release(hids_obj->conn_ctx, ctx.data);
 	}
 
 	if (rep_data != NULL) {
 		return bt_gatt_notify_cb(
 		    NULL, &hids_obj->svc.attrs[rep_ind], rep_buff,
-		    sizeof(conn_data->hids_boot_mouse_inp_rep_ctx), cb);
+		    sizeof(rep_buff), cb);
 	} else {
 		return -ENODATA;
 	}
@@ -1253,37 +1607,44 @@ boot_kb_inp_notify_all(struct bt_gatt_hids *hids_obj, u8_t const *rep,
 	struct bt_gatt_hids_conn_data *conn_data;
 	u8_t rep_ind = hids_obj->boot_kb_inp_rep.att_ind;
 	u8_t *rep_data = NULL;
+	u8_t rep_buff[BT_GATT_HIDS_BOOT_KB_INPUT_REP_LEN] = {0};
+
+	if (len > sizeof(rep_buff)) {
+		return -EINVAL;
+	}
+
+	memcpy(rep_buff, rep, len);
 
 	const size_t contexts = bt_conn_ctx_count(hids_obj->conn_ctx);
 
 	for (size_t i = 0; i < contexts; i++) {
-		const struct bt_conn_ctx *ctx =
-		    bt_conn_ctx_get_by_id(hids_obj->conn_ctx, i);
-
-		if (ctx) {
-			bool notification_enabled =
-			    hids_is_notification_enabled(
-				ctx->conn, boot_kb_inp_rep->ccc);
-
-			if (notification_enabled) {
-				conn_data = ctx->data;
-				rep_data = conn_data->hids_boot_kb_inp_rep_ctx;
-
-				memcpy(rep_data, rep, len);
-				memset(&rep_data[len], 0,
-				       (BT_GATT_HIDS_BOOT_KB_INPUT_REP_LEN -
-					len));
-			}
+		struct bt_conn_ctx ctx;
 
-			bt_conn_ctx_release(hids_obj->conn_ctx,
-					    (void *)ctx->data);
+		if (bt_conn_ctx_get_by_id(hids_obj->conn_ctx, i, &ctx)) {
+			continue;
 		}
+
+		bool notification_enabled =
+		    hids_is_notification_enabled(ctx.conn,
+						 boot_kb_inp_rep->ccc);
+
+		if (notification_enabled) {
+			conn_data = ctx.data;
+			rep_data = conn_data->hids_boot_kb_inp_rep_ctx;
+
+			memcpy(rep_data, rep_buff, sizeof(rep_buff));
+		}
+
+		bt_conn_ctx_release(hids_obj->conn_ctx, ctx.data);
 	}
 
+	/* The report is sent from a local copy, as the context data can be
+	 * freed once it is released.
+	 */
 	if (rep_data != NULL) {
 		return bt_gatt_notify_cb(
-		    NULL, &hids_obj->svc.attrs[rep_ind], rep_data,
-		    sizeof(conn_data->hids_boot_kb_inp_rep_ctx), cb);
+		    NULL, &hids_obj->svc.attrs[rep_ind], rep_buff,
+		    sizeof(rep_buff), cb);
 	} else {
 		return -ENODATA;
 	}
@@ -1307,13 +1668,13 @@ int bt_gatt_hids_boot_kb_inp_rep_send(struct bt_gatt_hids *hids_obj,
 		return -EACCES;
 	}
 
-	struct bt_gatt_hids_conn_data *conn_data =
-		bt_conn_ctx_get(hids_obj->conn_ctx, conn);
-
-	if (len > sizeof(conn_data->hids_boot_kb_inp_rep_ctx)) {
+	if (len > BT_GATT_HIDS_BOOT_KB_INPUT_REP_LEN) {
 		return -EINVAL;
 	}
 
+	struct bt_gatt_hids_conn_data *conn_data =
+		bt_conn_ctx_get(hids_obj->conn_ctx, conn);
+
 	if (!conn_data) {
 		LOG_WRN("The context was not found");
 		return -EINVAL;
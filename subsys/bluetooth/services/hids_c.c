@@ -7,6 +7,7 @@
 #include <bluetooth/conn.h>
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
+#include <bluetooth/att.h>
 
 #include <bluetooth/services/hids_c.h>
 
@@ -415,15 +416,38 @@ static int repref_read_start(struct bt_gatt_hids_c *hids_c, size_t rep_idx)
 	return 0;
 }
 
+/**
+ * @brief Parse Report Reference value
+ *
+ * @param hids_c  HIDS client object.
+ * @param rep_idx Index in the report array.
+ * @param bdata   Report Reference value, 2 bytes long.
+ *
+ * @return 0 or negative error value.
+ */
+static int repref_parse(struct bt_gatt_hids_c *hids_c, size_t rep_idx,
+			const u8_t *bdata)
+{
+	struct bt_gatt_hids_c_rep_info *rep = hids_c->rep_info[rep_idx];
+
+	if ((u8_t)rep->ref.type != bdata[1]) {
+		LOG_ERR("Unexpected report type (%u while expecting %u)",
+			bdata[1], rep->ref.type);
+		return -EINVAL;
+	}
+	rep->ref.id = bdata[0];
+	LOG_DBG("Report reference read (idx: %u, id: %u)",
+		rep_idx, rep->ref.id);
+	return 0;
+}
+
 static u8_t repref_read_process(struct bt_conn *conn, u8_t err,
 				struct bt_gatt_read_params *params,
 				const void *data, u16_t length)
 {
 	int ret;
 	struct bt_gatt_hids_c *hids_c;
-	struct bt_gatt_hids_c_rep_info *rep;
 	size_t rep_idx;
-	const u8_t *bdata = data;
 
 	hids_c = CONTAINER_OF(params,
 			      struct bt_gatt_hids_c,
@@ -445,17 +469,11 @@ static u8_t repref_read_process(struct bt_conn *conn, u8_t err,
 		return BT_GATT_ITER_STOP;
 	}
 
-	rep = hids_c->rep_info[rep_idx];
-	if ((u8_t)rep->ref.type != bdata[1]) {
-		LOG_ERR("Unexpected report type (%u while expecting %u)",
-			bdata[1], rep->ref.type);
-		hids_prep_error(hids_c, -EINVAL);
+	ret = repref_parse(hids_c, rep_idx, data);
+	if (ret) {
+		hids_prep_error(hids_c, ret);
 		return BT_GATT_ITER_STOP;
 	}
-	rep->ref.id = bdata[0];
-	LOG_DBG("Report reference read (idx: %u, id: %u)",
-		rep_idx, rep->ref.id);
-
 
 	/* Next */
 	ret = repref_read_start(hids_c, rep_idx + 1);
@@ -508,12 +526,29 @@ static int hid_info_read_start(struct bt_gatt_hids_c *hids_c)
 	return 0;
 }
 
+/**
+ * @brief Parse HID Information value
+ *
+ * @param hids_c HIDS client object.
+ * @param bdata  HID Information value, 4 bytes long.
+ */
+static void hid_info_parse(struct bt_gatt_hids_c *hids_c, const u8_t *bdata)
+{
+	hids_c->info_val.bcd_hid = (u16_t)bdata[0] | (((u16_t)bdata[1]) << 8);
+	hids_c->info_val.b_country_code = bdata[2];
+	hids_c->info_val.flags = bdata[3];
+
+	LOG_DBG("HID information success:");
+	LOG_DBG("  bcdHID: %x", hids_c->info_val.bcd_hid);
+	LOG_DBG("  bCountryCode: 0x%x", hids_c->info_val.b_country_code);
+	LOG_DBG("  Flags: 0x%x", hids_c->info_val.flags);
+}
+
 static u8_t hid_info_read_process(struct bt_conn *conn, u8_t err,
 				   struct bt_gatt_read_params *params,
 				   const void *data, u16_t length)
 {
 	struct bt_gatt_hids_c *hids_c;
-	const u8_t *bdata = data;
 
 	hids_c = CONTAINER_OF(params,
 			      struct bt_gatt_hids_c,
@@ -530,14 +565,7 @@ static u8_t hid_info_read_process(struct bt_conn *conn, u8_t err,
 		return BT_GATT_ITER_STOP;
 	}
 
-	hids_c->info_val.bcd_hid = (u16_t)bdata[0] | (((u16_t)bdata[1]) << 8);
-	hids_c->info_val.b_country_code = bdata[2];
-	hids_c->info_val.flags = bdata[3];
-
-	LOG_DBG("HID information success:");
-	LOG_DBG("  bcdHID: %x", hids_c->info_val.bcd_hid);
-	LOG_DBG("  bCountryCode: 0x%x", hids_c->info_val.b_country_code);
-	LOG_DBG("  Flags: 0x%x", hids_c->info_val.flags);
+	hid_info_parse(hids_c, data);
 
 	err = repref_read_start(hids_c, 0);
 	if (err) {
@@ -547,6 +575,210 @@ static u8_t hid_info_read_process(struct bt_conn *conn, u8_t err,
 	return BT_GATT_ITER_STOP;
 }
 
+#if CONFIG_BT_GATT_HIDS_C_READ_MULTIPLE
+/* Lengths of the values read during preparation. */
+#define PREP_INFO_LEN   4
+#define PREP_REPREF_LEN 2
+#define PREP_PM_LEN     1
+
+/**
+ * @brief Get the number of values read during preparation
+ *
+ * The values are read in the following order: HID Information,
+ * Report Reference of every report and, if present, Protocol Mode.
+ *
+ * @param hids_c HIDS client object.
+ *
+ * @return Number of values.
+ */
+static size_t prep_item_cnt(const struct bt_gatt_hids_c *hids_c)
+{
+	return 1 + hids_c->rep_cnt + ((hids_c->handlers.pm != 0) ? 1 : 0);
+}
+
+/**
+ * @brief Get the handle and the length of a value read during preparation
+ *
+ * @param hids_c HIDS client object.
+ * @param item   Index of the value, see @ref prep_item_cnt.
+ * @param handle Handle of the value.
+ *
+ * @return Length of the value.
+ */
+static size_t prep_item_get(const struct bt_gatt_hids_c *hids_c, size_t item,
+			    u16_t *handle)
+{
+	if (item == 0) {
+		*handle = hids_c->handlers.info;
+		return PREP_INFO_LEN;
+	} else if (item <= hids_c->rep_cnt) {
+		*handle = hids_c->rep_info[item - 1]->handlers.ref;
+		return PREP_REPREF_LEN;
+	}
+	*handle = hids_c->handlers.pm;
+	return PREP_PM_LEN;
+}
+
+/**
+ * @brief Process Read Multiple of preparation values
+ *
+ * @param conn   Connection handler.
+ * @param err    Read ATT error code.
+ * @param params Notification parameters structure - the pointer
+ *               to the structure provided to read function.
+ * @param data   Pointer to the data buffer.
+ * @param length The size of the received data.
+ *
+ * @retval BT_GATT_ITER_STOP     Stop notification
+ * @retval BT_GATT_ITER_CONTINUE Continue notification
+ */
+static u8_t prep_read_multiple_process(struct bt_conn *conn, u8_t err,
+				       struct bt_gatt_read_params *params,
+				       const void *data, u16_t length);
+
+/**
+ * @brief Start Read Multiple of preparation values
+ *
+ * Reads as many of the remaining values as fit into a single response.
+ * Every value has a fixed length, so that the concatenated response can be
+ * split without any length information.
+ *
+ * @param hids_c HIDS client object.
+ * @param item   Index of the first value to read.
+ *
+ * @return 0 or negative error value.
+ */
+static int prep_read_multiple_start(struct bt_gatt_hids_c *hids_c,
+				    size_t item)
+{
+	size_t item_cnt = prep_item_cnt(hids_c);
+	size_t budget = bt_gatt_get_mtu(hids_c->conn) - 1;
+	size_t len = 0;
+	size_t cnt = 0;
+	int err;
+
+	if (item >= item_cnt) {
+		hids_mark_ready(hids_c);
+		return 0;
+	}
+
+	while ((item + cnt < item_cnt) &&
+	       (cnt < ARRAY_SIZE(hids_c->init_repref.handles))) {
+		u16_t handle;
+		size_t item_len = prep_item_get(hids_c, item + cnt, &handle);
+
+		if (len + item_len > budget) {
+			break;
+		}
+		hids_c->init_repref.handles[cnt++] = handle;
+		len += item_len;
+	}
+
+	LOG_DBG("Read Multiple start (items: %u-%u)", item, item + cnt - 1);
+	hids_c->init_repref.rep_idx = item;
+	hids_c->init_repref.cnt = cnt;
+	hids_c->init_repref.err = -ENODATA;
+	hids_c->read_params.func = prep_read_multiple_process;
+	hids_c->read_params.handle_count = cnt;
+	hids_c->read_params.handles = hids_c->init_repref.handles;
+	if (cnt == 1) {
+		hids_c->read_params.single.handle =
+			hids_c->init_repref.handles[0];
+		hids_c->read_params.single.offset = 0;
+	}
+	err = bt_gatt_read(hids_c->conn, &(hids_c->read_params));
+	if (err) {
+		LOG_ERR("Read Multiple error (err: %d)", err);
+		return err;
+	}
+	return 0;
+}
+
+static u8_t prep_read_multiple_process(struct bt_conn *conn, u8_t err,
+				       struct bt_gatt_read_params *params,
+				       const void *data, u16_t length)
+{
+	struct bt_gatt_hids_c *hids_c;
+	const u8_t *bdata = data;
+	size_t item;
+	size_t len = 0;
+	int ret;
+
+	hids_c = CONTAINER_OF(params,
+			      struct bt_gatt_hids_c,
+			      read_params);
+
+	if (!err && !data) {
+		/* End of the read procedure. The values are processed, and
+		 * the next read or the ready callback, which can reuse
+		 * the read parameters, are started only now.
+		 */
+		if (hids_c->init_repref.err) {
+			hids_prep_error(hids_c, hids_c->init_repref.err);
+			return BT_GATT_ITER_STOP;
+		}
+		ret = prep_read_multiple_start(hids_c,
+					       hids_c->init_repref.rep_idx);
+		if (ret) {
+			hids_prep_error(hids_c, ret);
+		}
+		return BT_GATT_ITER_STOP;
+	}
+	if (err == BT_ATT_ERR_NOT_SUPPORTED) {
+		LOG_DBG("Read Multiple not supported, reading one by one");
+		ret = hid_info_read_start(hids_c);
+		if (ret) {
+			hids_prep_error(hids_c, ret);
+		}
+		return BT_GATT_ITER_STOP;
+	}
+	if (err) {
+		LOG_ERR("Read Multiple error (err: %d)", err);
+		hids_prep_error(hids_c, err);
+		return BT_GATT_ITER_STOP;
+	}
+
+	item = hids_c->init_repref.rep_idx;
+	for (size_t i = 0; i < hids_c->init_repref.cnt; i++) {
+		u16_t handle;
+
+		len += prep_item_get(hids_c, item + i, &handle);
+	}
+	if (length != len) {
+		LOG_ERR("Read Multiple unexpected size (%u while expecting %u)",
+			length, len);
+		hids_c->init_repref.err = -ENOTSUP;
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	for (size_t i = 0; i < hids_c->init_repref.cnt; i++, item++) {
+		if (item == 0) {
+			hid_info_parse(hids_c, bdata);
+			bdata += PREP_INFO_LEN;
+		} else if (item <= hids_c->rep_cnt) {
+			ret = repref_parse(hids_c, item - 1, bdata);
+			if (ret) {
+				hids_c->init_repref.err = ret;
+				return BT_GATT_ITER_CONTINUE;
+			}
+			bdata += PREP_REPREF_LEN;
+		} else {
+			hids_c->pm = (enum bt_gatt_hids_c_pm)bdata[0];
+			LOG_DBG("Read PM success: %d", (int)hids_c->pm);
+			bdata += PREP_PM_LEN;
+		}
+	}
+
+	hids_c->init_repref.rep_idx = item;
+	hids_c->init_repref.err = 0;
+
+	/* Continue, so that the completion is reported also for a read of
+	 * a single value.
+	 */
+	return BT_GATT_ITER_CONTINUE;
+}
+#endif /* CONFIG_BT_GATT_HIDS_C_READ_MULTIPLE */
+
 /**
  * @brief Start anything that should be started after discovery
  *
@@ -568,7 +800,19 @@ static int post_discovery_start(struct bt_gatt_hids_c *hids_c)
 		return err;
 	}
 
+#if CONFIG_BT_GATT_HIDS_C_READ_MULTIPLE
+	if (hids_c->handlers.info == 0) {
+		LOG_ERR("Device ready without HID information characteristic");
+		k_sem_give(&hids_c->read_params_sem);
+		return -EINVAL;
+	}
+	/* A server without Read Multiple support is read one value at
+	 * a time, see prep_read_multiple_process.
+	 */
+	err = prep_read_multiple_start(hids_c, 0);
+#else
 	err = hid_info_read_start(hids_c);
+#endif
 	if (err) {
 		k_sem_give(&hids_c->read_params_sem);
 		return err;
@@ -1039,6 +1283,33 @@ int bt_gatt_hids_c_rep_subscribe(struct bt_gatt_hids_c *hids_c,
 	return err;
 }
 
+int bt_gatt_hids_c_rep_subscribe_all(struct bt_gatt_hids_c *hids_c,
+				     bt_gatt_hids_c_read_cb func)
+{
+	int err;
+
+	if (!hids_c || !func) {
+		return -EINVAL;
+	}
+
+	/* The subscriptions are queued together, so that the CCC writes are
+	 * sent one after another without waiting for the application.
+	 */
+	for (size_t i = 0; i < hids_c->rep_cnt; i++) {
+		struct bt_gatt_hids_c_rep_info *rep = hids_c->rep_info[i];
+
+		if ((rep->ref.type != BT_GATT_HIDS_C_REPORT_TYPE_INPUT) ||
+		    rep->notify_cb) {
+			continue;
+		}
+		err = bt_gatt_hids_c_rep_subscribe(hids_c, rep, func);
+		if (err) {
+			return err;
+		}
+	}
+	return 0;
+}
+
 int bt_gatt_hids_c_rep_unsubscribe(struct bt_gatt_hids_c *hids_c,
 				   struct bt_gatt_hids_c_rep_info *rep)
 {
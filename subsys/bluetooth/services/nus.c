@@ -8,6 +8,9 @@
  *  @brief Nordic UART Bridge Service (NUS) sample
  */
 
+#include <zephyr.h>
+#include <ring_buffer.h>
+
 #include <bluetooth/conn.h>
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
@@ -69,12 +72,171 @@ static struct bt_gatt_attr attrs[] = {
 
 static struct bt_gatt_service nus_svc = BT_GATT_SERVICE(attrs);
 
+#if CONFIG_BT_GATT_NUS_STREAM
+RING_BUF_DECLARE(stream_buf, CONFIG_BT_GATT_NUS_STREAM_BUF_SIZE);
+
+/* Delay before a notification that failed with nothing in flight is sent
+ * again, as no completion will trigger it. About one connection interval.
+ */
+#define STREAM_RETRY_DELAY K_MSEC(10)
+
+/* Segment taken from the ring buffer and not sent yet. */
+static u8_t            stream_seg[CONFIG_BT_L2CAP_TX_MTU - 3];
+static u16_t           stream_seg_len;
+static atomic_t        stream_inflight;
+static atomic_t        stream_reset;
+static struct bt_conn *stream_conn;
+static struct k_delayed_work stream_work;
+static bool            stream_initialized;
+
+static void stream_sent(struct bt_conn *conn)
+{
+	if (conn != stream_conn) {
+		return;
+	}
+
+	atomic_dec(&stream_inflight);
+	k_delayed_work_submit(&stream_work, K_NO_WAIT);
+}
+
+static void stream_work_handler(struct k_work *work)
+{
+	struct bt_conn *conn = stream_conn;
+	bool freed = false;
+	unsigned int key;
+	u16_t seg_max;
+
+	if (!conn) {
+		return;
+	}
+
+	if (atomic_cas(&stream_reset, 1, 0)) {
+		/* The connection is gone, drop the queued data. */
+		key = irq_lock();
+		while (ring_buf_get(&stream_buf, stream_seg,
+				    sizeof(stream_seg))) {
+		}
+		stream_seg_len = 0;
+		atomic_set(&stream_inflight, 0);
+		stream_conn = NULL;
+		irq_unlock(key);
+
+		bt_conn_unref(conn);
+		return;
+	}
+
+	seg_max = MIN(bt_gatt_get_mtu(conn) - 3, sizeof(stream_seg));
+
+	while (atomic_get(&stream_inflight) <
+	       CONFIG_BT_GATT_NUS_STREAM_INFLIGHT_MAX) {
+		int err;
+
+		if (!stream_seg_len) {
+			key = irq_lock();
+			stream_seg_len = ring_buf_get(&stream_buf, stream_seg,
+						      seg_max);
+			irq_unlock(key);
+
+			if (!stream_seg_len) {
+				break;
+			}
+			freed = true;
+		}
+
+		err = bt_gatt_notify_cb(conn, &attrs[2], stream_seg,
+					stream_seg_len, stream_sent);
+		if (err) {
+			/* The segment is kept. It is sent again when
+			 * a notification completes, or after a delay if none
+			 * is in flight.
+			 */
+			if (!atomic_get(&stream_inflight)) {
+				k_delayed_work_submit(&stream_work,
+						      STREAM_RETRY_DELAY);
+			}
+			break;
+		}
+
+		atomic_inc(&stream_inflight);
+		stream_seg_len = 0;
+	}
+
+	if (freed && nus_cb.stream_space_cb) {
+		nus_cb.stream_space_cb(ring_buf_space_get(&stream_buf));
+	}
+
+	/* Release the connection once everything has been sent. */
+	key = irq_lock();
+	if (ring_buf_is_empty(&stream_buf) && !stream_seg_len &&
+	    !atomic_get(&stream_inflight)) {
+		stream_conn = NULL;
+	} else {
+		conn = NULL;
+	}
+	irq_unlock(key);
+
+	if (conn) {
+		bt_conn_unref(conn);
+	}
+}
+
+static void stream_disconnected(struct bt_conn *conn, u8_t reason)
+{
+	if (conn == stream_conn) {
+		atomic_set(&stream_reset, 1);
+		k_delayed_work_submit(&stream_work, K_NO_WAIT);
+	}
+}
+
+static struct bt_conn_cb stream_conn_cb = {
+	.disconnected = stream_disconnected,
+};
+
+int nus_stream_send(struct bt_conn *conn, const u8_t *data, size_t len)
+{
+	unsigned int key;
+	u32_t queued;
+
+	if (!conn) {
+		return -EINVAL;
+	}
+
+	if (!notify_enabled) {
+		return -EFAULT;
+	}
+
+	key = irq_lock();
+	if (stream_conn && (stream_conn != conn)) {
+		irq_unlock(key);
+		return -EBUSY;
+	}
+	if (!stream_conn) {
+		stream_conn = bt_conn_ref(conn);
+	}
+	queued = ring_buf_put(&stream_buf, data, len);
+	irq_unlock(key);
+
+	k_delayed_work_submit(&stream_work, K_NO_WAIT);
+
+	return queued;
+}
+#endif /* CONFIG_BT_GATT_NUS_STREAM */
+
 int nus_init(struct bt_nus_cb *callbacks)
 {
 	if (callbacks) {
-		nus_cb.received_cb = callbacks->received_cb;
-		nus_cb.sent_cb     = callbacks->sent_cb;
+		nus_cb.received_cb     = callbacks->received_cb;
+		nus_cb.sent_cb         = callbacks->sent_cb;
+		nus_cb.stream_space_cb = callbacks->stream_space_cb;
+	}
+
+#if CONFIG_BT_GATT_NUS_STREAM
+	if (!stream_initialized) {
+		k_delayed_work_init(&stream_work, stream_work_handler);
+		bt_conn_cb_register(&stream_conn_cb);
+		stream_initialized = true;
 	}
+#endif
 
 	return bt_gatt_service_register(&nus_svc);
 }
@@ -9,6 +9,7 @@
 #include <misc/printk.h>
 #include <string.h>
 #include <zephyr/types.h>
+#include <misc/byteorder.h>
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/conn.h>
@@ -20,33 +21,244 @@
 
 static struct metrics met;
 
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+static struct throughput_stats rx_stats;
+static struct bt_gatt_ccc_cfg ccc_cfg[BT_GATT_CCC_MAX];
+static bool notify_enabled;
+static u32_t tx_seq;
+static u8_t tx_buf[CONFIG_BT_L2CAP_TX_MTU - 3];
+
+/* Headers of received packets to be echoed back to the client. */
+K_MSGQ_DEFINE(echo_msgq, sizeof(struct throughput_pkt_hdr), 16, 4);
+static struct k_work echo_work;
+
+/* Copy of the receive statistics printed outside of the GATT callback. */
+static struct throughput_stats print_stats;
+static struct k_work print_work;
+
+/* Test packets requested by the client, sent as notifications. */
+static struct bt_conn *notify_conn;
+static u32_t notify_remaining;
+static u16_t notify_len;
+static atomic_t notify_inflight;
+static struct k_work notify_work;
+
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / 1000);
+}
+
+static void hist_add(struct throughput_hist *hist, u32_t us)
+{
+	size_t bin = 0;
+
+	if (us > 1) {
+		bin = MIN(31 - __builtin_clz(us), ARRAY_SIZE(hist->bins) - 1);
+	}
+
+	hist->bins[bin]++;
+	hist->min = hist->cnt ? MIN(hist->min, us) : us;
+	hist->max = MAX(hist->max, us);
+	hist->sum += us;
+	hist->cnt++;
+}
+
+u32_t throughput_hist_percentile(const struct throughput_hist *hist,
+				 u8_t percent)
+{
+	u32_t rank = ((u64_t)hist->cnt * percent + 99) / 100;
+	u32_t cnt = 0;
+
+	if (!hist->cnt) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(hist->bins); i++) {
+		cnt += hist->bins[i];
+		if (cnt >= rank) {
+			return MIN((u32_t)((2ULL << i) - 1), hist->max);
+		}
+	}
+
+	return hist->max;
+}
+
+void throughput_stats_reset(struct throughput_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+void throughput_pkt_fill(u8_t *buf, u32_t seq)
+{
+	struct throughput_pkt_hdr hdr = {
+		.seq = sys_cpu_to_le32(seq),
+		.timestamp = sys_cpu_to_le32(k_cycle_get_32()),
+	};
+
+	memcpy(buf, &hdr, sizeof(hdr));
+}
+
+void throughput_stats_rx(struct throughput_stats *stats, const u8_t *data,
+			 u16_t len)
+{
+	struct throughput_pkt_hdr hdr;
+	u32_t now = k_cycle_get_32();
+
+	stats->last = k_uptime_get();
+	if (stats->pkt_cnt) {
+		hist_add(&stats->interval,
+			 cycles_to_us(now - stats->last_cycles));
+	} else {
+		stats->start = stats->last;
+	}
+	stats->last_cycles = now;
+	stats->pkt_cnt++;
+	stats->bytes += len;
+
+	if (len < sizeof(hdr)) {
+		return;
+	}
+
+	memcpy(&hdr, data, sizeof(hdr));
+	hdr.seq = sys_le32_to_cpu(hdr.seq);
+	if (hdr.seq > stats->next_seq) {
+		stats->lost += hdr.seq - stats->next_seq;
+	}
+	stats->next_seq = hdr.seq + 1;
+}
+
+void throughput_stats_echo(struct throughput_stats *stats, const u8_t *data,
+			   u16_t len)
+{
+	struct throughput_pkt_hdr hdr;
+
+	if (len != sizeof(hdr)) {
+		return;
+	}
+
+	memcpy(&hdr, data, sizeof(hdr));
+	hist_add(&stats->rtt,
+		 cycles_to_us(k_cycle_get_32() -
+			      sys_le32_to_cpu(hdr.timestamp)));
+}
+
+static void hist_print(const char *name, const struct throughput_hist *hist)
+{
+	printk("\"%s\":{\"cnt\":%u,\"min\":%u,\"avg\":%u,\"p50\":%u,"
+	       "\"p90\":%u,\"p99\":%u,\"max\":%u}",
+	       name, hist->cnt, hist->min,
+	       hist->cnt ? (u32_t)(hist->sum / hist->cnt) : 0,
+	       throughput_hist_percentile(hist, 50),
+	       throughput_hist_percentile(hist, 90),
+	       throughput_hist_percentile(hist, 99), hist->max);
+}
+
+void throughput_stats_print(const char *name,
+			    const struct throughput_stats *stats)
+{
+	s64_t duration = stats->last - stats->start;
+	u32_t goodput = 0;
+
+	if (duration > 0) {
+		goodput = ((u64_t)stats->bytes << 3) * 1000 / duration;
+	}
+
+	printk("{\"name\":\"%s\",\"packets\":%u,\"bytes\":%u,"
+	       "\"lost\":%u,\"duration_ms\":%u,\"goodput_bps\":%u,",
+	       name, stats->pkt_cnt, stats->bytes, stats->lost,
+	       (u32_t)duration, goodput);
+	hist_print("interval_us", &stats->interval);
+	printk(",");
+	hist_print("rtt_us", &stats->rtt);
+	printk("}\n");
+}
+
+static void print_work_handler(struct k_work *work)
+{
+	throughput_stats_print("server_rx", &print_stats);
+}
+
+static void ccc_cfg_changed(const struct bt_gatt_attr *attr, u16_t value)
+{
+	notify_enabled = (value & BT_GATT_CCC_NOTIFY) ? true : false;
+}
+
+static void notify_ctrl(struct bt_conn *conn, const void *buf, u16_t len)
+{
+	struct throughput_ctrl ctrl = {0};
+	unsigned int key;
+
+	if (len == sizeof(ctrl)) {
+		memcpy(&ctrl, buf, sizeof(ctrl));
+	}
+
+	key = irq_lock();
+	if (!notify_conn || (notify_conn == conn)) {
+		notify_remaining = sys_le32_to_cpu(ctrl.notify_cnt);
+		notify_len = sys_le16_to_cpu(ctrl.notify_len);
+		if (notify_remaining && !notify_conn) {
+			notify_conn = bt_conn_ref(conn);
+		}
+	}
+	irq_unlock(key);
+
+	k_work_submit(&notify_work);
+}
+#endif /* CONFIG_BT_GATT_THROUGHPUT_STATS */
+
+static bool is_reset(u16_t len)
+{
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+	if (len == sizeof(struct throughput_ctrl)) {
+		return true;
+	}
+#endif
+	return (len == 1);
+}
+
 static ssize_t write_callback(struct bt_conn *conn,
 			      const struct bt_gatt_attr *attr, const void *buf,
 			      u16_t len, u16_t offset, u8_t flags)
 {
-	static u32_t clock_cycles;
+	static s64_t start;
 	static u32_t kb;
 
-	u64_t delta;
+	s64_t delta;
 
 	struct metrics *met_data = attr->user_data;
 
-	delta = k_cycle_get_32() - clock_cycles;
-	delta = SYS_CLOCK_HW_CYCLES_TO_NS64(delta);
-
-	if (len == 1) {
+	if (is_reset(len)) {
 		/* reset metrics */
 		kb = 0;
 		met_data->write_count = 0;
 		met_data->write_len = 0;
 		met_data->write_rate = 0;
-		clock_cycles = k_cycle_get_32();
+		start = k_uptime_get();
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+		throughput_stats_reset(&rx_stats);
+		k_msgq_purge(&echo_msgq);
+		tx_seq = 0;
+		notify_ctrl(conn, buf, len);
+#endif
 		printk("\n");
 	} else {
 		met_data->write_count++;
 		met_data->write_len += len;
-		met_data->write_rate =
-		    ((u64_t)met_data->write_len << 3) * 1000000000 / delta;
+
+		delta = k_uptime_get() - start;
+		if (delta > 0) {
+			met_data->write_rate =
+			    ((u64_t)met_data->write_len << 3) * 1000 / delta;
+		}
+
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+		throughput_stats_rx(&rx_stats, buf, len);
+		if (notify_enabled &&
+		    (len >= sizeof(struct throughput_pkt_hdr)) &&
+		    !k_msgq_put(&echo_msgq, buf, K_NO_WAIT)) {
+			k_work_submit(&echo_work);
+		}
+#endif
 
 		if ((met_data->write_len / 1024) != kb) {
 			kb = (met_data->write_len / 1024);
@@ -68,6 +280,12 @@ static ssize_t read_callback(struct bt_conn *conn,
 	       " in %u GATT writes at %u bps\n",
 	       metrics->write_len, metrics->write_len / 1024,
 	       metrics->write_count, metrics->write_rate);
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+	if (!k_work_pending(&print_work)) {
+		print_stats = rx_stats;
+		k_work_submit(&print_work);
+	}
+#endif
 
 	return bt_gatt_attr_read(
 		conn, attr, buf, len, offset, attr->user_data, len);
@@ -76,15 +294,123 @@ static ssize_t read_callback(struct bt_conn *conn,
 /* Throughput service declaration */
 static struct bt_gatt_attr attrs[] = {
 	BT_GATT_PRIMARY_SERVICE(BT_UUID_THROUGHPUT),
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+	BT_GATT_CHARACTERISTIC(BT_UUID_THROUGHPUT_CHAR,
+		BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE |
+		BT_GATT_CHRC_WRITE_WITHOUT_RESP | BT_GATT_CHRC_NOTIFY,
+		BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+		read_callback, write_callback, &met),
+	BT_GATT_CCC(ccc_cfg, ccc_cfg_changed),
+#else
 	BT_GATT_CHARACTERISTIC(BT_UUID_THROUGHPUT_CHAR,
 		BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
 		BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
 		read_callback, write_callback, &met),
+#endif
 };
 
 static struct bt_gatt_service throughput_svc = BT_GATT_SERVICE(attrs);
 
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+int throughput_send(struct bt_conn *conn, u16_t len,
+		    bt_gatt_complete_func_t cb)
+{
+	if (!notify_enabled) {
+		return -EACCES;
+	}
+
+	if ((len <= sizeof(struct throughput_pkt_hdr)) ||
+	    (len > sizeof(tx_buf)) || (len > bt_gatt_get_mtu(conn) - 3)) {
+		return -EINVAL;
+	}
+
+	throughput_pkt_fill(tx_buf, tx_seq++);
+
+	return bt_gatt_notify_cb(conn, &attrs[2], tx_buf, len, cb);
+}
+
+static void notify_sent(struct bt_conn *conn)
+{
+	if (conn != notify_conn) {
+		return;
+	}
+
+	atomic_dec(&notify_inflight);
+	k_work_submit(&notify_work);
+}
+
+static void notify_work_handler(struct k_work *work)
+{
+	struct bt_conn *conn = notify_conn;
+	unsigned int key;
+
+	if (!conn) {
+		return;
+	}
+
+	while (notify_remaining &&
+	       (atomic_get(&notify_inflight) <
+		CONFIG_BT_GATT_THROUGHPUT_NOTIFY_INFLIGHT_MAX)) {
+		int err;
+
+		err = throughput_send(conn, notify_len, notify_sent);
+		if (err) {
+			printk("Test notification failed (err %d)\n", err);
+			notify_remaining = 0;
+			break;
+		}
+
+		atomic_inc(&notify_inflight);
+		notify_remaining--;
+	}
+
+	/* Release the connection once everything has been sent. */
+	key = irq_lock();
+	if (!notify_remaining && !atomic_get(&notify_inflight)) {
+		notify_conn = NULL;
+	} else {
+		conn = NULL;
+	}
+	irq_unlock(key);
+
+	if (conn) {
+		bt_conn_unref(conn);
+	}
+}
+
+static void notify_disconnected(struct bt_conn *conn, u8_t reason)
+{
+	if (conn == notify_conn) {
+		/* Notifications in flight are not completed. */
+		notify_remaining = 0;
+		atomic_set(&notify_inflight, 0);
+		k_work_submit(&notify_work);
+	}
+}
+
+static struct bt_conn_cb notify_conn_cb = {
+	.disconnected = notify_disconnected,
+};
+
+static void echo_work_handler(struct k_work *work)
+{
+	struct throughput_pkt_hdr hdr;
+
+	while (!k_msgq_get(&echo_msgq, &hdr, K_NO_WAIT)) {
+		if (notify_enabled) {
+			bt_gatt_notify(NULL, &attrs[2], &hdr, sizeof(hdr));
+		}
+	}
+}
+#endif /* CONFIG_BT_GATT_THROUGHPUT_STATS */
+
 void throughput_init(void)
 {
+#if CONFIG_BT_GATT_THROUGHPUT_STATS
+	k_work_init(&echo_work, echo_work_handler);
+	k_work_init(&print_work, print_work_handler);
+	k_work_init(&notify_work, notify_work_handler);
+	bt_conn_cb_register(&notify_conn_cb);
+#endif
 	bt_gatt_service_register(&throughput_svc);
 }
@@ -24,3 +24,18 @@ int crypto_root_of_trust(const u8_t *pk, const u8_t *pk_hash,
 	}
 	return 0;
 }
+
+int crypto_root_of_trust_hash(const u8_t *pk, const u8_t *pk_hash,
+			      const u8_t *sig, const u8_t *fw_hash)
+{
+	__ASSERT(pk && pk_hash && sig && fw_hash, "A parameter was NULL.");
+	if (!verify_truncated_hash(pk, CONFIG_SB_PUBLIC_KEY_LEN, pk_hash,
+				   CONFIG_SB_PUBLIC_KEY_HASH_LEN)) {
+		return -EPKHASHINV;
+	}
+
+	if (!verify_sig_hash(fw_hash, sig, pk)) {
+		return -ESIGINV;
+	}
+	return 0;
+}
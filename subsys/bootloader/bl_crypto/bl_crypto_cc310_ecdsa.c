@@ -10,18 +10,12 @@
 #include "bl_crypto_internal.h"
 #include "bl_crypto_cc310_common.h"
 
-bool verify_sig(const u8_t *data, u32_t data_len, const u8_t *sig,
-		const u8_t *pk)
+bool verify_sig_hash(const u8_t *hash, const u8_t *sig, const u8_t *pk)
 {
 	nrf_cc310_bl_ecdsa_verify_context_secp256r1_t context;
-	nrf_cc310_bl_hash_digest_sha256_t hash1;
 	nrf_cc310_bl_hash_digest_sha256_t hash2;
 
-	if (!get_hash((u8_t *)&hash1, data, data_len)) {
-		return false;
-	}
-
-	if (!get_hash((u8_t *)&hash2, hash1, CONFIG_SB_HASH_LEN)) {
+	if (!get_hash((u8_t *)&hash2, hash, CONFIG_SB_HASH_LEN)) {
 		return false;
 	}
 
@@ -41,3 +35,15 @@ bool verify_sig(const u8_t *data, u32_t data_len, const u8_t *sig,
 
 	return retval;
 }
+
+bool verify_sig(const u8_t *data, u32_t data_len, const u8_t *sig,
+		const u8_t *pk)
+{
+	nrf_cc310_bl_hash_digest_sha256_t hash1;
+
+	if (!get_hash((u8_t *)&hash1, data, data_len)) {
+		return false;
+	}
+
+	return verify_sig_hash((u8_t *)&hash1, sig, pk);
+}
@@ -10,18 +10,7 @@
 #include <stddef.h>
 #include <zephyr/types.h>
 #include <stdbool.h>
-
-
-/**
- * @brief Get hash of data
- *
- * @param[out] hash     Buffer to store hash in
- * @param[in]  data     Data to produce hash over
- * @param[in]  data_len Length of data to hash
- *
- * @return True if success, false otherwise.
- */
-bool get_hash(u8_t *hash, const u8_t *data, size_t data_len);
+#include <bl_crypto.h>
 
 
 /**
@@ -55,4 +44,13 @@ bool verify_truncated_hash(const u8_t *data, size_t data_len,
 bool verify_sig(const u8_t *data, size_t data_len,
 		const u8_t *sig, const u8_t *pk);
 
+/**
+ * @brief Verify signature of data that has already been hashed.
+ *
+ * @param[in] hash     Hash of the data
+ * @param[in] sig      Expected signature
+ * @param[in] pk       Public Key
+ */
+bool verify_sig_hash(const u8_t *hash, const u8_t *sig, const u8_t *pk);
+
 #endif
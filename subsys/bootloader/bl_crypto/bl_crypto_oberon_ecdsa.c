@@ -10,17 +10,11 @@
 #include <occ_ecdsa_p256.h>
 #include "bl_crypto_internal.h"
 
-bool verify_sig(const u8_t *data, size_t data_len, const u8_t *sig,
-		const u8_t *pk)
+bool verify_sig_hash(const u8_t *hash, const u8_t *sig, const u8_t *pk)
 {
-	u8_t hash1[CONFIG_SB_HASH_LEN];
 	u8_t hash2[CONFIG_SB_HASH_LEN];
 
-	if (!get_hash(hash1, data, data_len)) {
-		return false;
-	}
-
-	if (!get_hash(hash2, hash1, CONFIG_SB_HASH_LEN)) {
+	if (!get_hash(hash2, hash, CONFIG_SB_HASH_LEN)) {
 		return false;
 	}
 
@@ -28,3 +22,15 @@ bool verify_sig(const u8_t *data, size_t data_len, const u8_t *sig,
 
 	return (retval == 0);
 }
+
+bool verify_sig(const u8_t *data, size_t data_len, const u8_t *sig,
+		const u8_t *pk)
+{
+	u8_t hash1[CONFIG_SB_HASH_LEN];
+
+	if (!get_hash(hash1, data, data_len)) {
+		return false;
+	}
+
+	return verify_sig_hash(hash1, sig, pk);
+}
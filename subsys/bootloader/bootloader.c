@@ -21,12 +21,138 @@
 
 #include <provision.h>
 
+#ifdef CONFIG_SB_VERIFY_CYCLES
+static void cycle_counter_start(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void cycle_counter_stop(void)
+{
+	DWT->CTRL &= ~DWT_CTRL_CYCCNTENA_Msk;
+	CoreDebug->DEMCR &= ~CoreDebug_DEMCR_TRCENA_Msk;
+}
+
+/* Override to record the time spent on firmware verification elsewhere. */
+void __weak verify_firmware_cycles_report(u32_t cycles)
+{
+	printk("Firmware verification took %u cycles.\n\r", cycles);
+}
+#endif /* CONFIG_SB_VERIFY_CYCLES */
+
+/* Phases of the boot path timed with CONFIG_SB_BOOT_TIMING. */
+enum boot_phase {
+	BOOT_PHASE_DEBUG_INIT,
+	BOOT_PHASE_FLASH_PROTECT,
+	BOOT_PHASE_METADATA,
+	BOOT_PHASE_SIGNATURE,
+	BOOT_PHASE_COUNT
+};
+
+#ifdef CONFIG_SB_BOOT_TIMING
+static const char * const boot_phase_names[] = {
+	[BOOT_PHASE_DEBUG_INIT] = "debug port init",
+	[BOOT_PHASE_FLASH_PROTECT] = "flash protection",
+	[BOOT_PHASE_METADATA] = "metadata lookup",
+	[BOOT_PHASE_SIGNATURE] = "signature verification",
+};
+
+/* Cycle count at the end of each phase, counted from the start of main_bl.
+ * Phases that were not reached are left at zero.
+ */
+static u32_t boot_phase_end_cycles[BOOT_PHASE_COUNT];
+
+/* Start the cycle counter of CONFIG_SB_VERIFY_CYCLES early, so that it covers
+ * the whole boot path instead of verification only.
+ */
+static void boot_timing_start(void)
+{
+	for (u32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		boot_phase_end_cycles[i] = 0;
+	}
+
+	cycle_counter_start();
+}
+
+static void boot_phase_end(enum boot_phase phase)
+{
+	boot_phase_end_cycles[phase] = DWT->CYCCNT;
+}
+
+/* Override to record the boot phase timings elsewhere. */
+void __weak boot_timing_report(const char *phase, u32_t cycles)
+{
+	printk("Boot phase %s took %u cycles.\n\r", phase, cycles);
+}
+
+static void boot_timing_report_phases(void)
+{
+	u32_t start = 0;
+
+	for (u32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		if (boot_phase_end_cycles[i] == 0) {
+			continue;
+		}
+		boot_timing_report(boot_phase_names[i],
+				   boot_phase_end_cycles[i] - start);
+		start = boot_phase_end_cycles[i];
+	}
+	boot_timing_report("total", start);
+}
+#else
+static void boot_timing_start(void)
+{
+}
+
+static void boot_phase_end(enum boot_phase phase)
+{
+}
+
+static void boot_timing_report_phases(void)
+{
+}
+#endif /* CONFIG_SB_BOOT_TIMING */
+
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+static bool verified_token_match(const struct verified_token *token,
+				 u32_t address,
+				 const struct fw_firmware_info *fw_info,
+				 const u8_t *hash)
+{
+	return token->firmware_address == address &&
+	       token->firmware_size == fw_info->firmware_size &&
+	       token->firmware_version == fw_info->firmware_version &&
+	       memeq(hash, token->firmware_hash, CONFIG_SB_HASH_LEN);
+}
+
+static void verified_token_record(u32_t address,
+				  const struct fw_firmware_info *fw_info,
+				  u32_t key_idx, const u8_t *hash)
+{
+	struct verified_token token = {
+		.firmware_address = address,
+		.firmware_size = fw_info->firmware_size,
+		.firmware_version = fw_info->firmware_version,
+		.key_idx = key_idx,
+	};
+
+	memcpy(token.firmware_hash, hash, CONFIG_SB_HASH_LEN);
+
+	if (verified_token_write(&token) < 0) {
+		printk("No room left for verified token.\n\r");
+	}
+}
+#endif /* CONFIG_SB_VERIFIED_IMAGE_TOKEN */
+
 static bool verify_firmware(u32_t address)
 {
 	int retval = -EFAULT;
 	const struct fw_firmware_info *fw_info;
 	const struct fw_validation_info *fw_ver_info;
 	u8_t key_data[CONFIG_SB_PUBLIC_KEY_HASH_LEN];
+	u8_t fw_hash[CONFIG_SB_HASH_LEN];
 
 	fw_info = firmware_info_get(address);
 
@@ -46,25 +172,52 @@ static bool verify_firmware(u32_t address)
 		return false;
 	}
 
+	boot_phase_end(BOOT_PHASE_METADATA);
+
 	u32_t num_public_keys = num_public_keys_read();
+	u32_t first_key_idx = 0;
+	u32_t key_data_idx = 0;
 
-	for (u32_t key_data_idx = 0; key_data_idx < num_public_keys;
-			key_data_idx++) {
+	/* The image is hashed once, for the verified token and for the
+	 * signature verification with every public key.
+	 */
+	if (!get_hash(fw_hash, (const u8_t *)address,
+		      fw_info->firmware_size)) {
+		printk("Could not hash firmware. Aborting boot!\n\r");
+		return false;
+	}
+
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+	const struct verified_token *token = verified_token_read();
+
+	if (token && token->key_idx < num_public_keys) {
+		if (verified_token_match(token, address, fw_info, fw_hash)) {
+			printk("Firmware matches verified token.\n\r");
+			boot_phase_end(BOOT_PHASE_SIGNATURE);
+			return true;
+		}
+		first_key_idx = token->key_idx;
+	}
+#endif
+
+	for (u32_t i = 0; i < num_public_keys; i++) {
+		key_data_idx = (first_key_idx + i) % num_public_keys;
 		if (public_key_data_read(key_data_idx, &key_data[0],
 				CONFIG_SB_PUBLIC_KEY_HASH_LEN) < 0) {
 			retval = -EFAULT;
 			break;
 		}
-		retval = crypto_root_of_trust(fw_ver_info->public_key,
-					      key_data,
-					      fw_ver_info->signature,
-					      (u8_t *)address,
-					      fw_info->firmware_size);
+		retval = crypto_root_of_trust_hash(fw_ver_info->public_key,
+						   key_data,
+						   fw_ver_info->signature,
+						   fw_hash);
 		if (retval != -ESIGINV) {
 			break;
 		}
 	}
 
+	boot_phase_end(BOOT_PHASE_SIGNATURE);
+
 	if (retval != 0) {
 		printk("Firmware validation failed with error %d. "
 			    "Aborting boot!\n\r",
@@ -72,9 +225,44 @@ static bool verify_firmware(u32_t address)
 		return false;
 	}
 
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+	verified_token_record(address, fw_info, key_data_idx, fw_hash);
+#endif
+
 	return true;
 }
 
+#ifdef CONFIG_SB_VERIFY_CYCLES
+static bool verify_firmware_timed(u32_t address)
+{
+	u32_t start;
+	u32_t end;
+	bool valid;
+
+	/* With CONFIG_SB_BOOT_TIMING, the counter runs since main_bl. */
+	if (!IS_ENABLED(CONFIG_SB_BOOT_TIMING)) {
+		cycle_counter_start();
+	}
+
+	start = DWT->CYCCNT;
+	valid = verify_firmware(address);
+	end = DWT->CYCCNT;
+	cycle_counter_stop();
+
+	/* Report only once verification is done, because printing on the
+	 * debug port would otherwise add to the timings.
+	 */
+	verify_firmware_cycles_report(end - start);
+
+	return valid;
+}
+#else
+static bool verify_firmware_timed(u32_t address)
+{
+	return verify_firmware(address);
+}
+#endif /* CONFIG_SB_VERIFY_CYCLES */
+
 void uninit_used_peripherals(void)
 {
 	/* We do not want to uninitialize cryptocell as we want to retain the
@@ -94,9 +282,24 @@ extern u32_t _vector_table_pointer;
 
 static void boot_from(u32_t *address)
 {
-	if (!verify_firmware((u32_t)address)) {
+	bool valid = verify_firmware_timed((u32_t)address);
+
+	boot_timing_report_phases();
+
+	if (!valid) {
+		return;
+	}
+
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+	/* The verified token is recorded in the provision page, so it is
+	 * protected only now.
+	 */
+	if (fprotect_area(DT_FLASH_AREA_PROVISION_OFFSET,
+			  DT_FLASH_AREA_PROVISION_SIZE) != 0) {
+		printk("Protect provision data failed, cancel startup.\n\r");
 		return;
 	}
+#endif
 
 	__ASSERT(!(CONTROL_nPRIV_Msk & __get_CONTROL()),
 			"Not in Privileged mode");
@@ -152,11 +355,15 @@ static void boot_from(u32_t *address)
 void _Cstart(void) __attribute__((alias("main_bl")));
 void main_bl(void)
 {
+	boot_timing_start();
+
 #if defined(CONFIG_SB_DEBUG_PORT_SEGGER_RTT)
 	SEGGER_RTT_Init();
 #elif defined(CONFIG_SB_DEBUG_PORT_UART)
 	uart_init();
 #endif /* CONFIG_SB_RTT */
+	boot_phase_end(BOOT_PHASE_DEBUG_INIT);
+
 #if CONFIG_SB_FLASH_PROTECT
 	int err;
 	err = fprotect_area(DT_FLASH_AREA_SECURE_BOOT_OFFSET,
@@ -166,16 +373,17 @@ void main_bl(void)
 		return;
 	}
 
-#ifndef CONFIG_SOC_NRF9160
+#if !defined(CONFIG_SOC_NRF9160) && !defined(CONFIG_SB_VERIFIED_IMAGE_TOKEN)
 	err = fprotect_area(DT_FLASH_AREA_PROVISION_OFFSET,
 			DT_FLASH_AREA_PROVISION_SIZE);
 	if (err) {
 		printk("Protect provision data failed, cancel startup.\n\r");
 		return;
 	}
-#endif /* CONFIG_SOC_NRF9160 */
+#endif /* !CONFIG_SOC_NRF9160 && !CONFIG_SB_VERIFIED_IMAGE_TOKEN */
 
 #endif /* CONFIG_SB_FLASH_PROTECT */
+	boot_phase_end(BOOT_PHASE_FLASH_PROTECT);
 
 	boot_from((u32_t *)(0x00000000 + DT_FLASH_AREA_APP_OFFSET));
 	CODE_UNREACHABLE;
@@ -7,6 +7,8 @@
 #ifndef BOOTLOADER_CRYPTO_H__
 #define BOOTLOADER_CRYPTO_H__
 
+#include <stddef.h>
+#include <stdbool.h>
 #include <zephyr/types.h>
 
 /* Placeholder defines. Values should be updated, if no existing errors can be
@@ -40,5 +42,40 @@ int crypto_root_of_trust(const u8_t *pk,
 		const u8_t *fw,
 		const u32_t fw_len);
 
+/**
+ * @brief Verify a signature of firmware that has already been hashed
+ *
+ * Like @ref crypto_root_of_trust, but takes the hash of the firmware, so
+ * that the caller can also use the hash for other purposes without
+ * calculating it again.
+ *
+ * @param[in]  pk            Public key.
+ * @param[in]  pk_hash       Expected hash of the public key. This is the root
+ *                           of trust.
+ * @param[in]  sig           Signature
+ * @param[in]  fw_hash       Hash of the firmware, as given by get_hash.
+ *
+ * @retval 0            On success.
+ * @retval -EPKHASHINV  If pk_hash didn't match pk.
+ * @retval -ESIGINV     If signature validation failed.
+ *
+ * @remark No parameter can be NULL.
+ */
+int crypto_root_of_trust_hash(const u8_t *pk,
+		const u8_t *pk_hash,
+		const u8_t *sig,
+		const u8_t *fw_hash);
+
+/**
+ * @brief Get hash of data
+ *
+ * @param[out] hash     Buffer to store hash in
+ * @param[in]  data     Data to produce hash over
+ * @param[in]  data_len Length of data to hash
+ *
+ * @return True if success, false otherwise.
+ */
+bool get_hash(u8_t *hash, const u8_t *data, size_t data_len);
+
 #endif
 
@@ -53,6 +53,43 @@ u32_t num_public_keys_read(void);
  */
 int public_key_data_read(u32_t key_idx, u8_t *p_buf, size_t buf_size);
 
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+/**
+ * @brief Record of an image that has passed signature verification.
+ *
+ * The magic value is the last member, since it is written last and marks
+ * the token as complete.
+ */
+struct verified_token {
+	u32_t firmware_address;
+	u32_t firmware_size;
+	u32_t firmware_version;
+	u32_t key_idx;
+	u8_t firmware_hash[CONFIG_SB_HASH_LEN];
+	u32_t magic;
+};
+
+/**
+ * @brief Function for reading the most recently recorded verified token.
+ *
+ * @return Pointer to the token in flash, or NULL if no token was recorded.
+ */
+const struct verified_token *verified_token_read(void);
+
+/**
+ * @brief Function for recording a verified token.
+ *
+ * The token is appended to the tokens recorded before. This must be done
+ * before the provision data is protected against writes.
+ *
+ * @param[in] token Token to record. The magic value is set by the function.
+ *
+ * @retval 0       On success.
+ * @retval -ENOSPC If there is no room left for another token.
+ */
+int verified_token_write(const struct verified_token *token);
+#endif /* CONFIG_SB_VERIFIED_IMAGE_TOKEN */
+
 #ifdef __cplusplus
 }
 #endif
@@ -52,3 +52,103 @@ int public_key_data_read(u32_t key_idx, u8_t *p_buf, size_t buf_size)
 
 	return CONFIG_SB_PUBLIC_KEY_HASH_LEN;
 }
+
+#ifdef CONFIG_SB_VERIFIED_IMAGE_TOKEN
+#include <nrf.h>
+#include <stddef.h>
+#include <toolchain.h>
+
+#define VERIFIED_TOKEN_MAGIC 0x6b6f7456 /* "Vtok" */
+
+/* Tokens are appended to the second half of the provision page, which the
+ * provision data leaves erased. The page is never erased again, so that the
+ * provision data stays intact.
+ */
+#define TOKEN_AREA_ADDRESS (DT_FLASH_AREA_PROVISION_OFFSET + \
+			    (DT_FLASH_AREA_PROVISION_SIZE / 2))
+#define TOKEN_COUNT ((DT_FLASH_AREA_PROVISION_SIZE / 2) / \
+		     sizeof(struct verified_token))
+#define TOKEN_LEN_WORDS (sizeof(struct verified_token) / sizeof(u32_t))
+
+BUILD_ASSERT_MSG(offsetof(provision_flash_t, pkd) +
+		 SB_NUM_PUBLIC_KEYS * CONFIG_SB_PUBLIC_KEY_HASH_LEN <=
+		 DT_FLASH_AREA_PROVISION_SIZE / 2,
+		 "Provision data does not fit in the first half of the "
+		 "provision page.");
+BUILD_ASSERT_MSG(TOKEN_COUNT > 0, "No room for a verified token.");
+
+static const struct verified_token *p_tokens =
+	(struct verified_token *)TOKEN_AREA_ADDRESS;
+
+static bool token_erased(const struct verified_token *token)
+{
+	const u32_t *words = (const u32_t *)token;
+
+	for (size_t i = 0; i < TOKEN_LEN_WORDS; i++) {
+		if (words[i] != 0xFFFFFFFF) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const struct verified_token *verified_token_read(void)
+{
+	const struct verified_token *token = NULL;
+
+	/* Tokens that were cut short by a reset have no magic value, and are
+	 * skipped.
+	 */
+	for (size_t i = 0; i < TOKEN_COUNT; i++) {
+		if (p_tokens[i].magic == VERIFIED_TOKEN_MAGIC) {
+			token = &p_tokens[i];
+		} else if (token_erased(&p_tokens[i])) {
+			break;
+		}
+	}
+
+	return token;
+}
+
+static void nvmc_wait_ready(void)
+{
+	while (NRF_NVMC->READY == NVMC_READY_READY_Busy) {
+		;
+	}
+}
+
+int verified_token_write(const struct verified_token *token)
+{
+	struct verified_token new_token = *token;
+	const u32_t *words = (const u32_t *)&new_token;
+	volatile u32_t *dest = NULL;
+
+	for (size_t i = 0; i < TOKEN_COUNT; i++) {
+		if (token_erased(&p_tokens[i])) {
+			dest = (volatile u32_t *)&p_tokens[i];
+			break;
+		}
+	}
+
+	if (!dest) {
+		return -ENOSPC;
+	}
+
+	new_token.magic = VERIFIED_TOKEN_MAGIC;
+
+	NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen;
+	nvmc_wait_ready();
+
+	/* The magic value is the last word, so it is written last. */
+	for (size_t i = 0; i < TOKEN_LEN_WORDS; i++) {
+		dest[i] = words[i];
+		nvmc_wait_ready();
+	}
+
+	NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren;
+	nvmc_wait_ready();
+
+	return 0;
+}
+#endif /* CONFIG_SB_VERIFIED_IMAGE_TOKEN */
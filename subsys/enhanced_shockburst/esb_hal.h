@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Peripheral access of the Enhanced ShockBurst module.
+ *
+ * Registers are accessed directly, except for the operations that have side
+ * effects on write: tasks, PPI channel enabling, and interrupt connection.
+ * These go through the macros below, so that the simulated radio can model
+ * them when CONFIG_NRF_ESB_SIM is enabled. So does the time in microseconds,
+ * which the simulation keeps in virtual time. The time is 64 bits wide, so
+ * that the hop slots computed from it do not jump when a counter wraps.
+ */
+#ifndef ESB_HAL_H__
+#define ESB_HAL_H__
+
+#include <irq.h>
+#include <kernel.h>
+#include <nrf.h>
+#include <zephyr/types.h>
+
+#if CONFIG_NRF_ESB_SIM
+
+void esb_sim_task_trigger(volatile u32_t *task);
+void esb_sim_ppi_enable(u32_t mask);
+void esb_sim_ppi_disable(u32_t mask);
+void esb_sim_irq_connect(u32_t irq, u32_t priority, void (*isr)(void));
+u64_t esb_sim_time_us(void);
+
+#define ESB_TASK_TRIGGER(_task) esb_sim_task_trigger(&(_task))
+#define ESB_PPI_ENABLE(_mask) esb_sim_ppi_enable(_mask)
+#define ESB_PPI_DISABLE(_mask) esb_sim_ppi_disable(_mask)
+#define ESB_IRQ_CONNECT(_irq, _priority, _isr)                                 \
+	esb_sim_irq_connect(_irq, _priority, _isr)
+#define ESB_TIME_US() esb_sim_time_us()
+
+#else
+
+#define ESB_TASK_TRIGGER(_task) ((_task) = 1)
+#define ESB_PPI_ENABLE(_mask) (NRF_PPI->CHENSET = (_mask))
+#define ESB_PPI_DISABLE(_mask) (NRF_PPI->CHENCLR = (_mask))
+#define ESB_IRQ_CONNECT(_irq, _priority, _isr)                                 \
+	IRQ_DIRECT_CONNECT(_irq, _priority, _isr, 0)
+#define ESB_TIME_US() esb_time_us()
+
+/* Time in microseconds from the hardware cycle counter, extended to 64 bits.
+ * It must be read at least once per period of the counter, which a PTX does
+ * at every TX attempt.
+ */
+static inline u64_t esb_time_us(void)
+{
+	static u32_t last_cycles;
+	static u64_t cycles;
+	u32_t key = irq_lock();
+	u32_t now = k_cycle_get_32();
+
+	cycles += now - last_cycles;
+	last_cycles = now;
+
+	irq_unlock(key);
+
+	return cycles * USEC_PER_SEC / sys_clock_hw_cycles_per_sec();
+}
+
+#endif /* CONFIG_NRF_ESB_SIM */
+
+#endif /* ESB_HAL_H__ */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Channel hopping of an Enhanced ShockBurst PTX.
+ *
+ * The PRX moves on to the next channel of the hop sequence once per hop slot,
+ * and after every exchange. A PTX follows it from the channel and the time of
+ * the last exchange. The functions below keep this state, so that the module
+ * and the simulated peers of CONFIG_NRF_ESB_SIM follow the PRX in the same
+ * way.
+ */
+#ifndef ESB_HOP_H__
+#define ESB_HOP_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#if CONFIG_NRF_ESB_HOPPING
+
+/* Time before the end of a hop slot after which a PTX does not start a packet,
+ * so that the PRX does not move on while it receives the packet.
+ */
+#define ESB_HOP_SLOT_GUARD_US 400
+/* Failed TX attempts after which a PTX searches the hop sequence for the PRX.
+ */
+#define ESB_HOP_SEARCH_ATTEMPTS 8
+
+/* Channel hopping state of a PTX. */
+struct esb_hop_ptx {
+	u8_t anchor;	/* Position of the PRX after the last exchange. */
+	u64_t anchor_us; /* Time of the last exchange. */
+	/* Position of the PRX after the last failed attempt, and time of
+	 * the attempt, had only its acknowledgment been lost.
+	 */
+	u8_t lost_anchor;
+	u64_t lost_anchor_us;
+	u32_t failures;	/* Failed TX attempts since the last exchange. */
+};
+
+static inline void esb_hop_ptx_reset(struct esb_hop_ptx *hop, u64_t time_us)
+{
+	hop->anchor = 0;
+	hop->anchor_us = time_us;
+	hop->lost_anchor = hop->anchor;
+	hop->lost_anchor_us = hop->anchor_us;
+	hop->failures = 0;
+}
+
+/* Whether the next TX attempt assumes that only the acknowledgment of the
+ * previous attempt was lost, and the PRX moved on. Every third attempt after
+ * a failure does.
+ */
+static inline bool esb_hop_ptx_ack_lost(const struct esb_hop_ptx *hop)
+{
+	return (hop->failures % 3) == 1;
+}
+
+static inline bool esb_hop_ptx_searching(const struct esb_hop_ptx *hop)
+{
+	return hop->failures >= ESB_HOP_SEARCH_ATTEMPTS;
+}
+
+/* Find the position of the PRX in a hop sequence of count channels at the
+ * given time. A PTX that lost the PRX stays on one channel for a round of the
+ * PRX through the sequence, so that the PRX comes by, before it tries the next
+ * channel.
+ *
+ * Returns the time left in the slot of the PRX.
+ */
+static inline u32_t esb_hop_ptx_locate(const struct esb_hop_ptx *hop,
+				       u8_t count, u64_t time_us, u8_t *index)
+{
+	bool searching = esb_hop_ptx_searching(hop);
+	bool ack_lost = !searching && esb_hop_ptx_ack_lost(hop);
+	u8_t anchor = ack_lost ? hop->lost_anchor : hop->anchor;
+	u64_t elapsed_us =
+		time_us - (ack_lost ? hop->lost_anchor_us : hop->anchor_us);
+	u64_t slot = elapsed_us / CONFIG_NRF_ESB_HOP_SLOT_US;
+
+	if (searching) {
+		slot /= count;
+	}
+
+	*index = (anchor + slot) % count;
+
+	return CONFIG_NRF_ESB_HOP_SLOT_US -
+	       elapsed_us % CONFIG_NRF_ESB_HOP_SLOT_US;
+}
+
+/* Take the channel at the given position as the one on which the PTX and the
+ * PRX last exchanged a packet.
+ */
+static inline void esb_hop_ptx_sync(struct esb_hop_ptx *hop, u8_t count,
+				    u8_t index, u64_t time_us)
+{
+	hop->anchor = (index + 1) % count;
+	hop->anchor_us = time_us;
+	hop->failures = 0;
+}
+
+/* Account for a TX attempt on the channel at the given position. */
+static inline void esb_hop_ptx_attempt(struct esb_hop_ptx *hop, u8_t count,
+				       u8_t index, bool acked, u64_t time_us)
+{
+	if (acked) {
+		esb_hop_ptx_sync(hop, count, index, time_us);
+		return;
+	}
+
+	if (!esb_hop_ptx_ack_lost(hop)) {
+		hop->lost_anchor = (index + 1) % count;
+		hop->lost_anchor_us = time_us;
+	}
+
+	hop->failures++;
+}
+
+#endif /* CONFIG_NRF_ESB_HOPPING */
+
+#endif /* ESB_HOP_H__ */
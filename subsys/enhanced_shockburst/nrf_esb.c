@@ -12,6 +12,9 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "esb_hal.h"
+#include "esb_hop.h"
+
 /* Constants */
 
 /* 2 Mb RX wait for acknowledgment time-out value.
@@ -28,6 +31,27 @@
 /* Minimum retransmit time */
 #define RETRANSMIT_DELAY_MIN 435
 
+/* Radio ramp-up time in the default ramp-up mode. */
+#define RADIO_RAMP_UP_US 130
+
+/* Bytes of an acknowledgment besides the address and payload: preamble,
+ * header, and CRC, rounded up.
+ */
+#define ACK_OVERHEAD_BYTES 6
+/* Time for the PRX to process a packet before its acknowledgment. */
+#define ACK_TURNAROUND_MARGIN_US 50
+
+/* Weight of a new RSSI sample in the moving average, as a power of two. */
+#define RSSI_AVG_SHIFT 3
+
+/* Channel quality for a success ratio of one. */
+#define HOP_QUALITY_MAX 255
+/* Weight of a new exchange in the channel quality, as a power of two. */
+#define HOP_QUALITY_SHIFT 3
+/* Channel quality below which a channel is blacklisted. */
+#define HOP_QUALITY_THRESHOLD                                                  \
+	((CONFIG_NRF_ESB_HOP_BLACKLIST_THRESHOLD * HOP_QUALITY_MAX) / 100)
+
 /* Interrupt flags */
 /* Interrupt mask value for TX success. */
 #define INT_TX_SUCCESS_MSK 0x01
@@ -46,6 +70,14 @@
  /* The maximum value for PID. */
 #define PID_MAX 3
 
+/* Length of the S0 or length field and the S1 field in the radio packet. */
+#define RF_HDR_LEN 2
+
+/* Number of RX FIFO slots. One slot more than the FIFO size is allocated so
+ * that the radio always has a free slot to receive into.
+ */
+#define RX_FIFO_SLOTS (CONFIG_NRF_ESB_RX_FIFO_SIZE + 1)
+
 #define BIT_MASK_UINT_8(x) (0xFF >> (8 - (x)))
 
 #define RADIO_SHORTS_COMMON                                                    \
@@ -120,24 +152,42 @@ struct pipe_info {
 	bool ack_payload; /* State of the transmission of ACK payloads. */
 };
 
+/* Payload stored in a FIFO slot.
+ *
+ * The payload data is kept in the radio packet format, so that the radio
+ * transmits it from, or receives it into, the slot directly.
+ */
+struct payload_slot {
+	/* Radio packet: S0 or length field, S1 field, and payload data. */
+	__ALIGN(4) u8_t rf[RF_HDR_LEN + CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH];
+
+	u8_t length;	/* Length of the payload data. */
+	u8_t pipe;	/* Pipe used for this payload. */
+	s8_t rssi;	/* RSSI for the received packet. */
+	u8_t noack;	/* Flag indicating that the packet is not acknowledged. */
+	u8_t pid;	/* PID assigned during communication. */
+};
+
 /* First-in, first-out queue of payloads to be transmitted. */
 struct payload_tx_fifo {
 	 /* Payload queue */
-	struct nrf_esb_payload *payload[CONFIG_NRF_ESB_TX_FIFO_SIZE];
+	struct payload_slot slot[CONFIG_NRF_ESB_TX_FIFO_SIZE];
 
 	u32_t back;	/* Back of the queue (last in). */
 	u32_t front;	/* Front of queue (first out). */
 	u32_t count;	/* Number of elements in the queue. */
+	u32_t reserved;	/* Number of slots after the back being filled. */
 };
 
 /* First-in, first-out queue of received payloads. */
 struct payload_rx_fifo {
-	 /* Payload queue */
-	struct nrf_esb_payload *payload[CONFIG_NRF_ESB_RX_FIFO_SIZE];
+	 /* Payload queue. The slot at the back is the reception buffer. */
+	struct payload_slot slot[RX_FIFO_SLOTS];
 
 	u32_t back;	/* Back of the queue (last in). */
 	u32_t front;	/* Front of queue (first out). */
 	u32_t count;	/* Number of elements in the queue. */
+	u32_t lent;	/* Number of elements lent to the application. */
 };
 
 /* Enhanced ShockBurst address.
@@ -177,13 +227,13 @@ static struct esb_address esb_addr = {
 };
 
 static nrf_esb_event_handler event_handler;
-static struct nrf_esb_payload *current_payload;
+static struct payload_slot *current_payload;
 
 /* FIFOs and buffers */
 static struct payload_tx_fifo tx_fifo;
 static struct payload_rx_fifo rx_fifo;
-static u8_t tx_payload_buffer[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 2];
-static u8_t rx_payload_buffer[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 2];
+/* Radio packet for acknowledgments without payload. */
+__ALIGN(4) static u8_t ack_buffer[RF_HDR_LEN];
 
 /* Run time variables */
 static u8_t pids[CONFIG_NRF_ESB_PIPE_COUNT];
@@ -453,26 +503,28 @@ static void reset_fifos(void)
 	tx_fifo.back = 0;
 	tx_fifo.front = 0;
 	tx_fifo.count = 0;
+	tx_fifo.reserved = 0;
 
 	rx_fifo.back = 0;
 	rx_fifo.front = 0;
 	rx_fifo.count = 0;
+	rx_fifo.lent = 0;
 }
 
-static void initialize_fifos(void)
+static u32_t tx_fifo_index(u32_t offset)
 {
-	static struct nrf_esb_payload rx_payload[CONFIG_NRF_ESB_RX_FIFO_SIZE];
-	static struct nrf_esb_payload tx_payload[CONFIG_NRF_ESB_TX_FIFO_SIZE];
-
-	reset_fifos();
+	return (tx_fifo.back + offset) % CONFIG_NRF_ESB_TX_FIFO_SIZE;
+}
 
-	for (size_t i = 0; i < CONFIG_NRF_ESB_TX_FIFO_SIZE; i++) {
-		tx_fifo.payload[i] = &tx_payload[i];
-	}
+static u32_t rx_fifo_index(u32_t offset)
+{
+	return (rx_fifo.front + offset) % RX_FIFO_SLOTS;
+}
 
-	for (size_t i = 0; i < CONFIG_NRF_ESB_RX_FIFO_SIZE; i++) {
-		rx_fifo.payload[i] = &rx_payload[i];
-	}
+/* Radio packet buffer that the next packet is received into. */
+static u8_t *rx_fifo_rfbuf(void)
+{
+	return rx_fifo.slot[rx_fifo.back].rf;
 }
 
 static void tx_fifo_remove_last(void)
@@ -491,11 +543,12 @@ static void tx_fifo_remove_last(void)
 	irq_unlock(key);
 }
 
-/*  Function to push the content of the rx_buffer to the RX FIFO.
+/*  Function to push the packet in the reception buffer to the RX FIFO.
  *
- *  The module will point the register NRF_RADIO->PACKETPTR to a buffer for
- *  receiving packets. After receiving a packet the module will call this
- *  function to copy the received data to the RX FIFO.
+ *  The module will point the register NRF_RADIO->PACKETPTR to the slot at the
+ *  back of the RX FIFO for receiving packets. After receiving a packet the
+ *  module will call this function to add the slot to the RX FIFO. The caller
+ *  must point the radio to the next slot before the next reception.
  *
  *  @param  pipe Pipe number to set for the packet.
  *  @param  pid  Packet ID.
@@ -505,31 +558,30 @@ static void tx_fifo_remove_last(void)
  */
 static bool rx_fifo_push_rfbuf(u8_t pipe, u8_t pid)
 {
+	struct payload_slot *slot = &rx_fifo.slot[rx_fifo.back];
+
 	if (rx_fifo.count >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
 		return false;
 	}
 
 	if (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB_DPL) {
-		if (rx_payload_buffer[0] > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH) {
+		if (slot->rf[0] > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH) {
 			return false;
 		}
-		rx_fifo.payload[rx_fifo.back]->length = rx_payload_buffer[0];
+		slot->length = slot->rf[0];
 	} else if (esb_cfg.mode == NRF_ESB_MODE_PTX) {
 		/* Received packet is an acknowledgment */
-		rx_fifo.payload[rx_fifo.back]->length = 0;
+		slot->length = 0;
 	} else {
-		rx_fifo.payload[rx_fifo.back]->length = esb_cfg.payload_length;
+		slot->length = esb_cfg.payload_length;
 	}
 
-	memcpy(rx_fifo.payload[rx_fifo.back]->data, &rx_payload_buffer[2],
-	       rx_fifo.payload[rx_fifo.back]->length);
-
-	rx_fifo.payload[rx_fifo.back]->pipe = pipe;
-	rx_fifo.payload[rx_fifo.back]->rssi = NRF_RADIO->RSSISAMPLE;
-	rx_fifo.payload[rx_fifo.back]->pid = pid;
-	rx_fifo.payload[rx_fifo.back]->noack = !(rx_payload_buffer[1] & 0x01);
+	slot->pipe = pipe;
+	slot->rssi = NRF_RADIO->RSSISAMPLE;
+	slot->pid = pid;
+	slot->noack = !(slot->rf[1] & 0x01);
 
-	if (++rx_fifo.back >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
+	if (++rx_fifo.back >= RX_FIFO_SLOTS) {
 		rx_fifo.back = 0;
 	}
 	rx_fifo.count++;
@@ -537,6 +589,427 @@ static bool rx_fifo_push_rfbuf(u8_t pipe, u8_t pid)
 	return true;
 }
 
+/* Release the given number of elements from the front of the RX FIFO. */
+static void rx_fifo_release(u32_t count)
+{
+	u32_t key = irq_lock();
+
+	rx_fifo.front = rx_fifo_index(count);
+	rx_fifo.count -= count;
+
+	irq_unlock(key);
+}
+
+/* Fill in a TX FIFO slot and encode its radio packet header. */
+static void tx_slot_prepare(struct payload_slot *slot, u8_t length,
+			    u8_t pipe, u8_t noack)
+{
+	slot->length = length;
+	slot->pipe = pipe;
+	slot->noack = noack;
+
+	pids[pipe] = (pids[pipe] + 1) % (PID_MAX + 1);
+	slot->pid = pids[pipe];
+
+	if (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB) {
+		slot->rf[0] = slot->pid;
+		slot->rf[1] = 0;
+	} else {
+		slot->rf[0] = slot->length;
+		slot->rf[1] = slot->pid << 1;
+		slot->rf[1] |= slot->noack ? 0x00 : 0x01;
+	}
+}
+
+static int tx_payload_check(u8_t length, u8_t pipe)
+{
+	if (length == 0 ||
+	    length > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH ||
+	    (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB &&
+	     length > esb_cfg.payload_length)) {
+		return -EMSGSIZE;
+	}
+	if (pipe >= CONFIG_NRF_ESB_PIPE_COUNT) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+#if CONFIG_NRF_ESB_STATS
+static struct nrf_esb_pipe_stats pipe_stats[CONFIG_NRF_ESB_PIPE_COUNT];
+/* Moving averages of the RSSI, in 1/16 units. Zero before the first sample. */
+static s16_t rssi_avg_q4[CONFIG_NRF_ESB_PIPE_COUNT];
+
+#define STATS_INC(_pipe, _field) (pipe_stats[_pipe]._field++)
+
+static void stats_rssi_update(u8_t pipe)
+{
+	s16_t sample = (s16_t)(NRF_RADIO->RSSISAMPLE << 4);
+
+	if (rssi_avg_q4[pipe] == 0) {
+		rssi_avg_q4[pipe] = sample;
+	} else {
+		rssi_avg_q4[pipe] += (sample - rssi_avg_q4[pipe]) >>
+				     RSSI_AVG_SHIFT;
+	}
+}
+
+static void stats_tx_attempts(u8_t pipe, u32_t attempts)
+{
+	u32_t bin = MIN(attempts, CONFIG_NRF_ESB_STATS_ATTEMPTS_BINS) - 1;
+
+	pipe_stats[pipe].tx_attempts[bin]++;
+}
+#else
+#define STATS_INC(_pipe, _field)
+
+static void stats_rssi_update(u8_t pipe)
+{
+}
+
+static void stats_tx_attempts(u8_t pipe, u32_t attempts)
+{
+}
+#endif /* CONFIG_NRF_ESB_STATS */
+
+#if CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT
+/* Adaptive retransmission state. */
+static struct {
+	u16_t delay;		/* Retransmit delay in use. */
+	u16_t count;		/* Retransmit count in use. */
+	u16_t packets;		/* Packets in the current window. */
+	u16_t successes;	/* Acknowledged packets in the current window. */
+	u32_t attempts;		/* TX attempts in the current window. */
+	u8_t ack_length;	/* Longest acknowledgment payload in the
+				 * current window.
+				 */
+} adaptive;
+
+static void adaptive_reset(void)
+{
+	memset(&adaptive, 0, sizeof(adaptive));
+	adaptive.delay = esb_cfg.retransmit_delay;
+	adaptive.count = esb_cfg.retransmit_count;
+}
+
+/* Shortest retransmit delay after which the PRX is back in RX, after it has
+ * sent an acknowledgment with the given payload length.
+ */
+static u16_t adaptive_delay(u8_t ack_length)
+{
+	u32_t byte_time_us;
+	u32_t delay;
+
+	switch (esb_cfg.bitrate) {
+	case NRF_ESB_BITRATE_1MBPS:
+	case NRF_ESB_BITRATE_1MBPS_BLE:
+		byte_time_us = 8;
+		break;
+#ifdef CONFIG_SOC_SERIES_NRF51X
+	case NRF_ESB_BITRATE_250KBPS:
+		byte_time_us = 32;
+		break;
+#endif /* CONFIG_SOC_SERIES_NRF51X */
+	default:
+		byte_time_us = 4;
+		break;
+	}
+
+	delay = (ACK_OVERHEAD_BYTES + esb_addr.addr_length + ack_length) *
+		byte_time_us + RADIO_RAMP_UP_US + ACK_TURNAROUND_MARGIN_US;
+
+	return MAX(delay, RETRANSMIT_DELAY_MIN);
+}
+
+/* Smallest retransmit count for which the ratio of packets that fail is
+ * expected to stay below the target, given the ratio of lost attempts.
+ */
+static u16_t adaptive_count(u32_t lost, u32_t attempts)
+{
+	const u32_t target = (CONFIG_NRF_ESB_ADAPTIVE_FAIL_RATE << 16) / 1000;
+	u32_t loss = (u32_t)(((u64_t)lost << 16) / attempts);
+	u32_t fail = loss;
+	u16_t count = 0;
+
+	/* A packet fails if all count + 1 attempts are lost. */
+	while (fail > target && count < esb_cfg.retransmit_count) {
+		fail = (u32_t)(((u64_t)fail * loss) >> 16);
+		count++;
+	}
+
+	return MAX(count, MIN(CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT_COUNT_MIN,
+			      esb_cfg.retransmit_count));
+}
+
+static void adaptive_update(u32_t attempts, bool success, u8_t ack_length)
+{
+	adaptive.packets++;
+	adaptive.attempts += attempts;
+	adaptive.successes += success;
+	adaptive.ack_length = MAX(adaptive.ack_length, ack_length);
+
+	if (adaptive.packets < CONFIG_NRF_ESB_ADAPTIVE_WINDOW) {
+		return;
+	}
+
+	adaptive.delay = adaptive_delay(adaptive.ack_length);
+	adaptive.count = adaptive_count(adaptive.attempts - adaptive.successes,
+					adaptive.attempts);
+
+	adaptive.packets = 0;
+	adaptive.successes = 0;
+	adaptive.attempts = 0;
+	adaptive.ack_length = 0;
+}
+
+static u16_t retransmit_delay_get(void)
+{
+	return adaptive.delay;
+}
+
+static u16_t retransmit_count_get(void)
+{
+	return adaptive.count;
+}
+#else
+static void adaptive_reset(void)
+{
+}
+
+static void adaptive_update(u32_t attempts, bool success, u8_t ack_length)
+{
+}
+
+static u16_t retransmit_delay_get(void)
+{
+	return esb_cfg.retransmit_delay;
+}
+
+static u16_t retransmit_count_get(void)
+{
+	return esb_cfg.retransmit_count;
+}
+#endif /* CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT */
+
+#if CONFIG_NRF_ESB_HOPPING
+/* Channel hopping state. */
+static struct {
+	u8_t channels[CONFIG_NRF_ESB_HOP_CHANNELS_MAX]; /* Hop sequence. */
+	u8_t quality[CONFIG_NRF_ESB_HOP_CHANNELS_MAX];	/* Channel quality. */
+	bool blacklisted[CONFIG_NRF_ESB_HOP_CHANNELS_MAX];
+	/* Time at which a blacklisted channel is used again. */
+	u64_t blacklist_end_us[CONFIG_NRF_ESB_HOP_CHANNELS_MAX];
+	u8_t count;	/* Channels in the sequence. Zero when hopping is off. */
+	u8_t index;	/* Position of the current channel. */
+	struct esb_hop_ptx ptx; /* PTX: Position of the PRX. */
+} hop;
+
+static void hop_reset(void)
+{
+	hop.index = 0;
+	esb_hop_ptx_reset(&hop.ptx, ESB_TIME_US());
+	memset(hop.quality, HOP_QUALITY_MAX, sizeof(hop.quality));
+	memset(hop.blacklisted, 0, sizeof(hop.blacklisted));
+}
+
+static bool hop_enabled(void)
+{
+	return hop.count > 0;
+}
+
+static u32_t rf_channel_get(void)
+{
+	return hop_enabled() ? hop.channels[hop.index] : esb_addr.rf_channel;
+}
+
+/* Update the quality of the current channel with the outcome of an exchange.
+ * A PTX blacklists the channel if the quality drops below the threshold.
+ */
+static void hop_quality_update(bool success)
+{
+	u8_t *quality = &hop.quality[hop.index];
+	u32_t in_use = 0;
+
+	if (success) {
+		*quality += (HOP_QUALITY_MAX - *quality) >> HOP_QUALITY_SHIFT;
+		return;
+	}
+
+	*quality -= *quality >> HOP_QUALITY_SHIFT;
+
+	if (esb_cfg.mode != NRF_ESB_MODE_PTX ||
+	    *quality >= HOP_QUALITY_THRESHOLD) {
+		return;
+	}
+
+	for (u32_t i = 0; i < hop.count; i++) {
+		in_use += !hop.blacklisted[i];
+	}
+
+	if (in_use > CONFIG_NRF_ESB_HOP_CHANNELS_MIN) {
+		hop.blacklisted[hop.index] = true;
+		hop.blacklist_end_us[hop.index] =
+			ESB_TIME_US() + CONFIG_NRF_ESB_HOP_BLACKLIST_ROUNDS *
+					hop.count * CONFIG_NRF_ESB_HOP_SLOT_US;
+	}
+}
+
+static bool hop_blacklisted(u8_t index, u64_t time_us)
+{
+	if (hop.blacklisted[index] && time_us >= hop.blacklist_end_us[index]) {
+		/* Give the channel another chance. */
+		hop.blacklisted[index] = false;
+		hop.quality[index] = HOP_QUALITY_MAX;
+	}
+
+	return hop.blacklisted[index];
+}
+
+/* Choose the channel of a TX attempt of a PTX, whose packet starts in start_us
+ * at the earliest. The attempt is deferred to the next slot if the channel is
+ * blacklisted, or if the slot ends before the PRX has received the packet.
+ *
+ * Returns the time by which the attempt is deferred.
+ */
+static u32_t hop_ptx_schedule(u32_t start_us)
+{
+	u64_t time_us = ESB_TIME_US() + start_us;
+	u32_t left_us;
+	u32_t wait_us = 0;
+
+	if (!hop_enabled()) {
+		return 0;
+	}
+
+	left_us = esb_hop_ptx_locate(&hop.ptx, hop.count, time_us, &hop.index);
+	if (esb_hop_ptx_searching(&hop.ptx)) {
+		return 0;
+	}
+
+	for (;;) {
+		if (left_us >= ESB_HOP_SLOT_GUARD_US &&
+		    !hop_blacklisted(hop.index, time_us + wait_us)) {
+			return wait_us;
+		}
+		if (wait_us + left_us > UINT16_MAX) {
+			/* Beyond the range of the system timer. */
+			return wait_us;
+		}
+
+		wait_us += left_us;
+		left_us = esb_hop_ptx_locate(&hop.ptx, hop.count,
+					     time_us + wait_us, &hop.index);
+	}
+}
+
+/* Account for a TX attempt of a PTX. Only attempts on the channel on which
+ * the PRX is expected count for the channel quality.
+ */
+static void hop_ptx_attempt(bool acked)
+{
+	if (!hop_enabled()) {
+		return;
+	}
+
+	if (!esb_hop_ptx_searching(&hop.ptx) &&
+	    !esb_hop_ptx_ack_lost(&hop.ptx)) {
+		hop_quality_update(acked);
+	}
+
+	esb_hop_ptx_attempt(&hop.ptx, hop.count, hop.index, acked,
+			    ESB_TIME_US());
+}
+
+static void hop_ptx_noack(void)
+{
+	if (hop_enabled()) {
+		esb_hop_ptx_sync(&hop.ptx, hop.count, hop.index,
+				 ESB_TIME_US());
+	}
+}
+
+static void hop_prx_received(bool crc_ok)
+{
+	if (hop_enabled()) {
+		hop_quality_update(crc_ok);
+	}
+}
+
+/* Move a PRX on to the next channel, after an exchange or at the end of a
+ * slot. After an exchange, the slot is restarted, so that it is aligned with
+ * the one of the PTX.
+ */
+static void hop_prx_next(bool exchange)
+{
+	if (!hop_enabled()) {
+		return;
+	}
+
+	hop.index = (hop.index + 1) % hop.count;
+
+	if (exchange) {
+		ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_CLEAR);
+	}
+}
+
+/* Use the system timer, which a PRX does not use otherwise, to time the
+ * slots.
+ */
+static void hop_prx_timer_start(void)
+{
+	if (!hop_enabled()) {
+		return;
+	}
+
+	ESB_SYS_TIMER->SHORTS = TIMER_SHORTS_COMPARE2_CLEAR_Msk;
+	ESB_SYS_TIMER->CC[2] = CONFIG_NRF_ESB_HOP_SLOT_US;
+	ESB_SYS_TIMER->EVENTS_COMPARE[2] = 0;
+	ESB_SYS_TIMER->INTENSET = TIMER_INTENSET_COMPARE2_Msk;
+	ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_CLEAR);
+	ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_START);
+}
+#else
+static void hop_reset(void)
+{
+}
+
+static bool hop_enabled(void)
+{
+	return false;
+}
+
+static u32_t rf_channel_get(void)
+{
+	return esb_addr.rf_channel;
+}
+
+static u32_t hop_ptx_schedule(u32_t start_us)
+{
+	return 0;
+}
+
+static void hop_ptx_attempt(bool acked)
+{
+}
+
+static void hop_ptx_noack(void)
+{
+}
+
+static void hop_prx_received(bool crc_ok)
+{
+}
+
+static void hop_prx_next(bool exchange)
+{
+}
+
+static void hop_prx_timer_start(void)
+{
+}
+#endif /* CONFIG_NRF_ESB_HOPPING */
+
 static void sys_timer_init(void)
 {
 	/* Configure the system timer with a 1 MHz base frequency */
@@ -572,18 +1045,15 @@ static void ppi_init(void)
 static void start_tx_transaction(void)
 {
 	bool ack;
+	u32_t wait_us;
 
 	last_tx_attempts = 1;
 	/* Prepare the payload */
-	current_payload = tx_fifo.payload[tx_fifo.front];
+	current_payload = &tx_fifo.slot[tx_fifo.front];
 
 	switch (esb_cfg.protocol) {
 	case NRF_ESB_PROTOCOL_ESB:
 		update_rf_payload_format(current_payload->length);
-		tx_payload_buffer[0] = current_payload->pid;
-		tx_payload_buffer[1] = 0;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
 
 		NRF_RADIO->SHORTS = radio_shorts_common |
 				    RADIO_SHORTS_DISABLED_RXEN_Msk;
@@ -591,18 +1061,13 @@ static void start_tx_transaction(void)
 				      RADIO_INTENSET_READY_Msk;
 
 		/* Configure the retransmit counter */
-		retransmits_remaining = esb_cfg.retransmit_count;
+		retransmits_remaining = retransmit_count_get();
 		on_radio_disabled = on_radio_disabled_tx;
 		esb_state = ESB_STATE_PTX_TX_ACK;
 		break;
 
 	case NRF_ESB_PROTOCOL_ESB_DPL:
 		ack = !current_payload->noack || !esb_cfg.selective_auto_ack;
-		tx_payload_buffer[0] = current_payload->length;
-		tx_payload_buffer[1] = current_payload->pid << 1;
-		tx_payload_buffer[1] |= current_payload->noack ? 0x00 : 0x01;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
 
 		/* Handling ack if noack is set to false or if
 		 * selective auto ack is turned off
@@ -614,7 +1079,7 @@ static void start_tx_transaction(void)
 					      RADIO_INTENSET_READY_Msk;
 
 			/* Configure the retransmit counter */
-			retransmits_remaining = esb_cfg.retransmit_count;
+			retransmits_remaining = retransmit_count_get();
 			on_radio_disabled = on_radio_disabled_tx;
 			esb_state = ESB_STATE_PTX_TX_ACK;
 		} else {
@@ -630,11 +1095,13 @@ static void start_tx_transaction(void)
 		break;
 	}
 
+	wait_us = hop_ptx_schedule(RADIO_RAMP_UP_US);
+
 	NRF_RADIO->TXADDRESS = current_payload->pipe;
 	NRF_RADIO->RXADDRESSES = 1 << current_payload->pipe;
-	NRF_RADIO->FREQUENCY = esb_addr.rf_channel;
+	NRF_RADIO->FREQUENCY = rf_channel_get();
 
-	NRF_RADIO->PACKETPTR = (u32_t)tx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (u32_t)current_payload->rf;
 
 	NVIC_ClearPendingIRQ(RADIO_IRQn);
 	irq_enable(RADIO_IRQn);
@@ -643,13 +1110,25 @@ static void start_tx_transaction(void)
 	NRF_RADIO->EVENTS_PAYLOAD = 0;
 	NRF_RADIO->EVENTS_DISABLED = 0;
 
-	NRF_RADIO->TASKS_TXEN = 1;
+	if (wait_us > 0) {
+		/* Let the system timer start the radio in a later hop slot. */
+		ESB_SYS_TIMER->CC[1] = wait_us;
+		ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_CLEAR);
+		ESB_SYS_TIMER->EVENTS_COMPARE[1] = 0;
+		ESB_PPI_ENABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
+		ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_START);
+	} else {
+		ESB_TASK_TRIGGER(NRF_RADIO->TASKS_TXEN);
+	}
 }
 
 static void on_radio_disabled_tx_noack(void)
 {
+	ESB_PPI_DISABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
 	interrupt_flags |= INT_TX_SUCCESS_MSK;
+	STATS_INC(current_payload->pipe, tx_success);
 	tx_fifo_remove_last();
+	hop_ptx_noack();
 
 	if (tx_fifo.count == 0) {
 		esb_state = ESB_STATE_IDLE;
@@ -672,24 +1151,24 @@ static void on_radio_disabled_tx(void)
 	 * received by the time defined in wait_for_ack_timeout_us
 	 */
 	ESB_SYS_TIMER->CC[0] = wait_for_ack_timeout_us;
-	ESB_SYS_TIMER->CC[1] = esb_cfg.retransmit_delay - 130;
-	ESB_SYS_TIMER->TASKS_CLEAR = 1;
+	ESB_SYS_TIMER->CC[1] = retransmit_delay_get() - RADIO_RAMP_UP_US;
+	ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_CLEAR);
 	ESB_SYS_TIMER->EVENTS_COMPARE[0] = 0;
 	ESB_SYS_TIMER->EVENTS_COMPARE[1] = 0;
 	/* Remove */
-	ESB_SYS_TIMER->TASKS_START = 1;
+	ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_START);
 
-	NRF_PPI->CHENSET = (1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
-			   (1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
-			   (1 << CONFIG_NRF_ESB_PPI_TIMER_STOP);
-	NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TX_START);
+	ESB_PPI_ENABLE((1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
+		       (1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
+		       (1 << CONFIG_NRF_ESB_PPI_TIMER_STOP));
+	ESB_PPI_DISABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
 	NRF_RADIO->EVENTS_END = 0;
 
 	if (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB) {
 		update_rf_payload_format(0);
 	}
 
-	NRF_RADIO->PACKETPTR = (u32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (u32_t)rx_fifo_rfbuf();
 	on_radio_disabled = on_radio_disabled_tx_wait_for_ack;
 	esb_state = ESB_STATE_PTX_RX_ACK;
 }
@@ -701,29 +1180,42 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 	/* Make sure the timer will not deactivate the radio if a packet is
 	 * received.
 	 */
-	NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
-			   (1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
-			   (1 << CONFIG_NRF_ESB_PPI_TIMER_STOP);
+	ESB_PPI_DISABLE((1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
+			(1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
+			(1 << CONFIG_NRF_ESB_PPI_TIMER_STOP));
+
+	u8_t pipe = current_payload->pipe;
 
 	/* If the radio has received a packet and the CRC status is OK */
 	if (NRF_RADIO->EVENTS_END && NRF_RADIO->CRCSTATUS != 0) {
-		ESB_SYS_TIMER->TASKS_SHUTDOWN = 1;
-		NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TX_START);
+		ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_SHUTDOWN);
+		ESB_PPI_DISABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
 		interrupt_flags |= INT_TX_SUCCESS_MSK;
-		last_tx_attempts = esb_cfg.retransmit_count -
+		last_tx_attempts = retransmit_count_get() -
 				   retransmits_remaining + 1;
 
 		tx_fifo_remove_last();
 
+		u8_t *rx_buf = rx_fifo_rfbuf();
+		u8_t ack_length = 0;
+
 		if (esb_cfg.protocol != NRF_ESB_PROTOCOL_ESB &&
-		    rx_payload_buffer[0] > 0) {
+		    rx_buf[0] > 0) {
+			ack_length = rx_buf[0];
+			STATS_INC(pipe, rx_packets);
 			if (rx_fifo_push_rfbuf((u8_t)NRF_RADIO->TXADDRESS,
-					       rx_payload_buffer[1] >> 1)) {
+					       rx_buf[1] >> 1)) {
 				interrupt_flags |=
 					INT_RX_DATA_RECEIVED_MSK;
 			}
 		}
 
+		STATS_INC(pipe, tx_success);
+		stats_tx_attempts(pipe, last_tx_attempts);
+		stats_rssi_update(pipe);
+		adaptive_update(last_tx_attempts, true, ack_length);
+		hop_ptx_attempt(true);
+
 		if ((tx_fifo.count == 0) ||
 		    (esb_cfg.tx_mode == NRF_ESB_TXMODE_MANUAL)) {
 			esb_state = ESB_STATE_IDLE;
@@ -733,14 +1225,22 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 			start_tx_transaction();
 		}
 	} else {
+		if (NRF_RADIO->EVENTS_END) {
+			STATS_INC(pipe, rx_crc_errors);
+		}
+
+		hop_ptx_attempt(false);
+
 		if (retransmits_remaining-- == 0) {
-			ESB_SYS_TIMER->TASKS_SHUTDOWN = 1;
-			NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TX_START);
+			ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_SHUTDOWN);
+			ESB_PPI_DISABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
 			/* All retransmits are expended, and the TX operation is
 			 * suspended
 			 */
-			last_tx_attempts = esb_cfg.retransmit_count + 1;
+			last_tx_attempts = retransmit_count_get() + 1;
 			interrupt_flags |= INT_TX_FAILED_MSK;
+			STATS_INC(pipe, tx_failed);
+			adaptive_update(last_tx_attempts, false, 0);
 
 			esb_state = ESB_STATE_IDLE;
 			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
@@ -752,13 +1252,20 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 			NRF_RADIO->SHORTS = radio_shorts_common |
 					    RADIO_SHORTS_DISABLED_RXEN_Msk;
 			update_rf_payload_format(current_payload->length);
-			NRF_RADIO->PACKETPTR = (u32_t)tx_payload_buffer;
+			NRF_RADIO->PACKETPTR = (u32_t)current_payload->rf;
+			/* The timer was started at the end of the previous
+			 * attempt, and the RX window ended at CC[0].
+			 */
+			ESB_SYS_TIMER->CC[1] += hop_ptx_schedule(
+				ESB_SYS_TIMER->CC[1] - ESB_SYS_TIMER->CC[0] +
+				RADIO_RAMP_UP_US);
+			NRF_RADIO->FREQUENCY = rf_channel_get();
 			on_radio_disabled = on_radio_disabled_tx;
 			esb_state = ESB_STATE_PTX_TX_ACK;
-			ESB_SYS_TIMER->TASKS_START = 1;
-			NRF_PPI->CHENSET = (1 << CONFIG_NRF_ESB_PPI_TX_START);
+			ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_START);
+			ESB_PPI_ENABLE(1 << CONFIG_NRF_ESB_PPI_TX_START);
 			if (ESB_SYS_TIMER->EVENTS_COMPARE[1]) {
-				NRF_RADIO->TASKS_TXEN = 1;
+				ESB_TASK_TRIGGER(NRF_RADIO->TASKS_TXEN);
 			}
 		}
 	}
@@ -768,9 +1275,9 @@ static void clear_events_restart_rx(void)
 {
 	NRF_RADIO->SHORTS = radio_shorts_common;
 	update_rf_payload_format(esb_cfg.payload_length);
-	NRF_RADIO->PACKETPTR = (u32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (u32_t)rx_fifo_rfbuf();
 	NRF_RADIO->EVENTS_DISABLED = 0;
-	NRF_RADIO->TASKS_DISABLE = 1;
+	ESB_TASK_TRIGGER(NRF_RADIO->TASKS_DISABLE);
 
 	while (NRF_RADIO->EVENTS_DISABLED == 0) {
 		/* wait for register to settle */
@@ -779,15 +1286,22 @@ static void clear_events_restart_rx(void)
 	NRF_RADIO->EVENTS_DISABLED = 0;
 	NRF_RADIO->SHORTS = radio_shorts_common |
 			    RADIO_SHORTS_DISABLED_TXEN_Msk;
+	NRF_RADIO->FREQUENCY = rf_channel_get();
 
-	NRF_RADIO->TASKS_RXEN = 1;
+	ESB_TASK_TRIGGER(NRF_RADIO->TASKS_RXEN);
 }
 
-static void on_radio_disabled_rx_dpl(bool retransmit_payload,
-				     struct pipe_info *pipe_info)
+/* Prepare the acknowledgment for a received packet and return the radio
+ * packet to send it from.
+ */
+static u8_t *on_radio_disabled_rx_dpl(bool retransmit_payload,
+				      struct pipe_info *pipe_info,
+				      u8_t rx_s1)
 {
+	u8_t *ack_rf;
+
 	if (tx_fifo.count > 0 &&
-	    (tx_fifo.payload[tx_fifo.front]->pipe == NRF_RADIO->RXMATCH)) {
+	    (tx_fifo.slot[tx_fifo.front].pipe == NRF_RADIO->RXMATCH)) {
 		/* Pipe stays in ACK with payload until TX FIFO is empty */
 		/* Do not report TX success on first ack payload or retransmit
 		 */
@@ -803,32 +1317,39 @@ static void on_radio_disabled_rx_dpl(bool retransmit_payload,
 			 * 'nRF24LE1_Product_Specification_rev1_6.pdf').
 			 */
 			interrupt_flags |= INT_TX_SUCCESS_MSK;
+			STATS_INC(NRF_RADIO->RXMATCH, tx_success);
 		}
 
 		pipe_info->ack_payload = true;
 
-		current_payload = tx_fifo.payload[tx_fifo.front];
+		current_payload = &tx_fifo.slot[tx_fifo.front];
 
 		update_rf_payload_format(current_payload->length);
-		tx_payload_buffer[0] = current_payload->length;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
+		ack_rf = current_payload->rf;
 	} else {
 		pipe_info->ack_payload = false;
 		update_rf_payload_format(0);
-		tx_payload_buffer[0] = 0;
+		ack_rf = ack_buffer;
+		ack_rf[0] = 0;
 	}
 
-	tx_payload_buffer[1] = rx_payload_buffer[1];
+	ack_rf[1] = rx_s1;
+
+	return ack_rf;
 }
 
 static void on_radio_disabled_rx(void)
 {
 	bool retransmit_payload = false;
 	bool send_rx_event = true;
+	bool send_ack;
 	struct pipe_info *pipe_info;
+	u8_t *rx_buf = rx_fifo_rfbuf();
+	u8_t *ack_rf = ack_buffer;
 
 	if (NRF_RADIO->CRCSTATUS == 0) {
+		STATS_INC(NRF_RADIO->RXMATCH, rx_crc_errors);
+		hop_prx_received(false);
 		clear_events_restart_rx();
 		return;
 	}
@@ -840,39 +1361,51 @@ static void on_radio_disabled_rx(void)
 
 	pipe_info = &rx_pipe_info[NRF_RADIO->RXMATCH];
 	if (NRF_RADIO->RXCRC == pipe_info->crc &&
-	    (rx_payload_buffer[1] >> 1) == pipe_info->pid) {
+	    (rx_buf[1] >> 1) == pipe_info->pid) {
 		retransmit_payload = true;
 		send_rx_event = false;
+		STATS_INC(NRF_RADIO->RXMATCH, rx_duplicates);
+	} else {
+		STATS_INC(NRF_RADIO->RXMATCH, rx_packets);
 	}
 
-	pipe_info->pid = rx_payload_buffer[1] >> 1;
+	stats_rssi_update(NRF_RADIO->RXMATCH);
+	hop_prx_received(true);
+
+	pipe_info->pid = rx_buf[1] >> 1;
 	pipe_info->crc = NRF_RADIO->RXCRC;
 
 	/* Check if an ack should be sent */
-	if ((esb_cfg.selective_auto_ack == false) ||
-	    ((rx_payload_buffer[1] & 0x01) == 1)) {
-		NRF_RADIO->SHORTS = radio_shorts_common |
+	send_ack = (esb_cfg.selective_auto_ack == false) ||
+		   ((rx_buf[1] & 0x01) == 1);
+
+	if (send_ack) {
+		/* When hopping, the radio is enabled again only after the
+		 * channel has been changed.
+		 */
+		NRF_RADIO->SHORTS = hop_enabled() ?
+				    radio_shorts_common :
+				    radio_shorts_common |
 				    RADIO_SHORTS_DISABLED_RXEN_Msk;
 
 		switch (esb_cfg.protocol) {
 		case NRF_ESB_PROTOCOL_ESB_DPL:
-			on_radio_disabled_rx_dpl(retransmit_payload, pipe_info);
+			ack_rf = on_radio_disabled_rx_dpl(retransmit_payload,
+							  pipe_info, rx_buf[1]);
 			break;
 
 		case NRF_ESB_PROTOCOL_ESB:
 			update_rf_payload_format(0);
-			tx_payload_buffer[0] = rx_payload_buffer[0];
-			tx_payload_buffer[1] = 0;
+			ack_buffer[0] = rx_buf[0];
+			ack_buffer[1] = 0;
 			break;
 		}
 
 		esb_state = ESB_STATE_PRX_SEND_ACK;
 		NRF_RADIO->TXADDRESS = NRF_RADIO->RXMATCH;
 
-		NRF_RADIO->PACKETPTR = (u32_t)tx_payload_buffer;
+		NRF_RADIO->PACKETPTR = (u32_t)ack_rf;
 		on_radio_disabled = on_radio_disabled_rx_ack;
-	} else {
-		clear_events_restart_rx();
 	}
 
 	if (send_rx_event) {
@@ -885,6 +1418,14 @@ static void on_radio_disabled_rx(void)
 			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
 		}
 	}
+
+	/* Restart reception only after the packet has been pushed, so that the
+	 * radio receives into the next slot.
+	 */
+	if (!send_ack) {
+		hop_prx_next(true);
+		clear_events_restart_rx();
+	}
 }
 
 static void on_radio_disabled_rx_ack(void)
@@ -893,10 +1434,16 @@ static void on_radio_disabled_rx_ack(void)
 			    RADIO_SHORTS_DISABLED_TXEN_Msk;
 	update_rf_payload_format(esb_cfg.payload_length);
 
-	NRF_RADIO->PACKETPTR = (u32_t)rx_payload_buffer;
+	NRF_RADIO->PACKETPTR = (u32_t)rx_fifo_rfbuf();
 	on_radio_disabled = on_radio_disabled_rx;
 
 	esb_state = ESB_STATE_PRX;
+
+	if (hop_enabled()) {
+		hop_prx_next(true);
+		NRF_RADIO->FREQUENCY = rf_channel_get();
+		ESB_TASK_TRIGGER(NRF_RADIO->TASKS_RXEN);
+	}
 }
 
 /* Retrieve interrupt flags and reset them.
@@ -972,6 +1519,21 @@ static void ESB_EVT_IRQHandler(void)
 
 static void NRF_ESB_SYS_TIMER_IRQHandler(void)
 {
+#if CONFIG_NRF_ESB_HOPPING
+	if (ESB_SYS_TIMER->EVENTS_COMPARE[2]) {
+		ESB_SYS_TIMER->EVENTS_COMPARE[2] = 0;
+
+		u32_t key = irq_lock();
+
+		/* The hop slot of a PRX is over. */
+		if (esb_state == ESB_STATE_PRX && hop_enabled()) {
+			hop_prx_next(false);
+			clear_events_restart_rx();
+		}
+
+		irq_unlock(key);
+	}
+#endif /* CONFIG_NRF_ESB_HOPPING */
 }
 
 #ifdef CONFIG_NRF_ESB_ADDR_HANG_BUGFIX
@@ -985,7 +1547,7 @@ static void NRF_ESB_BUGFIX_TIMER_IRQHandler(void)
 		 * state, disable the radio
 		 */
 		if (esb_state == ESB_STATE_PTX_RX_ACK) {
-			NRF_RADIO->TASKS_DISABLE = 1;
+			ESB_TASK_TRIGGER(NRF_RADIO->TASKS_DISABLE);
 		}
 	}
 }
@@ -1007,6 +1569,12 @@ int nrf_esb_init(const struct nrf_esb_config *config)
 
 	interrupt_flags = 0;
 
+	adaptive_reset();
+	hop_reset();
+#if CONFIG_NRF_ESB_STATS
+	nrf_esb_reset_stats();
+#endif
+
 	memset(rx_pipe_info, 0, sizeof(rx_pipe_info));
 	memset(pids, 0, sizeof(pids));
 
@@ -1018,16 +1586,16 @@ int nrf_esb_init(const struct nrf_esb_config *config)
 	NRF_RADIO->PREFIX0 = 0x23C343E7;
 	NRF_RADIO->PREFIX1 = 0x13E363A3;
 
-	initialize_fifos();
+	reset_fifos();
 	sys_timer_init();
 	ppi_init();
 
-	IRQ_DIRECT_CONNECT(NRF5_IRQ_RADIO_IRQn, config->radio_irq_priority,
-			   RADIO_IRQHandler, 0);
-	IRQ_DIRECT_CONNECT(NRF5_IRQ_SWI0_IRQn, config->event_irq_priority,
-			   ESB_EVT_IRQHandler, 0);
-	IRQ_DIRECT_CONNECT(ESB_SYS_TIMER_IRQn, config->event_irq_priority,
-			   NRF_ESB_SYS_TIMER_IRQHandler, 0);
+	ESB_IRQ_CONNECT(NRF5_IRQ_RADIO_IRQn, config->radio_irq_priority,
+			RADIO_IRQHandler);
+	ESB_IRQ_CONNECT(NRF5_IRQ_SWI0_IRQn, config->event_irq_priority,
+			ESB_EVT_IRQHandler);
+	ESB_IRQ_CONNECT(ESB_SYS_TIMER_IRQn, config->event_irq_priority,
+			NRF_ESB_SYS_TIMER_IRQHandler);
 
 	irq_enable(NRF5_IRQ_RADIO_IRQn);
 	irq_enable(NRF5_IRQ_SWI0_IRQn);
@@ -1054,11 +1622,11 @@ int nrf_esb_init(const struct nrf_esb_config *config)
 		ESB_BUGFIX_TIMER->MODE = TIMER_MODE_MODE_Timer
 					 << TIMER_MODE_MODE_Pos;
 		ESB_BUGFIX_TIMER->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
-		ESB_BUGFIX_TIMER->TASKS_CLEAR = 1;
+		ESB_TASK_TRIGGER(ESB_BUGFIX_TIMER->TASKS_CLEAR);
 
-		IRQ_DIRECT_CONNECT(ESB_BUGFIX_TIMER_IRQn,
-				   config->event_irq_priority,
-				   NRF_ESB_BUGFIX_TIMER_IRQHandler, 0);
+		ESB_IRQ_CONNECT(ESB_BUGFIX_TIMER_IRQn,
+				config->event_irq_priority,
+				NRF_ESB_BUGFIX_TIMER_IRQHandler);
 
 		NRF_PPI->CH[CONFIG_NRF_ESB_PPI_BUGFIX1].EEP =
 		    (u32_t)&NRF_RADIO->EVENTS_ADDRESS;
@@ -1075,9 +1643,9 @@ int nrf_esb_init(const struct nrf_esb_config *config)
 		NRF_PPI->CH[CONFIG_NRF_ESB_PPI_BUGFIX3].TEP =
 		    (u32_t)&ESB_BUGFIX_TIMER->TASKS_CLEAR;
 
-		NRF_PPI->CHENSET = (1 << CONFIG_NRF_ESB_PPI_BUGFIX1) |
-				   (1 << CONFIG_NRF_ESB_PPI_BUGFIX2) |
-				   (1 << CONFIG_NRF_ESB_PPI_BUGFIX3);
+		ESB_PPI_ENABLE((1 << CONFIG_NRF_ESB_PPI_BUGFIX1) |
+			       (1 << CONFIG_NRF_ESB_PPI_BUGFIX2) |
+			       (1 << CONFIG_NRF_ESB_PPI_BUGFIX3));
 	}
 #endif
 
@@ -1102,10 +1670,10 @@ int nrf_esb_suspend(void)
 	}
 
 	/*  Clear PPI */
-	NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
-			   (1 << CONFIG_NRF_ESB_PPI_TIMER_STOP) |
-			   (1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
-			   (1 << CONFIG_NRF_ESB_PPI_TX_START);
+	ESB_PPI_DISABLE((1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
+			(1 << CONFIG_NRF_ESB_PPI_TIMER_STOP) |
+			(1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
+			(1 << CONFIG_NRF_ESB_PPI_TX_START));
 
 	esb_state = ESB_STATE_IDLE;
 
@@ -1115,10 +1683,10 @@ int nrf_esb_suspend(void)
 void nrf_esb_disable(void)
 {
 	/*  Clear PPI */
-	NRF_PPI->CHENCLR = (1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
-			   (1 << CONFIG_NRF_ESB_PPI_TIMER_STOP) |
-			   (1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
-			   (1 << CONFIG_NRF_ESB_PPI_TX_START);
+	ESB_PPI_DISABLE((1 << CONFIG_NRF_ESB_PPI_TIMER_START) |
+			(1 << CONFIG_NRF_ESB_PPI_TIMER_STOP) |
+			(1 << CONFIG_NRF_ESB_PPI_RX_TIMEOUT) |
+			(1 << CONFIG_NRF_ESB_PPI_TX_START));
 
 	esb_state = ESB_STATE_IDLE;
 	esb_initialized = false;
@@ -1141,82 +1709,243 @@ bool nrf_esb_is_idle(void)
 	return (esb_state == ESB_STATE_IDLE);
 }
 
+/* Add the reserved slots to the back of the TX FIFO. */
+static void tx_fifo_commit(void)
+{
+	u32_t key = irq_lock();
+
+	tx_fifo.back = tx_fifo_index(tx_fifo.reserved);
+	tx_fifo.count += tx_fifo.reserved;
+	tx_fifo.reserved = 0;
+
+	irq_unlock(key);
+
+	if (esb_cfg.mode == NRF_ESB_MODE_PTX &&
+	    esb_cfg.tx_mode == NRF_ESB_TXMODE_AUTO &&
+	    esb_state == ESB_STATE_IDLE) {
+		start_tx_transaction();
+	}
+}
+
 int nrf_esb_write_payload(const struct nrf_esb_payload *payload)
 {
+	int ret = nrf_esb_write_payloads(payload, 1);
+
+	return (ret < 0) ? ret : 0;
+}
+
+int nrf_esb_write_payloads(const struct nrf_esb_payload *payloads,
+			   size_t count)
+{
+	u32_t written;
+	u32_t key;
+	int err = 0;
+
 	if (!esb_initialized) {
 		return -EACCES;
 	}
-	if (payload == NULL) {
+	if (payloads == NULL) {
 		return -EINVAL;
 	}
-	if (payload->length == 0 ||
-	    payload->length > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH ||
-	    (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB &&
-	     payload->length > esb_cfg.payload_length)) {
-		return -EMSGSIZE;
+
+	/* Reserve the slots after the back of the queue and assign their
+	 * PIDs. The radio keeps transmitting from the front while the
+	 * reserved slots are filled.
+	 */
+	key = irq_lock();
+
+	if (tx_fifo.reserved) {
+		irq_unlock(key);
+		return -EBUSY;
 	}
-	if (tx_fifo.count >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		return -ENOMEM;
+
+	for (written = 0; written < count; written++) {
+		const struct nrf_esb_payload *payload = &payloads[written];
+
+		err = tx_payload_check(payload->length, payload->pipe);
+		if (err) {
+			break;
+		}
+		if (tx_fifo.count + written >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
+			err = -ENOMEM;
+			break;
+		}
+
+		tx_slot_prepare(&tx_fifo.slot[tx_fifo_index(written)],
+				payload->length, payload->pipe,
+				payload->noack);
 	}
-	if (payload->pipe >= CONFIG_NRF_ESB_PIPE_COUNT) {
+	tx_fifo.reserved = written;
+
+	irq_unlock(key);
+
+	if (written == 0) {
+		return err;
+	}
+
+	for (u32_t i = 0; i < written; i++) {
+		memcpy(&tx_fifo.slot[tx_fifo_index(i)].rf[RF_HDR_LEN],
+		       payloads[i].data, payloads[i].length);
+	}
+
+	tx_fifo_commit();
+
+	return written;
+}
+
+int nrf_esb_tx_payload_alloc(struct nrf_esb_payload_buf *buf)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (buf == NULL) {
 		return -EINVAL;
 	}
 
 	u32_t key = irq_lock();
 
-	memcpy(tx_fifo.payload[tx_fifo.back], payload,
-	       sizeof(struct nrf_esb_payload));
+	if (tx_fifo.reserved) {
+		irq_unlock(key);
+		return -EBUSY;
+	}
+	if (tx_fifo.count >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
+		irq_unlock(key);
+		return -ENOMEM;
+	}
+	tx_fifo.reserved = 1;
+
+	irq_unlock(key);
 
-	pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
-	tx_fifo.payload[tx_fifo.back]->pid = pids[payload->pipe];
+	memset(buf, 0, sizeof(*buf));
+	buf->data = &tx_fifo.slot[tx_fifo.back].rf[RF_HDR_LEN];
 
-	if (++tx_fifo.back >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		tx_fifo.back = 0;
+	return 0;
+}
+
+int nrf_esb_tx_payload_submit(const struct nrf_esb_payload_buf *buf)
+{
+	struct payload_slot *slot;
+	int err;
+
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (buf == NULL) {
+		return -EINVAL;
+	}
+
+	slot = &tx_fifo.slot[tx_fifo.back];
+	if ((tx_fifo.reserved != 1) || (buf->data != &slot->rf[RF_HDR_LEN])) {
+		return -EINVAL;
 	}
 
-	tx_fifo.count++;
+	err = tx_payload_check(buf->length, buf->pipe);
+	if (err) {
+		return err;
+	}
+
+	u32_t key = irq_lock();
+
+	tx_slot_prepare(slot, buf->length, buf->pipe, buf->noack);
 
 	irq_unlock(key);
 
-	if (esb_cfg.mode == NRF_ESB_MODE_PTX &&
-	    esb_cfg.tx_mode == NRF_ESB_TXMODE_AUTO &&
-	    esb_state == ESB_STATE_IDLE) {
-		start_tx_transaction();
-	}
+	tx_fifo_commit();
 
 	return 0;
 }
 
 int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload)
 {
+	int ret = nrf_esb_read_rx_payloads(payload, 1);
+
+	return (ret < 0) ? ret : 0;
+}
+
+int nrf_esb_read_rx_payloads(struct nrf_esb_payload *payloads, size_t count)
+{
+	u32_t read;
+
 	if (!esb_initialized) {
 		return -EACCES;
 	}
-	if (payload == NULL) {
+	if (payloads == NULL) {
 		return -EINVAL;
 	}
+	if (rx_fifo.lent) {
+		return -EBUSY;
+	}
 
 	if (rx_fifo.count == 0) {
 		return -ENODATA;
 	}
 
-	u32_t key = irq_lock();
+	/* The radio only writes to the slot at the back of the queue, so the
+	 * payloads are copied without locking interrupts.
+	 */
+	for (read = 0; read < MIN(count, rx_fifo.count); read++) {
+		const struct payload_slot *slot =
+			&rx_fifo.slot[rx_fifo_index(read)];
+		struct nrf_esb_payload *payload = &payloads[read];
+
+		payload->length = slot->length;
+		payload->pipe = slot->pipe;
+		payload->rssi = slot->rssi;
+		payload->pid = slot->pid;
+		payload->noack = slot->noack;
+		memcpy(payload->data, &slot->rf[RF_HDR_LEN], slot->length);
+	}
 
-	payload->length = rx_fifo.payload[rx_fifo.front]->length;
-	payload->pipe = rx_fifo.payload[rx_fifo.front]->pipe;
-	payload->rssi = rx_fifo.payload[rx_fifo.front]->rssi;
-	payload->pid = rx_fifo.payload[rx_fifo.front]->pid;
-	payload->noack = rx_fifo.payload[rx_fifo.front]->noack;
-	memcpy(payload->data, rx_fifo.payload[rx_fifo.front]->data,
-	       payload->length);
+	rx_fifo_release(read);
 
-	if (++rx_fifo.front >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
-		rx_fifo.front = 0;
+	return read;
+}
+
+int nrf_esb_rx_payload_get(struct nrf_esb_payload_buf *buf)
+{
+	const struct payload_slot *slot;
+
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (buf == NULL) {
+		return -EINVAL;
 	}
 
-	rx_fifo.count--;
+	if (rx_fifo.lent >= rx_fifo.count) {
+		return -ENODATA;
+	}
 
-	irq_unlock(key);
+	slot = &rx_fifo.slot[rx_fifo_index(rx_fifo.lent)];
+
+	buf->data = (u8_t *)&slot->rf[RF_HDR_LEN];
+	buf->length = slot->length;
+	buf->pipe = slot->pipe;
+	buf->rssi = slot->rssi;
+	buf->noack = slot->noack;
+	buf->pid = slot->pid;
+
+	rx_fifo.lent++;
+
+	return 0;
+}
+
+int nrf_esb_rx_payload_release(const struct nrf_esb_payload_buf *buf)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (buf == NULL) {
+		return -EINVAL;
+	}
+
+	if (rx_fifo.lent == 0 ||
+	    buf->data != &rx_fifo.slot[rx_fifo.front].rf[RF_HDR_LEN]) {
+		return -EINVAL;
+	}
+
+	rx_fifo.lent--;
+	rx_fifo_release(1);
 
 	return 0;
 }
@@ -1252,8 +1981,8 @@ int nrf_esb_start_rx(void)
 	esb_state = ESB_STATE_PRX;
 
 	NRF_RADIO->RXADDRESSES = esb_addr.rx_pipes_enabled;
-	NRF_RADIO->FREQUENCY = esb_addr.rf_channel;
-	NRF_RADIO->PACKETPTR = (u32_t)rx_payload_buffer;
+	NRF_RADIO->FREQUENCY = rf_channel_get();
+	NRF_RADIO->PACKETPTR = (u32_t)rx_fifo_rfbuf();
 
 	NVIC_ClearPendingIRQ(RADIO_IRQn);
 	irq_enable(RADIO_IRQn);
@@ -1262,14 +1991,15 @@ int nrf_esb_start_rx(void)
 	NRF_RADIO->EVENTS_PAYLOAD = 0;
 	NRF_RADIO->EVENTS_DISABLED = 0;
 
-	NRF_RADIO->TASKS_RXEN = 1;
+	hop_prx_timer_start();
+	ESB_TASK_TRIGGER(NRF_RADIO->TASKS_RXEN);
 
 	return 0;
 }
 
 int nrf_esb_stop_rx(void)
 {
-	if (esb_state != ESB_STATE_PRX || esb_state != ESB_STATE_PRX_SEND_ACK) {
+	if (esb_state != ESB_STATE_PRX && esb_state != ESB_STATE_PRX_SEND_ACK) {
 		return -EINVAL;
 	}
 
@@ -1277,11 +2007,16 @@ int nrf_esb_stop_rx(void)
 	NRF_RADIO->INTENCLR = 0xFFFFFFFF;
 	on_radio_disabled = NULL;
 	NRF_RADIO->EVENTS_DISABLED = 0;
-	NRF_RADIO->TASKS_DISABLE = 1;
+	ESB_TASK_TRIGGER(NRF_RADIO->TASKS_DISABLE);
 	while (NRF_RADIO->EVENTS_DISABLED == 0) {
 		/* wait for register to settle */
 	}
 
+	if (hop_enabled()) {
+		ESB_TASK_TRIGGER(ESB_SYS_TIMER->TASKS_SHUTDOWN);
+		sys_timer_init();
+	}
+
 	esb_state = ESB_STATE_IDLE;
 
 	return 0;
@@ -1295,9 +2030,9 @@ int nrf_esb_flush_tx(void)
 
 	u32_t key = irq_lock();
 
+	/* The back is kept, as slots after it can be reserved. */
+	tx_fifo.front = tx_fifo.back;
 	tx_fifo.count = 0;
-	tx_fifo.back = 0;
-	tx_fifo.front = 0;
 
 	irq_unlock(key);
 
@@ -1333,9 +2068,10 @@ int nrf_esb_flush_rx(void)
 
 	u32_t key = irq_lock();
 
+	/* The back is kept, as the radio receives into its slot. */
+	rx_fifo.front = rx_fifo.back;
 	rx_fifo.count = 0;
-	rx_fifo.back = 0;
-	rx_fifo.front = 0;
+	rx_fifo.lent = 0;
 
 	memset(rx_pipe_info, 0, sizeof(rx_pipe_info));
 
@@ -1687,7 +2423,7 @@ int nrf_esb_get_rf_channel(u32_t *channel)
 		return -EINVAL;
 	}
 
-	*channel = esb_addr.rf_channel;
+	*channel = rf_channel_get();
 
 	return 0;
 }
@@ -1716,6 +2452,7 @@ int nrf_esb_set_retransmit_delay(u16_t delay)
 	}
 
 	esb_cfg.retransmit_delay = delay;
+	adaptive_reset();
 
 	return 0;
 }
@@ -1727,6 +2464,7 @@ int nrf_esb_set_retransmit_count(u16_t count)
 	}
 
 	esb_cfg.retransmit_count = count;
+	adaptive_reset();
 
 	return 0;
 }
@@ -1738,6 +2476,7 @@ int nrf_esb_set_bitrate(enum nrf_esb_bitrate bitrate)
 	}
 
 	esb_cfg.bitrate = bitrate;
+	adaptive_reset();
 
 	return update_radio_bitrate() ? 0 : -EINVAL;
 }
@@ -1756,3 +2495,75 @@ int nrf_esb_reuse_pid(u8_t pipe)
 	return 0;
 }
 
+#if CONFIG_NRF_ESB_STATS
+int nrf_esb_get_pipe_stats(u8_t pipe, struct nrf_esb_pipe_stats *stats)
+{
+	if (stats == NULL || pipe >= CONFIG_NRF_ESB_PIPE_COUNT) {
+		return -EINVAL;
+	}
+
+	u32_t key = irq_lock();
+
+	*stats = pipe_stats[pipe];
+	stats->rssi_avg = (s8_t)(rssi_avg_q4[pipe] >> 4);
+
+	irq_unlock(key);
+
+	return 0;
+}
+
+void nrf_esb_reset_stats(void)
+{
+	u32_t key = irq_lock();
+
+	memset(pipe_stats, 0, sizeof(pipe_stats));
+	memset(rssi_avg_q4, 0, sizeof(rssi_avg_q4));
+
+	irq_unlock(key);
+}
+#endif /* CONFIG_NRF_ESB_STATS */
+
+#if CONFIG_NRF_ESB_HOPPING
+int nrf_esb_set_hop_channels(const u8_t *channels, u8_t count)
+{
+	if (esb_state != ESB_STATE_IDLE) {
+		return -EBUSY;
+	}
+	if (count > CONFIG_NRF_ESB_HOP_CHANNELS_MAX ||
+	    (count > 0 && channels == NULL)) {
+		return -EINVAL;
+	}
+
+	for (u32_t i = 0; i < count; i++) {
+		if (channels[i] > 100) {
+			return -EINVAL;
+		}
+	}
+
+	if (count > 0) {
+		memcpy(hop.channels, channels, count);
+	}
+
+	hop.count = count;
+	hop_reset();
+
+	return 0;
+}
+
+int nrf_esb_get_hop_channel(u8_t index, struct nrf_esb_hop_channel *channel)
+{
+	if (channel == NULL || index >= hop.count) {
+		return -EINVAL;
+	}
+
+	u32_t key = irq_lock();
+
+	channel->rf_channel = hop.channels[index];
+	channel->quality = hop.quality[index];
+	channel->blacklisted = hop_blacklisted(index, ESB_TIME_US());
+
+	irq_unlock(key);
+
+	return 0;
+}
+#endif /* CONFIG_NRF_ESB_HOPPING */
@@ -0,0 +1,1015 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Simulation of the RADIO, TIMER, and PPI peripherals used by the Enhanced
+ * ShockBurst module, and of the peer devices it communicates with.
+ *
+ * The model is a discrete-event simulation in virtual time. Tasks triggered
+ * by the module schedule peripheral events, which nrf_esb_sim_run() processes
+ * in time order. After each event, pending interrupts are dispatched to the
+ * handlers of the module with interrupts locked.
+ */
+#include <zephyr.h>
+#include <misc/__assert.h>
+#include <string.h>
+#include <nrf.h>
+#include <nrf_esb_sim.h>
+
+#include "../esb_hal.h"
+#include "../esb_hop.h"
+
+/* Radio ramp-up time in the default ramp-up mode. */
+#define RAMP_UP_US 130
+/* Time a simulated PTX listens for an acknowledgment after ramp-up. */
+#define PEER_ACK_TIMEOUT_US 250
+/* RSSI reported for received frames. */
+#define RSSI_SAMPLE 60
+
+/* Radio packet in RAM: S0 or length field, S1 field, and payload. */
+#define RF_HDR_LEN 2
+#define FRAME_MAX (RF_HDR_LEN + CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH)
+/* Frames that can be on air or referenced at the same time. */
+#define FRAME_COUNT (CONFIG_NRF_ESB_PIPE_COUNT + 2)
+#define EVENT_QUEUE_SIZE (4 * CONFIG_NRF_ESB_PIPE_COUNT + 8)
+#define IRQ_COUNT 32
+/* Compare registers of the timer that the module uses. */
+#define TIMER_CC_COUNT 3
+
+
+NRF_RADIO_Type esb_sim_radio;
+NRF_TIMER_Type esb_sim_timer;
+NRF_PPI_Type esb_sim_ppi;
+
+enum event_type {
+	EVENT_RADIO_READY,
+	EVENT_RADIO_ADDRESS,
+	EVENT_RADIO_END,
+	EVENT_TIMER_COMPARE,
+	EVENT_PEER_TX,
+	EVENT_PEER_ACK_TIMEOUT,
+	EVENT_PRX_ACK,
+	EVENT_PRX_HOP,
+};
+
+struct event {
+	u64_t time;
+	u32_t seq;	/* Orders events scheduled for the same time. */
+	enum event_type type;
+	u32_t gen;	/* Generation of the object the event belongs to. */
+	u32_t arg;
+};
+
+enum radio_state {
+	RADIO_DISABLED,
+	RADIO_RXRU,
+	RADIO_RX,
+	RADIO_TXRU,
+	RADIO_TX,
+};
+
+struct frame {
+	bool in_use;
+	bool lost;
+	bool corrupted;
+	u8_t pipe;
+	u8_t channel;
+	u8_t len;	/* Length in RAM, including the header. */
+	u8_t data[FRAME_MAX];
+	u64_t end;
+};
+
+/* Simulated PTX device. */
+struct peer_ptx {
+	u32_t gen;
+	u32_t seq;
+	u8_t pid;
+	u8_t attempts;
+	bool waiting_ack;
+	struct frame *frame;
+#if CONFIG_NRF_ESB_HOPPING
+	/* Channel hopping state, kept by the functions of the module. */
+	struct esb_hop_ptx hop;
+	u8_t hop_index;
+#endif
+};
+
+/* Last packet received on a pipe by the simulated PRX. */
+struct peer_prx_pipe {
+	bool valid;
+	u8_t pid;
+	u16_t crc;
+};
+
+static struct nrf_esb_sim_config sim_cfg;
+static struct nrf_esb_sim_stats stats;
+static u64_t now;
+static u32_t rand_state = 1;
+
+static struct event queue[EVENT_QUEUE_SIZE];
+static size_t queue_count;
+static u32_t queue_seq;
+
+static void (*isr[IRQ_COUNT])(void);
+static u32_t isr_priority[IRQ_COUNT];
+static u32_t irq_pending;
+
+static u32_t ppi_enabled;
+
+static struct {
+	enum radio_state state;
+	u32_t gen;
+	struct frame *frame;	/* Frame being received or transmitted. */
+} radio;
+
+static struct {
+	bool running;
+	u64_t base;	/* Virtual time at which the counter was zero. */
+	u32_t count;	/* Counter value while the timer is stopped. */
+	u32_t gen;
+} timer;
+
+static struct frame frames[FRAME_COUNT];
+static struct peer_ptx ptx[CONFIG_NRF_ESB_PIPE_COUNT];
+static struct peer_prx_pipe prx_pipe[CONFIG_NRF_ESB_PIPE_COUNT];
+static struct frame prx_ack;
+static u32_t prx_gen;
+static u8_t prx_ack_seq;
+
+#if CONFIG_NRF_ESB_HOPPING
+static u8_t hop_channels[CONFIG_NRF_ESB_HOP_CHANNELS_MAX];
+static u8_t hop_count;
+static u8_t prx_hop_index;
+static u32_t prx_hop_gen;
+#endif
+
+static void radio_disable(void);
+static void radio_enable(enum radio_state state);
+
+static u32_t rand_next(void)
+{
+	/* xorshift32 */
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return rand_state;
+}
+
+static bool rand_chance(u8_t percent)
+{
+	return (rand_next() % 100) < percent;
+}
+
+static void event_schedule(u64_t time, enum event_type type, u32_t gen,
+			   u32_t arg)
+{
+	size_t i;
+
+	__ASSERT(queue_count < ARRAY_SIZE(queue), "Event queue full");
+
+	/* Keep the queue sorted by time, then by scheduling order. */
+	for (i = queue_count; i > 0 && queue[i - 1].time > time; i--) {
+		queue[i] = queue[i - 1];
+	}
+
+	queue[i].time = time;
+	queue[i].seq = queue_seq++;
+	queue[i].type = type;
+	queue[i].gen = gen;
+	queue[i].arg = arg;
+	queue_count++;
+}
+
+static struct event event_pop(void)
+{
+	struct event event = queue[0];
+
+	queue_count--;
+	memmove(&queue[0], &queue[1], queue_count * sizeof(queue[0]));
+
+	return event;
+}
+
+void esb_sim_irq_connect(u32_t irq, u32_t priority, void (*handler)(void))
+{
+	__ASSERT_NO_MSG(irq < IRQ_COUNT);
+
+	isr[irq] = handler;
+	isr_priority[irq] = priority;
+}
+
+u64_t esb_sim_time_us(void)
+{
+	return now;
+}
+
+void esb_sim_irq_pend(u32_t irq)
+{
+	__ASSERT_NO_MSG(irq < IRQ_COUNT);
+
+	irq_pending |= BIT(irq);
+}
+
+void esb_sim_irq_clear(u32_t irq)
+{
+	__ASSERT_NO_MSG(irq < IRQ_COUNT);
+
+	irq_pending &= ~BIT(irq);
+}
+
+/* Call the handlers of pending interrupts, highest priority first. */
+static void irq_dispatch(void)
+{
+	while (irq_pending) {
+		int irq = -1;
+
+		for (size_t i = 0; i < IRQ_COUNT; i++) {
+			if ((irq_pending & BIT(i)) &&
+			    (irq < 0 || isr_priority[i] < isr_priority[irq])) {
+				irq = i;
+			}
+		}
+
+		irq_pending &= ~BIT(irq);
+
+		if (isr[irq]) {
+			unsigned int key = irq_lock();
+
+			isr[irq]();
+			irq_unlock(key);
+		}
+	}
+}
+
+void esb_sim_ppi_enable(u32_t mask)
+{
+	ppi_enabled |= mask;
+	esb_sim_ppi.CHENSET = ppi_enabled;
+}
+
+void esb_sim_ppi_disable(u32_t mask)
+{
+	ppi_enabled &= ~mask;
+	esb_sim_ppi.CHENSET = ppi_enabled;
+}
+
+static bool ppi_channel_enabled(u32_t channel)
+{
+	return (ppi_enabled & BIT(channel)) != 0;
+}
+
+static u32_t timer_count(void)
+{
+	return timer.running ? (u32_t)(now - timer.base) : timer.count;
+}
+
+static void timer_reschedule(void)
+{
+	u32_t count = timer_count();
+
+	timer.gen++;
+
+	if (!timer.running) {
+		return;
+	}
+
+	for (u32_t i = 0; i < TIMER_CC_COUNT; i++) {
+		if (esb_sim_timer.CC[i] > count) {
+			event_schedule(timer.base + esb_sim_timer.CC[i],
+				       EVENT_TIMER_COMPARE, timer.gen, i);
+		}
+	}
+}
+
+static void timer_start(void)
+{
+	if (!timer.running) {
+		timer.base = now - timer.count;
+		timer.running = true;
+	}
+
+	timer_reschedule();
+}
+
+static void timer_stop(void)
+{
+	timer.count = timer_count();
+	timer.running = false;
+	timer_reschedule();
+}
+
+static void timer_clear(void)
+{
+	timer.count = 0;
+	timer.base = now;
+	timer_reschedule();
+}
+
+static void timer_shutdown(void)
+{
+	timer.running = false;
+	timer.count = 0;
+	timer_reschedule();
+}
+
+static void timer_compare(u32_t cc)
+{
+	/* All timer instances share one model, so the interrupt is pended
+	 * for each of them. Only the instance in use has a handler.
+	 */
+	static const u32_t timer_irqs[] = {
+		TIMER0_IRQn, TIMER1_IRQn, TIMER2_IRQn, TIMER3_IRQn, TIMER4_IRQn,
+	};
+
+	esb_sim_timer.EVENTS_COMPARE[cc] = 1;
+
+	if (esb_sim_timer.INTENSET & (TIMER_INTENSET_COMPARE0_Msk << cc)) {
+		for (size_t i = 0; i < ARRAY_SIZE(timer_irqs); i++) {
+			esb_sim_irq_pend(timer_irqs[i]);
+		}
+	}
+
+	if (cc == 0 && ppi_channel_enabled(CONFIG_NRF_ESB_PPI_RX_TIMEOUT)) {
+		radio_disable();
+	}
+
+	if (cc == 1 && ppi_channel_enabled(CONFIG_NRF_ESB_PPI_TX_START)) {
+		radio_enable(RADIO_TXRU);
+	}
+
+	if (esb_sim_timer.SHORTS & (TIMER_SHORTS_COMPARE0_CLEAR_Msk << cc)) {
+		timer_clear();
+	}
+	if (esb_sim_timer.SHORTS & (TIMER_SHORTS_COMPARE0_STOP_Msk << cc)) {
+		timer_stop();
+	}
+}
+
+static bool frame_is_dpl(void)
+{
+	return (esb_sim_radio.PCNF0 & RADIO_PCNF0_LFLEN_Msk) != 0;
+}
+
+/* Payload length of a frame, as the radio decodes it from the header. */
+static u8_t frame_payload_len(const u8_t *data)
+{
+	if (frame_is_dpl()) {
+		return data[0];
+	}
+
+	return (esb_sim_radio.PCNF1 & RADIO_PCNF1_STATLEN_Msk) >>
+	       RADIO_PCNF1_STATLEN_Pos;
+}
+
+static u32_t bits_to_us(u32_t bits)
+{
+	switch (esb_sim_radio.MODE & RADIO_MODE_MODE_Msk) {
+	case RADIO_MODE_MODE_Nrf_2Mbit:
+		return (bits + 1) / 2;
+	case RADIO_MODE_MODE_Nrf_250Kbit:
+		return bits * 4;
+	default:
+		return bits;
+	}
+}
+
+static u32_t address_time_us(void)
+{
+	u32_t preamble = ((esb_sim_radio.MODE & RADIO_MODE_MODE_Msk) ==
+			  RADIO_MODE_MODE_Nrf_2Mbit) ? 2 : 1;
+	u32_t balen = (esb_sim_radio.PCNF1 & RADIO_PCNF1_BALEN_Msk) >>
+		      RADIO_PCNF1_BALEN_Pos;
+
+	return bits_to_us((preamble + balen + 1) * 8);
+}
+
+static u32_t air_time_us(const struct frame *frame)
+{
+	u32_t pcnf0 = esb_sim_radio.PCNF0;
+	u32_t hdr_bits =
+		((pcnf0 & RADIO_PCNF0_S0LEN_Msk) >> RADIO_PCNF0_S0LEN_Pos) * 8 +
+		((pcnf0 & RADIO_PCNF0_LFLEN_Msk) >> RADIO_PCNF0_LFLEN_Pos) +
+		((pcnf0 & RADIO_PCNF0_S1LEN_Msk) >> RADIO_PCNF0_S1LEN_Pos);
+	u32_t crc_len = esb_sim_radio.CRCCNF & RADIO_CRCCNF_LEN_Msk;
+	u32_t payload_bits = (frame->len - RF_HDR_LEN + crc_len) * 8;
+
+	return address_time_us() + bits_to_us(hdr_bits + payload_bits);
+}
+
+static u16_t frame_crc(const struct frame *frame)
+{
+	u16_t crc = 0xFFFF ^ frame->pipe;
+
+	for (size_t i = 0; i < frame->len; i++) {
+		crc ^= (u16_t)frame->data[i] << 8;
+		for (size_t bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+
+	return crc;
+}
+
+static struct frame *frame_alloc(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(frames); i++) {
+		struct frame *frame = &frames[i];
+		bool referenced = (frame == radio.frame);
+
+		for (size_t j = 0; j < ARRAY_SIZE(ptx); j++) {
+			referenced |= (frame == ptx[j].frame);
+		}
+
+		if (!referenced && (!frame->in_use || frame->end < now)) {
+			memset(frame, 0, sizeof(*frame));
+			frame->in_use = true;
+			return frame;
+		}
+	}
+
+	__ASSERT(false, "No free frame");
+	return NULL;
+}
+
+/* Put a frame on air, starting now. */
+static void frame_start(struct frame *frame)
+{
+	frame->end = now + air_time_us(frame);
+	frame->lost = rand_chance(sim_cfg.loss) ||
+		      (sim_cfg.channel_loss &&
+		       rand_chance(sim_cfg.channel_loss[frame->channel]));
+
+	for (size_t i = 0; i < ARRAY_SIZE(frames); i++) {
+		struct frame *other = &frames[i];
+
+		if (other != frame && other->in_use && other->end > now &&
+		    other->channel == frame->channel) {
+			if (!other->corrupted) {
+				stats.collisions++;
+			}
+			if (!frame->corrupted) {
+				stats.collisions++;
+			}
+			other->corrupted = true;
+			frame->corrupted = true;
+		}
+	}
+}
+
+/* Transmit a frame from a simulated peer. */
+static void peer_transmit(struct frame *frame)
+{
+	frame_start(frame);
+
+	if (radio.state == RADIO_RX && radio.frame == NULL && !frame->lost &&
+	    esb_sim_radio.FREQUENCY == frame->channel &&
+	    (esb_sim_radio.RXADDRESSES & BIT(frame->pipe))) {
+		radio.frame = frame;
+		event_schedule(now + address_time_us(), EVENT_RADIO_ADDRESS,
+			       radio.gen, 0);
+		event_schedule(frame->end, EVENT_RADIO_END, radio.gen, 0);
+	}
+}
+
+/* RF channel of a simulated PTX. Peers that do not hop use the channel of
+ * the module.
+ */
+static u8_t ptx_channel(u32_t index)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	if (hop_count > 0) {
+		return hop_channels[ptx[index].hop_index];
+	}
+#endif
+	return esb_sim_radio.FREQUENCY;
+}
+
+static u8_t prx_channel(void)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	if (hop_count > 0) {
+		return hop_channels[prx_hop_index];
+	}
+#endif
+	return esb_sim_radio.FREQUENCY;
+}
+
+/* Choose the channel of a TX attempt of a simulated PTX, like the module does.
+ * Returns the time until the next slot if the attempt has to wait for it.
+ */
+static u32_t ptx_hop_schedule(u32_t index)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	struct peer_ptx *peer = &ptx[index];
+	u32_t left;
+
+	if (hop_count == 0) {
+		return 0;
+	}
+
+	left = esb_hop_ptx_locate(&peer->hop, hop_count, now,
+				  &peer->hop_index);
+	if (!esb_hop_ptx_searching(&peer->hop) &&
+	    left < ESB_HOP_SLOT_GUARD_US) {
+		return left;
+	}
+#endif
+	return 0;
+}
+
+static void ptx_hop_attempt(u32_t index, bool acked)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	struct peer_ptx *peer = &ptx[index];
+
+	if (hop_count == 0) {
+		return;
+	}
+
+	esb_hop_ptx_attempt(&peer->hop, hop_count, peer->hop_index, acked,
+			    now);
+#endif
+}
+
+static void prx_hop_schedule(u64_t time)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	prx_hop_gen++;
+	event_schedule(time + CONFIG_NRF_ESB_HOP_SLOT_US, EVENT_PRX_HOP,
+		       prx_hop_gen, 0);
+#endif
+}
+
+/* Move the simulated PRX on to the next channel, after an exchange that ended
+ * at the given time, or at the end of a slot.
+ */
+static void prx_hop_next(u64_t time)
+{
+#if CONFIG_NRF_ESB_HOPPING
+	if (hop_count == 0) {
+		return;
+	}
+
+	prx_hop_index = (prx_hop_index + 1) % hop_count;
+	prx_hop_schedule(time);
+#endif
+}
+
+static void ptx_schedule(u32_t index)
+{
+	u32_t interval = sim_cfg.peer_interval_us;
+	u32_t delay = interval / 2 + rand_next() % (interval + 1);
+
+	event_schedule(now + delay, EVENT_PEER_TX, ptx[index].gen, index);
+}
+
+static void ptx_tx(u32_t index)
+{
+	struct peer_ptx *peer = &ptx[index];
+	u8_t len = sim_cfg.peer_payload_length;
+	u32_t wait = ptx_hop_schedule(index);
+
+	if (wait > 0) {
+		event_schedule(now + wait, EVENT_PEER_TX, peer->gen, index);
+		return;
+	}
+
+	if (!peer->waiting_ack) {
+		struct frame *frame = frame_alloc();
+
+		peer->seq++;
+		peer->pid = (peer->pid + 1) % 4;
+		peer->attempts = 0;
+		peer->frame = frame;
+		stats.peer_tx_packets++;
+
+		frame->pipe = index;
+		frame->len = RF_HDR_LEN + len;
+		if (frame_is_dpl()) {
+			frame->data[0] = len;
+			frame->data[1] = (peer->pid << 1) | 0x01;
+		} else {
+			frame->data[0] = peer->pid;
+			frame->data[1] = 0;
+		}
+		memset(&frame->data[RF_HDR_LEN], index, len);
+		memcpy(&frame->data[RF_HDR_LEN], &peer->seq,
+		       MIN(len, sizeof(peer->seq)));
+	} else {
+		/* Retransmit the same frame. */
+		stats.peer_retransmits++;
+		peer->attempts++;
+		peer->frame->in_use = true;
+		peer->frame->corrupted = false;
+	}
+
+	peer->waiting_ack = true;
+	peer->frame->channel = ptx_channel(index);
+	peer_transmit(peer->frame);
+
+	event_schedule(peer->frame->end + RAMP_UP_US + PEER_ACK_TIMEOUT_US,
+		       EVENT_PEER_ACK_TIMEOUT, peer->gen, index);
+}
+
+static void ptx_ack_timeout(u32_t index)
+{
+	struct peer_ptx *peer = &ptx[index];
+
+	ptx_hop_attempt(index, false);
+
+	if (peer->attempts < sim_cfg.peer_retransmit_count) {
+		event_schedule(now + sim_cfg.peer_retransmit_delay,
+			       EVENT_PEER_TX, peer->gen, index);
+		return;
+	}
+
+	stats.peer_tx_failed++;
+	peer->waiting_ack = false;
+	peer->frame = NULL;
+	ptx_schedule(index);
+}
+
+static void ptx_ack_received(u32_t index)
+{
+	struct peer_ptx *peer = &ptx[index];
+
+	stats.peer_tx_acked++;
+	ptx_hop_attempt(index, true);
+	peer->waiting_ack = false;
+	peer->frame = NULL;
+
+	/* Cancel the acknowledgment timeout. */
+	peer->gen++;
+	ptx_schedule(index);
+}
+
+static void prx_receive(const struct frame *frame)
+{
+	struct peer_prx_pipe *pipe = &prx_pipe[frame->pipe];
+	bool dpl = frame_is_dpl();
+	u8_t pid = dpl ? (frame->data[1] >> 1) : frame->data[0];
+	u16_t crc = frame_crc(frame);
+	bool ack = !dpl || !sim_cfg.selective_auto_ack ||
+		   (frame->data[1] & 0x01);
+
+	if (pipe->valid && pipe->pid == pid && pipe->crc == crc) {
+		stats.peer_rx_duplicates++;
+	} else {
+		stats.peer_rx_packets++;
+	}
+
+	pipe->valid = true;
+	pipe->pid = pid;
+	pipe->crc = crc;
+
+	if (!ack) {
+		prx_hop_next(frame->end);
+		return;
+	}
+
+	memset(&prx_ack, 0, sizeof(prx_ack));
+	prx_ack.pipe = frame->pipe;
+	prx_ack.channel = frame->channel;
+
+	if (dpl) {
+		u8_t len = sim_cfg.ack_payload_length;
+
+		prx_ack.data[0] = len;
+		prx_ack.data[1] = frame->data[1];
+		for (size_t i = 0; i < len; i++) {
+			prx_ack.data[RF_HDR_LEN + i] = prx_ack_seq++;
+		}
+		prx_ack.len = RF_HDR_LEN + len;
+	} else {
+		prx_ack.data[0] = frame->data[0];
+		prx_ack.len = RF_HDR_LEN;
+	}
+
+	event_schedule(now + RAMP_UP_US + sim_cfg.latency_us, EVENT_PRX_ACK,
+		       prx_gen, 0);
+}
+
+static void prx_ack_tx(void)
+{
+	struct frame *frame = frame_alloc();
+
+	memcpy(frame->data, prx_ack.data, sizeof(frame->data));
+	frame->pipe = prx_ack.pipe;
+	frame->channel = prx_ack.channel;
+	frame->len = prx_ack.len;
+
+	peer_transmit(frame);
+	prx_hop_next(frame->end);
+}
+
+/* Deliver a frame transmitted by the module to the simulated peers. */
+static void device_frame_deliver(struct frame *frame)
+{
+	if (frame->lost) {
+		stats.lost_frames++;
+		return;
+	}
+
+	if (frame->pipe < sim_cfg.peer_count && ptx[frame->pipe].waiting_ack) {
+		if (!frame->corrupted &&
+		    frame->channel == ptx[frame->pipe].frame->channel) {
+			ptx_ack_received(frame->pipe);
+		}
+		return;
+	}
+
+	if (frame->channel != prx_channel()) {
+		return;
+	}
+
+	if (frame->corrupted) {
+		return;
+	}
+
+	prx_receive(frame);
+}
+
+static void radio_event(volatile u32_t *event, u32_t int_mask)
+{
+	*event = 1;
+
+	if (esb_sim_radio.INTENSET & int_mask) {
+		esb_sim_irq_pend(RADIO_IRQn);
+	}
+}
+
+static void radio_enable(enum radio_state state)
+{
+	if (radio.state != RADIO_DISABLED) {
+		return;
+	}
+
+	radio.state = state;
+	event_schedule(now + RAMP_UP_US, EVENT_RADIO_READY, radio.gen, 0);
+}
+
+static void radio_disable(void)
+{
+	/* Cancel the events of the ongoing operation. */
+	radio.gen++;
+
+	if (radio.state == RADIO_TX && radio.frame) {
+		radio.frame->corrupted = true;
+		radio.frame->end = now;
+	}
+
+	radio.frame = NULL;
+	radio.state = RADIO_DISABLED;
+
+	radio_event(&esb_sim_radio.EVENTS_DISABLED,
+		    RADIO_INTENSET_DISABLED_Msk);
+
+	if (esb_sim_radio.SHORTS & RADIO_SHORTS_DISABLED_TXEN_Msk) {
+		radio_enable(RADIO_TXRU);
+	} else if (esb_sim_radio.SHORTS & RADIO_SHORTS_DISABLED_RXEN_Msk) {
+		radio_enable(RADIO_RXRU);
+	}
+}
+
+static void radio_start(void)
+{
+	if (radio.state == RADIO_TXRU) {
+		u8_t *packet = (u8_t *)(uintptr_t)esb_sim_radio.PACKETPTR;
+		struct frame *frame = frame_alloc();
+		u8_t len = frame_payload_len(packet);
+
+		radio.state = RADIO_TX;
+		radio.frame = frame;
+
+		frame->pipe = esb_sim_radio.TXADDRESS;
+		frame->channel = esb_sim_radio.FREQUENCY;
+		frame->len = RF_HDR_LEN + MIN(len, CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH);
+		memcpy(frame->data, packet, frame->len);
+
+		frame_start(frame);
+		stats.tx_frames++;
+
+		event_schedule(now + address_time_us(), EVENT_RADIO_ADDRESS,
+			       radio.gen, 0);
+		event_schedule(frame->end, EVENT_RADIO_END, radio.gen, 0);
+	} else if (radio.state == RADIO_RXRU) {
+		radio.state = RADIO_RX;
+	}
+}
+
+static void radio_ready(void)
+{
+	radio_event(&esb_sim_radio.EVENTS_READY, RADIO_INTENSET_READY_Msk);
+
+	if (ppi_channel_enabled(CONFIG_NRF_ESB_PPI_TIMER_START)) {
+		timer_start();
+	}
+
+	if (esb_sim_radio.SHORTS & RADIO_SHORTS_READY_START_Msk) {
+		radio_start();
+	}
+}
+
+static void radio_address(void)
+{
+	radio_event(&esb_sim_radio.EVENTS_ADDRESS, RADIO_INTENSET_ADDRESS_Msk);
+
+	if (ppi_channel_enabled(CONFIG_NRF_ESB_PPI_TIMER_STOP)) {
+		timer_shutdown();
+	}
+}
+
+static void radio_end(void)
+{
+	struct frame *frame = radio.frame;
+	bool tx = (radio.state == RADIO_TX);
+
+	radio.frame = NULL;
+
+	if (!tx) {
+		u8_t *packet = (u8_t *)(uintptr_t)esb_sim_radio.PACKETPTR;
+		u8_t maxlen = (esb_sim_radio.PCNF1 & RADIO_PCNF1_MAXLEN_Msk) >>
+			      RADIO_PCNF1_MAXLEN_Pos;
+		bool crc_ok = !frame->corrupted &&
+			      (frame->len - RF_HDR_LEN) <= maxlen;
+
+		memcpy(packet, frame->data, frame->len);
+		esb_sim_radio.CRCSTATUS = crc_ok;
+		esb_sim_radio.RXMATCH = frame->pipe;
+		esb_sim_radio.RXCRC = frame_crc(frame);
+		esb_sim_radio.RSSISAMPLE = RSSI_SAMPLE;
+		stats.rx_frames++;
+	}
+
+	radio_event(&esb_sim_radio.EVENTS_PAYLOAD, 0);
+	radio_event(&esb_sim_radio.EVENTS_END, RADIO_INTENSET_END_Msk);
+
+	/* Apply the shortcuts before the frame reaches the peers, so that the
+	 * radio is ready in time for a response.
+	 */
+	if (esb_sim_radio.SHORTS & RADIO_SHORTS_END_DISABLE_Msk) {
+		radio_disable();
+	}
+
+	if (tx) {
+		device_frame_deliver(frame);
+		frame->in_use = false;
+	}
+}
+
+void esb_sim_task_trigger(volatile u32_t *task)
+{
+	if (task == &esb_sim_radio.TASKS_TXEN) {
+		radio_enable(RADIO_TXRU);
+	} else if (task == &esb_sim_radio.TASKS_RXEN) {
+		radio_enable(RADIO_RXRU);
+	} else if (task == &esb_sim_radio.TASKS_DISABLE) {
+		radio_disable();
+	} else if (task == &esb_sim_timer.TASKS_START) {
+		timer_start();
+	} else if (task == &esb_sim_timer.TASKS_STOP) {
+		timer_stop();
+	} else if (task == &esb_sim_timer.TASKS_CLEAR) {
+		timer_clear();
+	} else if (task == &esb_sim_timer.TASKS_SHUTDOWN) {
+		timer_shutdown();
+	}
+}
+
+static void event_process(const struct event *event)
+{
+	switch (event->type) {
+	case EVENT_RADIO_READY:
+		if (event->gen == radio.gen) {
+			radio_ready();
+		}
+		break;
+
+	case EVENT_RADIO_ADDRESS:
+		if (event->gen == radio.gen) {
+			radio_address();
+		}
+		break;
+
+	case EVENT_RADIO_END:
+		if (event->gen == radio.gen) {
+			radio_end();
+		}
+		break;
+
+	case EVENT_TIMER_COMPARE:
+		if (event->gen == timer.gen) {
+			timer_compare(event->arg);
+		}
+		break;
+
+	case EVENT_PEER_TX:
+		if (event->gen == ptx[event->arg].gen) {
+			ptx_tx(event->arg);
+		}
+		break;
+
+	case EVENT_PEER_ACK_TIMEOUT:
+		if (event->gen == ptx[event->arg].gen) {
+			ptx_ack_timeout(event->arg);
+		}
+		break;
+
+	case EVENT_PRX_ACK:
+		if (event->gen == prx_gen) {
+			prx_ack_tx();
+		}
+		break;
+
+	case EVENT_PRX_HOP:
+#if CONFIG_NRF_ESB_HOPPING
+		if (event->gen == prx_hop_gen) {
+			prx_hop_next(now);
+		}
+#endif
+		break;
+	}
+}
+
+void nrf_esb_sim_configure(const struct nrf_esb_sim_config *config)
+{
+	__ASSERT_NO_MSG(config != NULL);
+	__ASSERT_NO_MSG(config->peer_count <= CONFIG_NRF_ESB_PIPE_COUNT);
+	__ASSERT_NO_MSG(config->peer_payload_length <=
+			CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH);
+	__ASSERT_NO_MSG(config->ack_payload_length <=
+			CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH);
+#if CONFIG_NRF_ESB_HOPPING
+	__ASSERT_NO_MSG(config->hop_channel_count <=
+			CONFIG_NRF_ESB_HOP_CHANNELS_MAX);
+#else
+	__ASSERT(config->hop_channel_count == 0, "Channel hopping disabled");
+#endif
+
+	sim_cfg = *config;
+	rand_state = config->seed ? config->seed : 1;
+
+	memset(&stats, 0, sizeof(stats));
+	memset(prx_pipe, 0, sizeof(prx_pipe));
+	prx_gen++;
+	prx_ack_seq = 0;
+
+#if CONFIG_NRF_ESB_HOPPING
+	hop_count = config->hop_channel_count;
+	if (hop_count > 0) {
+		memcpy(hop_channels, config->hop_channels, hop_count);
+	}
+
+	prx_hop_index = 0;
+	prx_hop_gen++;
+	if (hop_count > 0) {
+		prx_hop_schedule(now);
+	}
+#endif
+
+	for (size_t i = 0; i < ARRAY_SIZE(frames); i++) {
+		if (&frames[i] != radio.frame) {
+			frames[i].in_use = false;
+		}
+	}
+
+	for (u32_t i = 0; i < ARRAY_SIZE(ptx); i++) {
+		u32_t gen = ptx[i].gen + 1;
+
+		memset(&ptx[i], 0, sizeof(ptx[i]));
+		ptx[i].gen = gen;
+
+		if (i < sim_cfg.peer_count) {
+			ptx_schedule(i);
+		}
+	}
+}
+
+void nrf_esb_sim_run(u32_t duration_us)
+{
+	u64_t end = now + duration_us;
+
+	/* Interrupts pended by the module outside of the simulation. */
+	irq_dispatch();
+
+	while (queue_count > 0 && queue[0].time <= end) {
+		struct event event = event_pop();
+
+		now = event.time;
+		event_process(&event);
+		irq_dispatch();
+	}
+
+	now = end;
+}
+
+void nrf_esb_sim_stats_get(struct nrf_esb_sim_stats *out)
+{
+	__ASSERT_NO_MSG(out != NULL);
+
+	*out = stats;
+	out->time_us = now;
+}
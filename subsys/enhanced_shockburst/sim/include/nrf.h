@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Peripheral definitions used by the Enhanced ShockBurst module when it runs
+ * on the simulated radio. Only the registers and fields that the module uses
+ * are provided. The field values match the nRF52 MDK.
+ */
+#ifndef ESB_SIM_NRF_H__
+#define ESB_SIM_NRF_H__
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __ALIGN(x) __attribute__((aligned(x)))
+#define __CORTEX_M (0x00U)
+
+static inline u32_t __REV(u32_t value)
+{
+	return __builtin_bswap32(value);
+}
+
+/* Interrupt numbers. They are dispatched by the simulation model only. */
+enum {
+	RADIO_IRQn = 1,
+	TIMER0_IRQn = 8,
+	TIMER1_IRQn = 9,
+	TIMER2_IRQn = 10,
+	SWI0_IRQn = 20,
+	TIMER3_IRQn = 26,
+	TIMER4_IRQn = 27,
+};
+
+#define NRF5_IRQ_RADIO_IRQn RADIO_IRQn
+#define NRF5_IRQ_SWI0_IRQn SWI0_IRQn
+
+void esb_sim_irq_pend(u32_t irq);
+void esb_sim_irq_clear(u32_t irq);
+
+static inline void NVIC_SetPendingIRQ(u32_t irq)
+{
+	esb_sim_irq_pend(irq);
+}
+
+static inline void NVIC_ClearPendingIRQ(u32_t irq)
+{
+	esb_sim_irq_clear(irq);
+}
+
+typedef struct {
+	volatile u32_t TASKS_TXEN;
+	volatile u32_t TASKS_RXEN;
+	volatile u32_t TASKS_DISABLE;
+	volatile u32_t EVENTS_READY;
+	volatile u32_t EVENTS_ADDRESS;
+	volatile u32_t EVENTS_PAYLOAD;
+	volatile u32_t EVENTS_END;
+	volatile u32_t EVENTS_DISABLED;
+	volatile u32_t EVENTS_BCMATCH;
+	volatile u32_t SHORTS;
+	volatile u32_t INTENSET;
+	volatile u32_t INTENCLR;
+	volatile u32_t CRCSTATUS;
+	volatile u32_t RXMATCH;
+	volatile u32_t RXCRC;
+	volatile u32_t PACKETPTR;
+	volatile u32_t FREQUENCY;
+	volatile u32_t TXPOWER;
+	volatile u32_t MODE;
+	volatile u32_t PCNF0;
+	volatile u32_t PCNF1;
+	volatile u32_t BASE0;
+	volatile u32_t BASE1;
+	volatile u32_t PREFIX0;
+	volatile u32_t PREFIX1;
+	volatile u32_t TXADDRESS;
+	volatile u32_t RXADDRESSES;
+	volatile u32_t CRCCNF;
+	volatile u32_t CRCPOLY;
+	volatile u32_t CRCINIT;
+	volatile u32_t RSSISAMPLE;
+	volatile u32_t BCC;
+	volatile u32_t MODECNF0;
+} NRF_RADIO_Type;
+
+typedef struct {
+	volatile u32_t TASKS_START;
+	volatile u32_t TASKS_STOP;
+	volatile u32_t TASKS_CLEAR;
+	volatile u32_t TASKS_SHUTDOWN;
+	volatile u32_t EVENTS_COMPARE[6];
+	volatile u32_t SHORTS;
+	volatile u32_t INTENSET;
+	volatile u32_t MODE;
+	volatile u32_t BITMODE;
+	volatile u32_t PRESCALER;
+	volatile u32_t CC[6];
+} NRF_TIMER_Type;
+
+typedef struct {
+	volatile u32_t CHENSET;
+	volatile u32_t CHENCLR;
+	struct {
+		volatile u32_t EEP;
+		volatile u32_t TEP;
+	} CH[20];
+} NRF_PPI_Type;
+
+extern NRF_RADIO_Type esb_sim_radio;
+extern NRF_TIMER_Type esb_sim_timer;
+extern NRF_PPI_Type esb_sim_ppi;
+
+#define NRF_RADIO (&esb_sim_radio)
+#define NRF_PPI (&esb_sim_ppi)
+/* The module uses a single timer, so all instances share one model. */
+#define NRF_TIMER0 (&esb_sim_timer)
+#define NRF_TIMER1 (&esb_sim_timer)
+#define NRF_TIMER2 (&esb_sim_timer)
+#define NRF_TIMER3 (&esb_sim_timer)
+#define NRF_TIMER4 (&esb_sim_timer)
+
+#define RADIO_SHORTS_READY_START_Pos (0UL)
+#define RADIO_SHORTS_READY_START_Msk (0x1UL << RADIO_SHORTS_READY_START_Pos)
+#define RADIO_SHORTS_READY_START_Enabled (1UL)
+#define RADIO_SHORTS_END_DISABLE_Pos (1UL)
+#define RADIO_SHORTS_END_DISABLE_Msk (0x1UL << RADIO_SHORTS_END_DISABLE_Pos)
+#define RADIO_SHORTS_END_DISABLE_Enabled (1UL)
+#define RADIO_SHORTS_DISABLED_TXEN_Pos (2UL)
+#define RADIO_SHORTS_DISABLED_TXEN_Msk (0x1UL << RADIO_SHORTS_DISABLED_TXEN_Pos)
+#define RADIO_SHORTS_DISABLED_RXEN_Pos (3UL)
+#define RADIO_SHORTS_DISABLED_RXEN_Msk (0x1UL << RADIO_SHORTS_DISABLED_RXEN_Pos)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Pos (4UL)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Msk \
+	(0x1UL << RADIO_SHORTS_ADDRESS_RSSISTART_Pos)
+#define RADIO_SHORTS_ADDRESS_BCSTART_Pos (6UL)
+#define RADIO_SHORTS_ADDRESS_BCSTART_Msk \
+	(0x1UL << RADIO_SHORTS_ADDRESS_BCSTART_Pos)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Pos (8UL)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Msk \
+	(0x1UL << RADIO_SHORTS_DISABLED_RSSISTOP_Pos)
+
+#define RADIO_INTENSET_READY_Pos (0UL)
+#define RADIO_INTENSET_READY_Msk (0x1UL << RADIO_INTENSET_READY_Pos)
+#define RADIO_INTENSET_ADDRESS_Pos (1UL)
+#define RADIO_INTENSET_ADDRESS_Msk (0x1UL << RADIO_INTENSET_ADDRESS_Pos)
+#define RADIO_INTENSET_END_Pos (3UL)
+#define RADIO_INTENSET_END_Msk (0x1UL << RADIO_INTENSET_END_Pos)
+#define RADIO_INTENSET_DISABLED_Pos (4UL)
+#define RADIO_INTENSET_DISABLED_Msk (0x1UL << RADIO_INTENSET_DISABLED_Pos)
+
+#define RADIO_TXPOWER_TXPOWER_Pos (0UL)
+#define RADIO_TXPOWER_TXPOWER_Pos4dBm (0x04UL)
+#define RADIO_TXPOWER_TXPOWER_Pos3dBm (0x03UL)
+#define RADIO_TXPOWER_TXPOWER_0dBm (0x00UL)
+#define RADIO_TXPOWER_TXPOWER_Neg4dBm (0xFCUL)
+#define RADIO_TXPOWER_TXPOWER_Neg8dBm (0xF8UL)
+#define RADIO_TXPOWER_TXPOWER_Neg12dBm (0xF4UL)
+#define RADIO_TXPOWER_TXPOWER_Neg16dBm (0xF0UL)
+#define RADIO_TXPOWER_TXPOWER_Neg20dBm (0xECUL)
+#define RADIO_TXPOWER_TXPOWER_Neg30dBm (0xE2UL)
+#define RADIO_TXPOWER_TXPOWER_Neg40dBm (0xD8UL)
+
+#define RADIO_MODE_MODE_Pos (0UL)
+#define RADIO_MODE_MODE_Msk (0xFUL << RADIO_MODE_MODE_Pos)
+#define RADIO_MODE_MODE_Nrf_1Mbit (0UL)
+#define RADIO_MODE_MODE_Nrf_2Mbit (1UL)
+#define RADIO_MODE_MODE_Nrf_250Kbit (2UL)
+#define RADIO_MODE_MODE_Ble_1Mbit (3UL)
+
+#define RADIO_PCNF0_LFLEN_Pos (0UL)
+#define RADIO_PCNF0_LFLEN_Msk (0xFUL << RADIO_PCNF0_LFLEN_Pos)
+#define RADIO_PCNF0_S0LEN_Pos (8UL)
+#define RADIO_PCNF0_S0LEN_Msk (0x1UL << RADIO_PCNF0_S0LEN_Pos)
+#define RADIO_PCNF0_S1LEN_Pos (16UL)
+#define RADIO_PCNF0_S1LEN_Msk (0xFUL << RADIO_PCNF0_S1LEN_Pos)
+
+#define RADIO_PCNF1_MAXLEN_Pos (0UL)
+#define RADIO_PCNF1_MAXLEN_Msk (0xFFUL << RADIO_PCNF1_MAXLEN_Pos)
+#define RADIO_PCNF1_STATLEN_Pos (8UL)
+#define RADIO_PCNF1_STATLEN_Msk (0xFFUL << RADIO_PCNF1_STATLEN_Pos)
+#define RADIO_PCNF1_BALEN_Pos (16UL)
+#define RADIO_PCNF1_BALEN_Msk (0x7UL << RADIO_PCNF1_BALEN_Pos)
+#define RADIO_PCNF1_ENDIAN_Pos (24UL)
+#define RADIO_PCNF1_ENDIAN_Big (1UL)
+#define RADIO_PCNF1_WHITEEN_Pos (25UL)
+#define RADIO_PCNF1_WHITEEN_Disabled (0UL)
+
+#define RADIO_CRCCNF_LEN_Pos (0UL)
+#define RADIO_CRCCNF_LEN_Msk (0x3UL << RADIO_CRCCNF_LEN_Pos)
+#define RADIO_CRCCNF_LEN_Disabled (0UL)
+#define RADIO_CRCCNF_LEN_One (1UL)
+#define RADIO_CRCCNF_LEN_Two (2UL)
+
+#define RADIO_MODECNF0_RU_Pos (0UL)
+#define RADIO_MODECNF0_RU_Msk (0x1UL << RADIO_MODECNF0_RU_Pos)
+#define RADIO_MODECNF0_RU_Default (0UL)
+
+#define TIMER_SHORTS_COMPARE0_CLEAR_Msk (0x1UL << 0)
+#define TIMER_SHORTS_COMPARE1_CLEAR_Msk (0x1UL << 1)
+#define TIMER_SHORTS_COMPARE2_CLEAR_Msk (0x1UL << 2)
+#define TIMER_SHORTS_COMPARE0_STOP_Msk (0x1UL << 8)
+#define TIMER_SHORTS_COMPARE1_STOP_Msk (0x1UL << 9)
+#define TIMER_INTENSET_COMPARE0_Msk (0x1UL << 16)
+#define TIMER_INTENSET_COMPARE2_Msk (0x1UL << 18)
+#define TIMER_MODE_MODE_Pos (0UL)
+#define TIMER_MODE_MODE_Timer (0UL)
+#define TIMER_BITMODE_BITMODE_Pos (0UL)
+#define TIMER_BITMODE_BITMODE_16Bit (0UL)
+#define TIMER_BITMODE_BITMODE_32Bit (3UL)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESB_SIM_NRF_H__ */
@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Placeholder for the SoC header, which has no content that the Enhanced
+ * ShockBurst module uses on the simulated radio.
+ */
+#ifndef ESB_SIM_NRF_COMMON_H__
+#define ESB_SIM_NRF_COMMON_H__
+
+#endif /* ESB_SIM_NRF_COMMON_H__ */
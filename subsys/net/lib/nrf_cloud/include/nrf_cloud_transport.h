@@ -104,6 +104,20 @@ void nct_dc_endpoint_set(const struct nrf_cloud_data *tx_endpoint,
 void nct_dc_endpoint_get(struct nrf_cloud_data *tx_endpoint,
 			 struct nrf_cloud_data *rx_endpoint);
 
+/**
+ * @brief Free the endpoint information.
+ */
+void nct_dc_endpoint_invalidate(void);
+
+/**
+ * @brief Register a topic handled by the application.
+ *
+ * The topic is subscribed to together with the data channel, and incoming
+ * publishes on it are routed to the handler instead of the data channel.
+ */
+int nct_app_topic_register(const struct nrf_cloud_data *topic,
+			   nrf_cloud_topic_handler_t handler);
+
 /**@brief Needed for keep alive. */
 void nct_process(void);
 
@@ -10,7 +10,11 @@
 #include "nrf_cloud_transport.h"
 #include "nrf_cloud_mem.h"
 
+#include <zephyr.h>
 #include <logging/log.h>
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS_PROFILER)
+#include <profiler.h>
+#endif
 
 LOG_MODULE_REGISTER(nrf_cloud, CONFIG_NRF_CLOUD_LOG_LEVEL);
 
@@ -30,6 +34,79 @@ static volatile enum nfsm_state m_current_state = STATE_IDLE;
  */
 static nrf_cloud_event_handler_t m_event_handler;
 
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS)
+/* Connection establishment timing. Timestamps are uptime in milliseconds,
+ * zero if the state was not entered during the current connection.
+ */
+static struct {
+	u32_t connect_start;
+	u32_t handshake_done;
+	u32_t state_time[STATE_TOTAL];
+	u32_t connect_count;
+	u32_t resume_count;
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS_PROFILER)
+	u16_t profiler_event_id;
+#endif
+} m_connect_stats;
+
+static void connect_stats_init(void)
+{
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS_PROFILER)
+	static const char *labels[] = {"state", "elapsed_ms"};
+	static const enum profiler_arg types[] = {
+		PROFILER_ARG_U32,
+		PROFILER_ARG_U32
+	};
+
+	m_connect_stats.profiler_event_id = profiler_register_event_type(
+		"nrf_cloud_state", labels, types, ARRAY_SIZE(labels));
+#endif
+}
+
+static void connect_stats_start(void)
+{
+	memset(m_connect_stats.state_time, 0,
+	       sizeof(m_connect_stats.state_time));
+	m_connect_stats.handshake_done = 0;
+	m_connect_stats.connect_start = k_uptime_get_32();
+	m_connect_stats.connect_count++;
+}
+
+static void connect_stats_state_enter(enum nfsm_state state)
+{
+	u32_t now = k_uptime_get_32();
+
+	m_connect_stats.state_time[state] = now;
+
+	if ((state == STATE_DC_CONNECTED) &&
+	    (m_connect_stats.state_time[STATE_UA_COMPLETE] == 0)) {
+		m_connect_stats.resume_count++;
+	}
+
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS_PROFILER)
+	if (is_profiling_enabled(m_connect_stats.profiler_event_id)) {
+		struct log_event_buf buf;
+
+		profiler_log_start(&buf);
+		profiler_log_encode_u32(&buf, state);
+		profiler_log_encode_u32(&buf,
+			now - m_connect_stats.connect_start);
+		profiler_log_send(&buf, m_connect_stats.profiler_event_id);
+	}
+#endif
+}
+
+/* Time between two states, zero if either was not entered. */
+static u32_t connect_stats_elapsed(u32_t from, u32_t to)
+{
+	if ((from == 0) || (to == 0)) {
+		return 0;
+	}
+
+	return to - from;
+}
+#endif /* defined(CONFIG_NRF_CLOUD_CONNECT_STATS) */
+
 
 enum nfsm_state nfsm_get_current_state(void)
 {
@@ -41,6 +118,12 @@ void nfsm_set_current_state_and_notify(enum nfsm_state state,
 {
 	LOG_DBG("state: %d", state);
 
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS)
+	if (state != m_current_state) {
+		connect_stats_state_enter(state);
+	}
+#endif
+
 	m_current_state = state;
 	if ((m_event_handler != NULL) && (evt != NULL)) {
 		m_event_handler(evt);
@@ -76,6 +159,10 @@ int nrf_cloud_init(const struct nrf_cloud_init_param *param)
 		return err;
 	}
 
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS)
+	connect_stats_init();
+#endif
+
 	m_event_handler = param->event_handler;
 	m_current_state = STATE_INITIALIZED;
 
@@ -87,7 +174,18 @@ int nrf_cloud_connect(const struct nrf_cloud_connect_param *param)
 	if (NOT_VALID_STATE(STATE_INITIALIZED)) {
 		return -EACCES;
 	}
+
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS)
+	int err;
+
+	connect_stats_start();
+	err = nct_connect();
+	m_connect_stats.handshake_done = k_uptime_get_32();
+
+	return err;
+#else
 	return nct_connect();
+#endif
 }
 
 int nrf_cloud_disconnect(void)
@@ -191,6 +289,50 @@ int nrf_cloud_sensor_data_stream(const struct nrf_cloud_sensor_data *param)
 	return err;
 }
 
+int nrf_cloud_topic_handler_register(const struct nrf_cloud_data *topic,
+				     nrf_cloud_topic_handler_t handler)
+{
+	if (m_current_state != STATE_INITIALIZED) {
+		return -EACCES;
+	}
+
+	return nct_app_topic_register(topic, handler);
+}
+
+#if defined(CONFIG_NRF_CLOUD_CONNECT_STATS)
+int nrf_cloud_connect_stats_get(struct nrf_cloud_connect_stats *stats)
+{
+	const u32_t *t = m_connect_stats.state_time;
+	u32_t ua_done;
+
+	if (stats == NULL) {
+		return -EINVAL;
+	}
+
+	/* With fast resume, the data channel is subscribed directly after
+	 * the control channel, without user association confirmation.
+	 */
+	ua_done = (t[STATE_UA_COMPLETE] != 0) ?
+		  t[STATE_UA_COMPLETE] : t[STATE_CC_CONNECTED];
+
+	stats->connect_count = m_connect_stats.connect_count;
+	stats->resume_count = m_connect_stats.resume_count;
+	stats->handshake_ms = connect_stats_elapsed(
+		m_connect_stats.connect_start, m_connect_stats.handshake_done);
+	stats->transport_ms = connect_stats_elapsed(
+		m_connect_stats.connect_start, t[STATE_CONNECTED]);
+	stats->cc_ms = connect_stats_elapsed(t[STATE_CONNECTED],
+					     t[STATE_CC_CONNECTED]);
+	stats->ua_ms = connect_stats_elapsed(t[STATE_CC_CONNECTED],
+					     t[STATE_UA_COMPLETE]);
+	stats->dc_ms = connect_stats_elapsed(ua_done, t[STATE_DC_CONNECTED]);
+	stats->total_ms = connect_stats_elapsed(m_connect_stats.connect_start,
+						t[STATE_DC_CONNECTED]);
+
+	return 0;
+}
+#endif /* defined(CONFIG_NRF_CLOUD_CONNECT_STATS) */
+
 int nct_input(const struct nct_evt *evt)
 {
 	return nfsm_handle_incoming_event(evt, m_current_state);
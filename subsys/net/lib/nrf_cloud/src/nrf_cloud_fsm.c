@@ -28,6 +28,11 @@ LOG_MODULE_REGISTER(nrf_cloud_fsm, CONFIG_NRF_CLOUD_LOG_LEVEL);
  */
 #define PAIRING_STATUS_REPORT_ID 7890
 
+/**@brief Identifier for cloud state request sent when resuming a connection.
+ * Can be any unique unsigned 16-bit integer value except zero.
+ */
+#define RESUME_STATE_REQ_ID 5679
+
 /**@brief Default message identifier.
  * Can be any unique unsigned 16-bit integer value except zero.
  */
@@ -269,6 +274,11 @@ static int state_ua_initiate(void)
 		.id = INITIATE_STATUS_REPORT_ID,
 	};
 
+	/* The cached data channel endpoint is no longer valid. */
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_FAST_RESUME)) {
+		nct_dc_endpoint_invalidate();
+	}
+
 	/* Publish report to the cloud on current status. */
 	err = nrf_cloud_encode_state(STATE_UA_INITIATE, &msg.data);
 	if (err) {
@@ -369,6 +379,70 @@ static int state_ua_mismatch(void)
 	return err;
 }
 
+/**@brief Subscribes to the cached data channel endpoint right after the
+ * control channel, skipping the user association report. The shadow is
+ * requested in the background to validate the cached endpoint.
+ */
+static int state_fast_resume(void)
+{
+	static const struct nct_cc_data get_request = {
+		.opcode = NCT_CC_OPCODE_GET_REQ,
+		.id = RESUME_STATE_REQ_ID,
+	};
+
+	int err;
+	const struct nrf_cloud_evt evt = {
+		.type = NRF_CLOUD_EVT_USER_ASSOCIATED,
+	};
+
+	err = nct_dc_connect();
+	if (err) {
+		return err;
+	}
+
+	nfsm_set_current_state_and_notify(STATE_DC_CONNECTING, &evt);
+
+	return nct_cc_send(&get_request);
+}
+
+/**@brief Compares the data channel endpoint in the shadow with the one in
+ * use. If it has changed, the new endpoint is stored and the connection is
+ * re-established.
+ */
+static int dc_endpoint_validate(const struct nrf_cloud_data *payload)
+{
+	int err;
+	struct nrf_cloud_data rx;
+	struct nrf_cloud_data tx;
+	struct nrf_cloud_data cur_rx;
+	struct nrf_cloud_data cur_tx;
+
+	err = nrf_cloud_decode_data_endpoint(payload, &tx, &rx);
+	if (err) {
+		/* No endpoint information in the message. */
+		return 0;
+	}
+
+	nct_dc_endpoint_get(&cur_tx, &cur_rx);
+
+	if ((tx.len == cur_tx.len) && (rx.len == cur_rx.len) &&
+	    (memcmp(tx.ptr, cur_tx.ptr, tx.len) == 0) &&
+	    (memcmp(rx.ptr, cur_rx.ptr, rx.len) == 0)) {
+		nrf_cloud_free((void *)tx.ptr);
+		nrf_cloud_free((void *)rx.ptr);
+		return 0;
+	}
+
+	LOG_DBG("Data channel endpoint changed, reconnecting");
+
+	nct_dc_endpoint_set(&tx, &rx);
+
+	/* Disconnect the link. Must connect back. */
+	(void) nct_disconnect();
+
+	return 0;
+}
+
 static int drop_event_handler(const struct nct_evt *nct_evt)
 {
 	LOG_DBG("Dropping FSM transition %d", nct_evt->type);
@@ -439,6 +513,21 @@ static int cc_connection_handler(const struct nct_evt *nct_evt)
 
 	nfsm_set_current_state_and_notify(STATE_CC_CONNECTED, NULL);
 
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_FAST_RESUME)) {
+		struct nrf_cloud_data rx;
+		struct nrf_cloud_data tx;
+
+		nct_dc_endpoint_get(&tx, &rx);
+		if (tx.ptr != NULL) {
+			err = state_fast_resume();
+			if (err) {
+				nfsm_set_current_state_and_notify(
+					STATE_CONNECTED, &evt);
+			}
+			return err;
+		}
+	}
+
 	/* Request the shadow state now. */
 	err = nct_cc_send(&get_request);
 	if (err) {
@@ -590,6 +679,11 @@ static int initiate_cmd_in_dc_conn_handler(const struct nct_evt *nct_evt)
 		return err;
 	}
 
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_FAST_RESUME) &&
+	    (expected_state == STATE_UA_COMPLETE)) {
+		return dc_endpoint_validate(payload);
+	}
+
 	/* Validate expected state and take appropriate action. */
 	if (expected_state == STATE_UA_INITIATE) {
 		/* Disconnect data channel to stop further data transfer. */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <shell/shell.h>
+#include <nrf_cloud.h>
+
+static int show_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct nrf_cloud_connect_stats stats;
+	int err;
+
+	err = nrf_cloud_connect_stats_get(&stats);
+	if (err) {
+		shell_error(shell, "Failed to get statistics: %d", err);
+		return err;
+	}
+
+	shell_fprintf(shell, SHELL_NORMAL,
+		      "Connections: %u (resumed: %u)\n",
+		      stats.connect_count, stats.resume_count);
+	shell_fprintf(shell, SHELL_NORMAL,
+		      "Last connection:\n"
+		      "|\thandshake:\t%u ms\n"
+		      "|\ttransport:\t%u ms\n"
+		      "|\tcontrol channel:\t%u ms\n"
+		      "|\tuser association:\t%u ms\n"
+		      "|\tdata channel:\t%u ms\n"
+		      "|\ttotal:\t\t%u ms\n",
+		      stats.handshake_ms, stats.transport_ms, stats.cc_ms,
+		      stats.ua_ms, stats.dc_ms, stats.total_ms);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_nrf_cloud,
+	SHELL_CMD_ARG(stats, NULL, "Show connection establishment statistics",
+		      show_stats, 0, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(nrf_cloud, &sub_nrf_cloud, "nRF Cloud commands", NULL);
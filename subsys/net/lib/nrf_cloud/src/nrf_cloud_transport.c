@@ -74,13 +74,54 @@ static char shadow_get_topic[NCT_SHADOW_GET_LEN + 1];
 #define NCT_CC_SUBSCRIBE_ID 1234
 #define NCT_DC_SUBSCRIBE_ID 8765
 
-#define NCT_RX_LIST 0
-#define NCT_TX_LIST 1
+/* Number of control channel topics subscribed to. */
+#define NCT_CC_RX_TOPIC_COUNT 3
+
+/* Route table size. Kept at least twice the number of routes so that
+ * probe sequences stay short.
+ */
+#define NCT_ROUTE_SLOTS 16
+#define NCT_ROUTE_SLOT_MASK (NCT_ROUTE_SLOTS - 1)
+#define NCT_ROUTE_HASH_SEED 2166136261U
+#define NCT_ROUTE_HASH_PRIME 16777619U
+
+BUILD_ASSERT_MSG((NCT_CC_RX_TOPIC_COUNT + 1 +
+		  CONFIG_NRF_CLOUD_APP_TOPICS_MAX) * 2 <= NCT_ROUTE_SLOTS,
+		 "Route table too small");
+
+/* Destination of an incoming publish. */
+enum nct_route_type {
+	NCT_ROUTE_NONE,
+	NCT_ROUTE_CC,
+	NCT_ROUTE_DC,
+	NCT_ROUTE_APP,
+};
+
+/* Entry in the route table. */
+struct nct_route {
+	const u8_t *topic;
+	u32_t len;
+	u32_t hash;
+	enum nct_route_type type;
+	/* Opcode map index for control channel routes, registration index
+	 * for application routes.
+	 */
+	u8_t index;
+};
+
+/* Topic registered by the application. */
+struct nct_app_topic {
+	struct nrf_cloud_data topic;
+	nrf_cloud_topic_handler_t handler;
+};
 
 /* Forward declaration of the event handler registered with MQTT. */
 static void nct_mqtt_evt_handler(struct mqtt_client *client,
 				 const struct mqtt_evt *evt);
 
+/* Forward declaration of the route table builder. */
+static void routes_build(void);
+
 /* nrf_cloud transport instance. */
 static struct nct {
 	struct mqtt_sec_config tls_config;
@@ -89,9 +130,14 @@ static struct nct {
 	struct mqtt_utf8 dc_tx_endp;
 	struct mqtt_utf8 dc_rx_endp;
 	u32_t message_id;
+	struct nct_route routes[NCT_ROUTE_SLOTS];
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+	struct nct_app_topic app_topics[CONFIG_NRF_CLOUD_APP_TOPICS_MAX];
+	u8_t app_topic_count;
+#endif
 } nct;
 
-static const struct mqtt_topic nct_cc_rx_list[] = {
+static const struct mqtt_topic nct_cc_rx_list[NCT_CC_RX_TOPIC_COUNT] = {
 	{
 		.topic = {
 			.utf8 = accepted_topic,
@@ -132,7 +178,7 @@ static const struct mqtt_topic nct_cc_tx_list[] = {
 	}
 };
 
-static u32_t const nct_cc_rx_opcode_map[] = {
+static u32_t const nct_cc_rx_opcode_map[NCT_CC_RX_TOPIC_COUNT] = {
 	NCT_CC_OPCODE_UPDATE_REQ,
 	NCT_CC_OPCODE_UPDATE_REJECT_RSP,
 	NCT_CC_OPCODE_UPDATE_ACCEPT_RSP
@@ -170,6 +216,7 @@ static void dc_endpoint_free(void)
 		nrf_cloud_free(nct.dc_tx_endp.utf8);
 	}
 	dc_endpoint_reset();
+	routes_build();
 }
 
 static u32_t dc_send(const struct nct_dc_data *dc_data, u8_t qos)
@@ -199,41 +246,115 @@ static u32_t dc_send(const struct nct_dc_data *dc_data, u8_t qos)
 	return mqtt_publish(&nct.client, &publish);
 }
 
-static bool strings_compare(const char *s1, const char *s2,
-			    u32_t s1_len, u32_t s2_len)
+/* FNV-1a hash of a topic, used to index the route table. */
+static u32_t topic_hash(const u8_t *topic, u32_t len)
 {
-	return (strncmp(s1, s2, MIN(s1_len, s2_len))) ? false : true;
+	u32_t hash = NCT_ROUTE_HASH_SEED;
+
+	for (u32_t i = 0; i < len; i++) {
+		hash ^= topic[i];
+		hash *= NCT_ROUTE_HASH_PRIME;
+	}
+
+	return hash;
 }
 
-/* Verify if the topic is a control channel topic or not. */
-static bool control_channel_topic_match(u32_t list_id,
-					const struct mqtt_topic *topic,
-					enum nct_cc_opcode *opcode)
+/* Insert a topic in the route table using linear probing. */
+static int route_add(const u8_t *topic, u32_t len,
+		     enum nct_route_type type, u8_t index)
 {
-	struct mqtt_topic *topic_list;
-	u32_t list_size;
-
-	if (list_id == NCT_RX_LIST) {
-		topic_list = (struct mqtt_topic *)nct_cc_rx_list;
-		list_size = ARRAY_SIZE(nct_cc_rx_list);
-	} else if (list_id == NCT_TX_LIST) {
-		topic_list = (struct mqtt_topic *)nct_cc_tx_list;
-		list_size = ARRAY_SIZE(nct_cc_tx_list);
-	} else {
-		return false;
+	u32_t hash;
+	u32_t slot;
+
+	if ((topic == NULL) || (len == 0)) {
+		return -EINVAL;
 	}
 
-	for (u32_t index = 0; index < list_size; index++) {
-		if (strings_compare(
-			    topic->topic.utf8,
-			    topic_list[index].topic.utf8,
-			    topic->topic.size,
-			    topic_list[index].topic.size)) {
-			*opcode = nct_cc_rx_opcode_map[index];
-			return true;
+	hash = topic_hash(topic, len);
+	slot = hash & NCT_ROUTE_SLOT_MASK;
+
+	for (u32_t i = 0; i < NCT_ROUTE_SLOTS; i++) {
+		struct nct_route *route = &nct.routes[slot];
+
+		if (route->type == NCT_ROUTE_NONE) {
+			route->topic = topic;
+			route->len = len;
+			route->hash = hash;
+			route->type = type;
+			route->index = index;
+			return 0;
+		}
+
+		if ((route->hash == hash) && (route->len == len) &&
+		    (memcmp(route->topic, topic, len) == 0)) {
+			return -EALREADY;
 		}
+
+		slot = (slot + 1) & NCT_ROUTE_SLOT_MASK;
 	}
-	return false;
+
+	return -ENOMEM;
+}
+
+/* (Re)build the route table from the control channel topics, the data
+ * channel endpoint and the topics registered by the application.
+ */
+static void routes_build(void)
+{
+	int err;
+
+	memset(nct.routes, 0, sizeof(nct.routes));
+
+	for (u8_t i = 0; i < ARRAY_SIZE(nct_cc_rx_list); i++) {
+		err = route_add(nct_cc_rx_list[i].topic.utf8,
+				nct_cc_rx_list[i].topic.size,
+				NCT_ROUTE_CC, i);
+		__ASSERT_NO_MSG(err == 0);
+	}
+
+	if (nct.dc_rx_endp.utf8 != NULL) {
+		err = route_add(nct.dc_rx_endp.utf8, nct.dc_rx_endp.size,
+				NCT_ROUTE_DC, 0);
+		if (err) {
+			LOG_WRN("Data channel route not added, err %d", err);
+		}
+	}
+
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+	for (u8_t i = 0; i < nct.app_topic_count; i++) {
+		err = route_add(nct.app_topics[i].topic.ptr,
+				nct.app_topics[i].topic.len,
+				NCT_ROUTE_APP, i);
+		if (err) {
+			LOG_WRN("Application route %d not added, err %d",
+				i, err);
+		}
+	}
+#endif
+}
+
+/* Find the route of an incoming topic. Returns NULL if not found. */
+static const struct nct_route *route_find(const struct mqtt_utf8 *topic)
+{
+	u32_t hash = topic_hash(topic->utf8, topic->size);
+	u32_t slot = hash & NCT_ROUTE_SLOT_MASK;
+
+	for (u32_t i = 0; i < NCT_ROUTE_SLOTS; i++) {
+		const struct nct_route *route = &nct.routes[slot];
+
+		if (route->type == NCT_ROUTE_NONE) {
+			break;
+		}
+
+		if ((route->hash == hash) && (route->len == topic->size) &&
+		    (memcmp(route->topic, topic->utf8, topic->size) == 0)) {
+			return route;
+		}
+
+		slot = (slot + 1) & NCT_ROUTE_SLOT_MASK;
+	}
+
+	return NULL;
 }
 
 /* Function to get the client id */
@@ -324,6 +445,8 @@ static int nct_topics_populate(void)
 	}
 	LOG_DBG("shadow_get_topic: %s", shadow_get_topic);
 
+	routes_build();
+
 	return 0;
 }
 
@@ -471,17 +594,16 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 	}
 	case MQTT_EVT_PUBLISH: {
 		const struct mqtt_publish_param *p = &_mqtt_evt->param.publish;
+		const struct nct_route *route;
 
 		LOG_DBG("MQTT_EVT_PUBLISH: id=%d len=%d ",
 			p->message_id,
 			p->message.payload.len);
 
-		/* If the data arrives on one of the subscribed control channel
-		 * topic. Then we notify the same.
-		 */
-		if (control_channel_topic_match(
-			NCT_RX_LIST, &p->message.topic, &cc.opcode)) {
+		route = route_find(&p->message.topic.topic);
 
+		if ((route != NULL) && (route->type == NCT_ROUTE_CC)) {
+			cc.opcode = nct_cc_rx_opcode_map[route->index];
 			cc.id = p->message_id;
 			cc.data.ptr = p->message.payload.data;
 			cc.data.len = p->message.payload.len;
@@ -489,8 +611,22 @@ static void nct_mqtt_evt_handler(struct mqtt_client *const mqtt_client,
 			evt.type = NCT_EVT_CC_RX_DATA;
 			evt.param.cc = &cc;
 			event_notify = true;
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+		} else if ((route != NULL) && (route->type == NCT_ROUTE_APP)) {
+			const struct nct_app_topic *app =
+				&nct.app_topics[route->index];
+			const struct nrf_cloud_data payload = {
+				.ptr = p->message.payload.data,
+				.len = p->message.payload.len
+			};
+
+			app->handler(&app->topic, &payload);
+#endif
 		} else {
-			/* Try to match it with one of the data topics. */
+			/* Data channel topic. Topics without a route are
+			 * also delivered here, as the data channel endpoint
+			 * may be a wildcard subscription.
+			 */
 			dc.id = p->message_id;
 			dc.data.ptr = p->message.payload.data;
 			dc.data.len = p->message.payload.len;
@@ -788,6 +924,8 @@ void nct_dc_endpoint_set(const struct nrf_cloud_data *tx_endp,
 
 	nct.dc_rx_endp.utf8 = (u8_t *)rx_endp->ptr;
 	nct.dc_rx_endp.size = rx_endp->len;
+
+	routes_build();
 }
 
 void nct_dc_endpoint_get(struct nrf_cloud_data *const tx_endp,
@@ -802,21 +940,46 @@ void nct_dc_endpoint_get(struct nrf_cloud_data *const tx_endp,
 	rx_endp->len = nct.dc_rx_endp.size;
 }
 
+/* Populate the data channel subscription list: the data channel endpoint
+ * followed by the topics registered by the application.
+ */
+static u32_t dc_topics_get(struct mqtt_topic *list)
+{
+	u32_t count = 0;
+
+	list[count].topic.utf8 = nct.dc_rx_endp.utf8;
+	list[count].topic.size = nct.dc_rx_endp.size;
+	list[count].qos = MQTT_QOS_1_AT_LEAST_ONCE;
+	count++;
+
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+	for (u8_t i = 0; i < nct.app_topic_count; i++) {
+		list[count].topic.utf8 = (u8_t *)nct.app_topics[i].topic.ptr;
+		list[count].topic.size = nct.app_topics[i].topic.len;
+		list[count].qos = MQTT_QOS_1_AT_LEAST_ONCE;
+		count++;
+	}
+#endif
+
+	return count;
+}
+
+void nct_dc_endpoint_invalidate(void)
+{
+	LOG_DBG("nct_dc_endpoint_invalidate");
+
+	dc_endpoint_free();
+}
+
 int nct_dc_connect(void)
 {
 	LOG_DBG("nct_dc_connect");
 
-	struct mqtt_topic subscribe_topic = {
-		.topic = {
-			.utf8 = nct.dc_rx_endp.utf8,
-			.size = nct.dc_rx_endp.size
-		},
-		.qos = MQTT_QOS_1_AT_LEAST_ONCE
-	};
+	struct mqtt_topic subscribe_topics[1 + CONFIG_NRF_CLOUD_APP_TOPICS_MAX];
 
 	const struct mqtt_subscription_list subscription_list = {
-		.list = &subscribe_topic,
-		.list_count = 1,
+		.list = subscribe_topics,
+		.list_count = dc_topics_get(subscribe_topics),
 		.message_id = NCT_DC_SUBSCRIBE_ID
 	};
 
@@ -837,20 +1000,64 @@ int nct_dc_disconnect(void)
 {
 	LOG_DBG("nct_dc_disconnect");
 
+	struct mqtt_topic subscribe_topics[1 + CONFIG_NRF_CLOUD_APP_TOPICS_MAX];
+
 	const struct mqtt_subscription_list subscription_list = {
-		.list = (struct mqtt_topic *)&nct.dc_rx_endp,
-		.list_count = 1,
+		.list = subscribe_topics,
+		.list_count = dc_topics_get(subscribe_topics),
 		.message_id = NCT_DC_SUBSCRIBE_ID
 	};
 
 	return mqtt_unsubscribe(&nct.client, &subscription_list);
 }
 
+int nct_app_topic_register(const struct nrf_cloud_data *topic,
+			   nrf_cloud_topic_handler_t handler)
+{
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+	struct nct_app_topic *app;
+#endif
+
+	if ((topic == NULL) || (topic->ptr == NULL) || (topic->len == 0) ||
+	    (handler == NULL)) {
+		return -EINVAL;
+	}
+
+#if CONFIG_NRF_CLOUD_APP_TOPICS_MAX > 0
+	if (nct.app_topic_count >= CONFIG_NRF_CLOUD_APP_TOPICS_MAX) {
+		return -ENOMEM;
+	}
+
+	for (u8_t i = 0; i < nct.app_topic_count; i++) {
+		app = &nct.app_topics[i];
+
+		if ((app->topic.len == topic->len) &&
+		    (memcmp(app->topic.ptr, topic->ptr, topic->len) == 0)) {
+			return -EALREADY;
+		}
+	}
+
+	app = &nct.app_topics[nct.app_topic_count++];
+	app->topic = *topic;
+	app->handler = handler;
+
+	routes_build();
+
+	return 0;
+#else
+	return -ENOMEM;
+#endif
+}
+
 int nct_disconnect(void)
 {
 	LOG_DBG("nct_disconnect");
 
-	dc_endpoint_free();
+	/* With fast resume, the endpoint is kept for the next connection. */
+	if (!IS_ENABLED(CONFIG_NRF_CLOUD_FAST_RESUME)) {
+		dc_endpoint_free();
+	}
+
 	return mqtt_disconnect(&nct.client);
 }
 
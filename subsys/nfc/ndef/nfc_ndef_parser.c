@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <nfc/ndef/nfc_ndef_parser.h>
+#include <nfc/ndef/nfc_ndef_msg.h>
+#include <misc/byteorder.h>
+#include <misc/util.h>
+
+/** Mask of the CF flag, set in all chunks of a payload but the last. */
+#define NDEF_RECORD_CF_MASK 0x20
+
+int nfc_ndef_parser_init(struct nfc_ndef_parser *parser,
+			 u8_t const *msg_buffer,
+			 u32_t msg_len)
+{
+	if (!parser || (!msg_buffer && msg_len)) {
+		return -EINVAL;
+	}
+
+	parser->buffer = msg_buffer;
+	parser->length = msg_len;
+	parser->offset = 0;
+	parser->chunk_pending = false;
+	parser->message_end = false;
+
+	if (IS_ENABLED(CONFIG_NFC_NDEF_MSG_WITH_NLEN)) {
+		u32_t nlen;
+
+		if (msg_len < NLEN_FIELD_SIZE) {
+			parser->message_end = true;
+			return -EBADMSG;
+		}
+
+		nlen = sys_get_be16(msg_buffer);
+		if (nlen > msg_len - NLEN_FIELD_SIZE) {
+			parser->message_end = true;
+			return -EBADMSG;
+		}
+
+		parser->offset = NLEN_FIELD_SIZE;
+		parser->length = NLEN_FIELD_SIZE + nlen;
+	}
+
+	parser->start = parser->offset;
+
+	return 0;
+}
+
+/* Check the flags and type fields of a record against the NDEF rules for
+ * message boundaries and chunks.
+ */
+static bool record_valid(struct nfc_ndef_parser const *parser,
+			 u8_t flags,
+			 struct nfc_ndef_parsed_record const *record)
+{
+	bool first = (parser->offset == parser->start);
+	bool message_begin = (flags & NDEF_FIRST_RECORD) == NDEF_FIRST_RECORD;
+	bool message_end = (flags & NDEF_LAST_RECORD) == NDEF_LAST_RECORD;
+
+	if (message_begin != first) {
+		return false;
+	}
+
+	if (parser->chunk_pending) {
+		/* Chunks after the first one carry only payload. */
+		if (record->tnf != TNF_UNCHANGED ||
+		    record->type_length || record->id_length) {
+			return false;
+		}
+	} else if (record->tnf == TNF_UNCHANGED) {
+		return false;
+	}
+
+	/* The message cannot end in the middle of a chunked payload. */
+	if (record->chunked && message_end) {
+		return false;
+	}
+
+	if (record->tnf == TNF_EMPTY &&
+	    (record->type_length || record->id_length ||
+	     record->payload_length)) {
+		return false;
+	}
+
+	return true;
+}
+
+int nfc_ndef_parser_next(struct nfc_ndef_parser *parser,
+			 struct nfc_ndef_parsed_record *record)
+{
+	u8_t const *buffer;
+	u32_t remaining;
+	u32_t header_len;
+	u8_t flags;
+
+	if (!parser || !record) {
+		return -EINVAL;
+	}
+
+	if (parser->message_end) {
+		return -ENOENT;
+	}
+
+	buffer = &parser->buffer[parser->offset];
+	remaining = parser->length - parser->offset;
+
+	/* TNF-flags, Type Length, and the short Payload Length field. */
+	header_len = 2 + NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+	if (remaining < header_len) {
+		goto malformed;
+	}
+
+	flags = buffer[0];
+	record->tnf = flags & NDEF_RECORD_TNF_MASK;
+	record->location = flags & NDEF_RECORD_LOCATION_MASK;
+	record->chunked = (flags & NDEF_RECORD_CF_MASK) != 0;
+	record->type_length = buffer[1];
+
+	if (flags & NDEF_RECORD_SR_MASK) {
+		record->payload_length = buffer[2];
+	} else {
+		header_len += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE -
+			      NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+		if (remaining < header_len) {
+			goto malformed;
+		}
+		record->payload_length = sys_get_be32(&buffer[2]);
+	}
+
+	if (flags & NDEF_RECORD_IL_MASK) {
+		if (remaining < header_len + NDEF_RECORD_ID_LEN_SIZE) {
+			goto malformed;
+		}
+		record->id_length = buffer[header_len];
+		header_len += NDEF_RECORD_ID_LEN_SIZE;
+	} else {
+		record->id_length = 0;
+	}
+
+	/* The type and ID lengths are at most 255 each, so the sum cannot
+	 * overflow. The payload length is checked separately.
+	 */
+	header_len += record->type_length + record->id_length;
+	if (remaining < header_len ||
+	    record->payload_length > remaining - header_len) {
+		goto malformed;
+	}
+
+	if (!record_valid(parser, flags, record)) {
+		goto malformed;
+	}
+
+	record->type = &buffer[header_len - record->id_length -
+			       record->type_length];
+	record->id = &buffer[header_len - record->id_length];
+	record->payload = &buffer[header_len];
+
+	parser->offset += header_len + record->payload_length;
+	parser->chunk_pending = record->chunked;
+	parser->message_end =
+		(flags & NDEF_LAST_RECORD) == NDEF_LAST_RECORD;
+
+	return 0;
+
+malformed:
+	/* Do not parse past a malformed record. */
+	parser->message_end = true;
+	return -EBADMSG;
+}
+
+bool nfc_ndef_parsed_record_type_match(
+			struct nfc_ndef_parsed_record const *record,
+			enum nfc_ndef_record_tnf tnf,
+			u8_t const *type,
+			u8_t type_length)
+{
+	return (record->tnf == tnf) &&
+	       (record->type_length == type_length) &&
+	       !memcmp(record->type, type, type_length);
+}
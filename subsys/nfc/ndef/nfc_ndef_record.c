@@ -5,25 +5,34 @@
  */
 
 #include <string.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <nfc/ndef/nfc_ndef_record.h>
 #include <misc/byteorder.h>
 
-/* Sum of sizes of fields: TNF-flags, Type Length, Payload Length in long
- * NDEF record.
- */
-#define NDEF_RECORD_BASE_LONG_SIZE (2 + NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE)
+/* Sum of sizes of fields: TNF-flags, Type Length. */
+#define NDEF_RECORD_BASE_SIZE 2
+
+/* Largest payload that fits in a short NDEF record. */
+#define NDEF_RECORD_SHORT_PAYLOAD_MAX UINT8_MAX
 
 static u32_t record_header_size_calc(
-			struct nfc_ndef_record_desc const *ndef_record_desc)
+			struct nfc_ndef_record_desc const *ndef_record_desc,
+			bool short_record)
 {
 	u32_t len;
 
-	len = NDEF_RECORD_BASE_LONG_SIZE + ndef_record_desc->id_length +
+	len = NDEF_RECORD_BASE_SIZE + ndef_record_desc->id_length +
 			ndef_record_desc->type_length;
 
+	if (short_record) {
+		len += NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+	} else {
+		len += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE;
+	}
+
 	if (ndef_record_desc->id_length > 0) {
-		len++;
+		len += NDEF_RECORD_ID_LEN_SIZE;
 	}
 
 	return len;
@@ -34,85 +43,113 @@ int nfc_ndef_record_encode(struct nfc_ndef_record_desc const *ndef_record_desc,
 			   u8_t *record_buffer,
 			   u32_t *record_len)
 {
-	u8_t *payload_len = NULL; /* use as pointer to payload length field */
+	u8_t *flags; /* use as pointer to TNF + flags field */
+	u8_t *payload; /* use as pointer to payload field */
 	u32_t record_payload_len;
+	u32_t record_header_len;
+	bool short_record;
+	int err;
 
-	if (!ndef_record_desc) {
+	if (!ndef_record_desc || !ndef_record_desc->payload_constructor) {
 		return -EINVAL;
 	}
-	/* count record length without payload */
-	u32_t record_header_len = record_header_size_calc(ndef_record_desc);
-
-	if (record_buffer) {
-		u8_t *flags; /* use as pointer to TNF + flags field */
 
-		/* verify location range */
-		if (record_location & (~NDEF_RECORD_LOCATION_MASK)) {
-			return -EINVAL;
-		}
-		/* verify if there is enough available memory */
-		if (record_header_len > *record_len) {
-			return -ENOSR;
+	if (!record_buffer) {
+		record_payload_len = UINT32_MAX;
+		err = ndef_record_desc->payload_constructor(
+					ndef_record_desc->payload_descriptor,
+					NULL,
+					&record_payload_len);
+		if (err) {
+			return err;
 		}
 
-		flags = record_buffer;
-		record_buffer++;
+		short_record =
+			(record_payload_len <= NDEF_RECORD_SHORT_PAYLOAD_MAX);
+		*record_len = record_header_size_calc(ndef_record_desc,
+						      short_record) +
+			      record_payload_len;
+		return 0;
+	}
 
-		/* set location bits and clear other bits in 1st byte. */
-		*flags = record_location;
-		*flags |= ndef_record_desc->tnf;
+	/* verify location range */
+	if (record_location & (~NDEF_RECORD_LOCATION_MASK)) {
+		return -EINVAL;
+	}
 
-		/* TYPE LENGTH */
-		*record_buffer = ndef_record_desc->type_length;
-		record_buffer++;
-		/* use always long record and remember payload len field memory
-		 * offset.
-		 */
-		payload_len = record_buffer;
-		record_buffer += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE;
-		/* ID LENGTH - option */
-		if (ndef_record_desc->id_length > 0) {
-			*record_buffer = ndef_record_desc->id_length;
-			record_buffer++;
-			/* IL flag */
-			*flags |= NDEF_RECORD_IL_MASK;
-		}
-		/* TYPE */
-		memcpy(record_buffer,
-		       ndef_record_desc->type,
-		       ndef_record_desc->type_length);
-		record_buffer += ndef_record_desc->type_length;
-		/* ID */
-		if (ndef_record_desc->id_length > 0) {
-			memcpy(record_buffer,
-			       ndef_record_desc->id,
-			       ndef_record_desc->id_length);
-			record_buffer += ndef_record_desc->id_length;
-		}
-		/* count how much memory is left in record buffer for payload
-		 * field.
-		 */
-		record_payload_len = (*record_len - record_header_len);
+	/* Construct the payload behind a short record header, so that the
+	 * constructor runs only once. The payload size it returns decides the
+	 * record format, and a payload too long for a short record is moved
+	 * behind the longer Payload Length field afterwards.
+	 */
+	record_header_len = record_header_size_calc(ndef_record_desc, true);
+	if (record_header_len > *record_len) {
+		return -ENOSR;
 	}
-	/* PAYLOAD */
-	if (ndef_record_desc->payload_constructor) {
-		int err;
 
-		err = ndef_record_desc->payload_constructor(
-					ndef_record_desc->payload_descriptor,
-					record_buffer,
-					&record_payload_len);
+	payload = record_buffer + record_header_len;
+	record_payload_len = *record_len - record_header_len;
 
-		if (err) {
-			return err;
+	err = ndef_record_desc->payload_constructor(
+				ndef_record_desc->payload_descriptor,
+				payload,
+				&record_payload_len);
+	if (err) {
+		return err;
+	}
+
+	short_record = (record_payload_len <= NDEF_RECORD_SHORT_PAYLOAD_MAX);
+	if (!short_record) {
+		u32_t shift = NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE -
+			      NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+
+		/* verify if there is enough available memory */
+		if (record_header_len + shift + record_payload_len >
+		    *record_len) {
+			return -ENOSR;
 		}
-	} else {
-		return -EINVAL;
+
+		memmove(payload + shift, payload, record_payload_len);
+		record_header_len += shift;
 	}
 
-	if (record_buffer) {
-		/* PAYLOAD LENGTH */
-		*(u32_t *)payload_len = sys_cpu_to_be32(record_payload_len);
+	flags = record_buffer;
+	record_buffer++;
+
+	/* set location bits and clear other bits in 1st byte. */
+	*flags = record_location;
+	*flags |= ndef_record_desc->tnf;
+
+	/* TYPE LENGTH */
+	*record_buffer = ndef_record_desc->type_length;
+	record_buffer++;
+	/* PAYLOAD LENGTH */
+	if (short_record) {
+		*record_buffer = record_payload_len;
+		record_buffer += NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+		/* SR flag */
+		*flags |= NDEF_RECORD_SR_MASK;
+	} else {
+		sys_put_be32(record_payload_len, record_buffer);
+		record_buffer += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE;
+	}
+	/* ID LENGTH - option */
+	if (ndef_record_desc->id_length > 0) {
+		*record_buffer = ndef_record_desc->id_length;
+		record_buffer++;
+		/* IL flag */
+		*flags |= NDEF_RECORD_IL_MASK;
+	}
+	/* TYPE */
+	memcpy(record_buffer,
+	       ndef_record_desc->type,
+	       ndef_record_desc->type_length);
+	record_buffer += ndef_record_desc->type_length;
+	/* ID */
+	if (ndef_record_desc->id_length > 0) {
+		memcpy(record_buffer,
+		       ndef_record_desc->id,
+		       ndef_record_desc->id_length);
 	}
 
 	*record_len = record_header_len + record_payload_len;
@@ -69,3 +69,51 @@ int nfc_text_rec_payload_constructor(
 
 	return 0;
 }
+
+#ifdef CONFIG_NFC_NDEF_PARSER
+int nfc_text_rec_parse(struct nfc_ndef_parsed_record const *record,
+		struct nfc_text_rec_payload_desc *nfc_rec_text_payload_desc)
+{
+	u8_t status;
+	u8_t lang_code_len;
+
+	if (!record || !nfc_rec_text_payload_desc) {
+		return -EINVAL;
+	}
+
+	if (!nfc_ndef_parsed_record_type_match(record, TNF_WELL_KNOWN,
+					       nfc_text_rec_type_field,
+					       NFC_TEXT_REC_TYPE_LENGTH)) {
+		return -EINVAL;
+	}
+
+	if (record->chunked) {
+		return -ENOTSUP;
+	}
+
+	if (record->payload_length < TEXT_REC_STATUS_SIZE) {
+		return -EBADMSG;
+	}
+
+	status = record->payload[0];
+	lang_code_len = status & ~(BIT(TEXT_REC_STATUS_UTF_POS) |
+				   BIT(TEXT_REC_RESERVED_POS));
+
+	if ((status & BIT(TEXT_REC_RESERVED_POS)) || !lang_code_len ||
+	    lang_code_len > record->payload_length - TEXT_REC_STATUS_SIZE) {
+		return -EBADMSG;
+	}
+
+	nfc_rec_text_payload_desc->utf =
+		(status & BIT(TEXT_REC_STATUS_UTF_POS)) ? UTF_16 : UTF_8;
+	nfc_rec_text_payload_desc->lang_code =
+		&record->payload[TEXT_REC_STATUS_SIZE];
+	nfc_rec_text_payload_desc->lang_code_len = lang_code_len;
+	nfc_rec_text_payload_desc->data =
+		&record->payload[TEXT_REC_STATUS_SIZE + lang_code_len];
+	nfc_rec_text_payload_desc->data_len =
+		record->payload_length - TEXT_REC_STATUS_SIZE - lang_code_len;
+
+	return 0;
+}
+#endif /* CONFIG_NFC_NDEF_PARSER */
@@ -46,3 +46,34 @@ int nfc_uri_payload_constructor(struct uri_payload_desc *input,
 
 	return 0;
 }
+
+#ifdef CONFIG_NFC_NDEF_PARSER
+int nfc_uri_rec_parse(struct nfc_ndef_parsed_record const *record,
+		      struct uri_payload_desc *output)
+{
+	if (!record || !output) {
+		return -EINVAL;
+	}
+
+	if (!nfc_ndef_parsed_record_type_match(record, TNF_WELL_KNOWN,
+					       &ndef_uri_record_type,
+					       sizeof(ndef_uri_record_type))) {
+		return -EINVAL;
+	}
+
+	if (record->chunked) {
+		return -ENOTSUP;
+	}
+
+	/* The payload starts with the URI identifier code. */
+	if (record->payload_length < 1) {
+		return -EBADMSG;
+	}
+
+	output->uri_id_code = record->payload[0];
+	output->uri_data = &record->payload[1];
+	output->uri_data_len = record->payload_length - 1;
+
+	return 0;
+}
+#endif /* CONFIG_NFC_NDEF_PARSER */
@@ -5,6 +5,8 @@
  */
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
+#include <bluetooth/conn.h>
 #include <bluetooth/gatt.h>
 #include <bluetooth/uuid.h>
 #include <kernel.h>
@@ -13,19 +15,54 @@
 
 
 /* Settings of the discover mock */
-static struct bt_discover_mock {
+static struct {
 	const struct bt_gatt_attr *attr;
 	size_t len;
+} discover_mock_data;
+
+/* Discovery requests, one per connection, so that discoveries on different
+ * connections can run at the same time.
+ */
+static struct bt_discover_mock {
 	struct bt_conn *conn;
 	struct bt_gatt_discover_params *params;
 	struct k_delayed_work work;
-} discover_mock_data;
+} discover_mock_req[CONFIG_BT_MAX_CONN];
+
+/* Number of bt_gatt_discover calls since the setup */
+static size_t discover_mock_calls;
 
 
 void bt_gatt_discover_mock_setup(const struct bt_gatt_attr *attr, size_t len)
 {
 	discover_mock_data.attr = attr;
 	discover_mock_data.len  = len;
+
+	for (size_t i = 0; i < ARRAY_SIZE(discover_mock_req); i++) {
+		discover_mock_req[i].conn = NULL;
+	}
+	discover_mock_calls = 0;
+}
+
+size_t bt_gatt_discover_mock_call_cnt(void)
+{
+	return discover_mock_calls;
+}
+
+static struct bt_discover_mock *discover_mock_req_get(struct bt_conn *conn)
+{
+	struct bt_discover_mock *free_req = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(discover_mock_req); i++) {
+		if (discover_mock_req[i].conn == conn) {
+			return &discover_mock_req[i];
+		}
+		if (!free_req && !discover_mock_req[i].conn) {
+			free_req = &discover_mock_req[i];
+		}
+	}
+
+	return free_req;
 }
 
 static bool bt_gatt_primary_check(const struct bt_gatt_attr *attr_cur,
@@ -119,11 +156,44 @@ static void bt_gatt_discover_work(struct k_work *work)
 int bt_gatt_discover(struct bt_conn *conn,
 		     struct bt_gatt_discover_params *params)
 {
+	struct bt_discover_mock *req = discover_mock_req_get(conn);
+
 	printk("Running %s mock\n", __func__);
-	discover_mock_data.conn = conn;
-	discover_mock_data.params = params;
+	zassert_not_null(req, "Too many connections in discovery mock");
+
+	req->conn = conn;
+	req->params = params;
+	discover_mock_calls++;
 
-	k_delayed_work_init(&(discover_mock_data.work), bt_gatt_discover_work);
-	k_delayed_work_submit(&(discover_mock_data.work), K_MSEC(5));
+	k_delayed_work_init(&(req->work), bt_gatt_discover_work);
+	k_delayed_work_submit(&(req->work), K_MSEC(5));
 	return 0;
 }
+
+#if CONFIG_BT_GATT_DM_CACHE
+/* Mocked version of the bt_conn_get_dst, used to key the discovery cache */
+const bt_addr_le_t *bt_conn_get_dst(const struct bt_conn *conn)
+{
+	static const bt_addr_le_t addr = {
+		.type = BT_ADDR_LE_RANDOM,
+		.a.val = { 0x01, 0x02, 0x03, 0x04, 0x05, 0xc6 },
+	};
+
+	return &addr;
+}
+
+/* Mocked version of the bt_conn_get_info, used for the bond check */
+int bt_conn_get_info(const struct bt_conn *conn, struct bt_conn_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	info->id = BT_ID_DEFAULT;
+
+	return 0;
+}
+
+/* Mocked version of the bt_addr_le_is_bonded, the peer is always bonded */
+bool bt_addr_le_is_bonded(u8_t id, const bt_addr_le_t *addr)
+{
+	return true;
+}
+#endif
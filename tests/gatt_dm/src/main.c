@@ -15,7 +15,10 @@
 #define SERVICE_DISCOVERY_TIMEOUT 2000
 
 static char dummy_conn;
+static char dummy_conn_2;
+static char dummy_conn_3;
 K_SEM_DEFINE(discovery_finished, 0, 1);
+K_SEM_DEFINE(concurrent_finished, 0, 2);
 
 
 const struct bt_gatt_attr discover_sim[] = {
@@ -73,9 +76,29 @@ struct bt_gatt_dm_cb test_hids_cb = {
 	.error_found       = test_cb_error_found
 };
 
+void test_cb_concurrent_completed(struct bt_gatt_dm *dm, void *context)
+{
+	printk("%s\n", __func__);
+	*(struct bt_gatt_dm **)context = dm;
+	k_sem_give(&concurrent_finished);
+}
+
+void test_cb_concurrent_not_found(struct bt_conn *conn, void *context)
+{
+	printk("%s\n", __func__);
+	zassert_unreachable("Service not found");
+}
+
+struct bt_gatt_dm_cb test_concurrent_cb = {
+	.completed         = test_cb_concurrent_completed,
+	.service_not_found = test_cb_concurrent_not_found,
+	.error_found       = test_cb_error_found
+};
+
 void test_setup(void)
 {
 	k_sem_reset(&discovery_finished);
+	k_sem_reset(&concurrent_finished);
 	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
 }
 
@@ -301,6 +324,8 @@ void test_gatt_HIDS_next_chrc_access(void)
 	attr_chrc = bt_gatt_dm_char_next(dm, attr_chrc);
 	zassert_is_null(attr_chrc, "Unexpected characteristic detected");
 
+	zassert_true(bt_gatt_dm_arena_peak_get() > 0, "Arena usage not reported");
+
 	bt_gatt_dm_data_release(dm);
 	zassert_equal(0, bt_gatt_dm_attr_cnt(dm), "Parameter count after clearing: %d", bt_gatt_dm_attr_cnt(dm));
 }
@@ -376,6 +401,226 @@ void test_gatt_generic_serv(void)
 	/* No cleanup here - cleanup is done in run_dm_next */
 }
 
+/* Second discovery on the same connection must wait for the first one */
+void test_gatt_same_conn_busy(void)
+{
+	struct bt_gatt_dm *dm;
+	int err;
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn,
+			       BT_UUID_HIDS,
+			       &test_hids_cb,
+			       &dm);
+	zassert_false(err, "bt_gatt_dm_start finished with error: %d", err);
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn,
+			       BT_UUID_DIS,
+			       &test_hids_cb,
+			       &dm);
+	zassert_equal(-EALREADY, err, "Unexpected error: %d", err);
+
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+	zassert_not_null(dm, "Device Manager pointer not set");
+
+	bt_gatt_dm_data_release(dm);
+}
+
+/* Discoveries on two connections run at the same time */
+void test_gatt_concurrent_conns(void)
+{
+	struct bt_gatt_dm *dm_hids = NULL;
+	struct bt_gatt_dm *dm_dis = NULL;
+	const struct bt_gatt_attr *attr;
+	const struct bt_gatt_service_val *serv_val;
+	int err;
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn,
+			       BT_UUID_HIDS,
+			       &test_concurrent_cb,
+			       &dm_hids);
+	zassert_false(err, "bt_gatt_dm_start finished with error: %d", err);
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn_2,
+			       BT_UUID_DIS,
+			       &test_concurrent_cb,
+			       &dm_dis);
+	zassert_false(err, "Second connection discovery failed: %d", err);
+
+	for (int i = 0; i < 2; ++i) {
+		err = k_sem_take(&concurrent_finished,
+				 K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+		zassert_equal(0, err, "Discovery %d did not finish: %d", i, err);
+	}
+
+	zassert_not_null(dm_hids, "HIDS discovery result not set");
+	zassert_not_null(dm_dis, "DIS discovery result not set");
+	zassert_not_equal(dm_hids, dm_dis, "Discoveries share an instance");
+
+	/* HIDS on the first connection */
+	zassert_equal_ptr((struct bt_conn *)&dummy_conn,
+			  bt_gatt_dm_conn_get(dm_hids), "Unexpected conn");
+	serv_val = bt_gatt_dm_attr_service_val(bt_gatt_dm_service_get(dm_hids));
+	zassert_true(!bt_uuid_cmp(BT_UUID_HIDS, serv_val->uuid), "Invalid service detected");
+	zassert_equal(11, bt_gatt_dm_attr_cnt(dm_hids),
+		      "Unexpected number of HIDS attributes: %d",
+		      bt_gatt_dm_attr_cnt(dm_hids));
+	attr = NULL;
+	for (int i = 2; i <= 11; ++i) {
+		attr = bt_gatt_dm_attr_next(dm_hids, attr);
+		zassert_not_null(attr, "Attr handle: %d", i);
+		zassert_equal(i, attr->handle, "Attr handle: %d", i);
+	}
+
+	/* DIS on the second connection */
+	zassert_equal_ptr((struct bt_conn *)&dummy_conn_2,
+			  bt_gatt_dm_conn_get(dm_dis), "Unexpected conn");
+	serv_val = bt_gatt_dm_attr_service_val(bt_gatt_dm_service_get(dm_dis));
+	zassert_true(!bt_uuid_cmp(BT_UUID_DIS, serv_val->uuid), "Invalid service detected");
+	zassert_equal(5, bt_gatt_dm_attr_cnt(dm_dis),
+		      "Unexpected number of DIS attributes: %d",
+		      bt_gatt_dm_attr_cnt(dm_dis));
+	attr = NULL;
+	for (int i = 13; i <= 16; ++i) {
+		attr = bt_gatt_dm_attr_next(dm_dis, attr);
+		zassert_not_null(attr, "Attr handle: %d", i);
+		zassert_equal(i, attr->handle, "Attr handle: %d", i);
+	}
+
+	bt_gatt_dm_data_release(dm_hids);
+	bt_gatt_dm_data_release(dm_dis);
+}
+
+/* Discovery on a third connection fails while all instances are in use */
+void test_gatt_instances_busy(void)
+{
+	struct bt_gatt_dm *dm_hids = NULL;
+	struct bt_gatt_dm *dm_dis = NULL;
+	struct bt_gatt_dm *dm;
+	int err;
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn,
+			       BT_UUID_HIDS,
+			       &test_concurrent_cb,
+			       &dm_hids);
+	zassert_false(err, "bt_gatt_dm_start finished with error: %d", err);
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn_2,
+			       BT_UUID_DIS,
+			       &test_concurrent_cb,
+			       &dm_dis);
+	zassert_false(err, "Second connection discovery failed: %d", err);
+
+	err = bt_gatt_dm_start((struct bt_conn *)&dummy_conn_3,
+			       BT_UUID_DIS,
+			       &test_hids_cb,
+			       &dm);
+	zassert_equal(-ENOMEM, err, "Unexpected error: %d", err);
+
+	for (int i = 0; i < 2; ++i) {
+		err = k_sem_take(&concurrent_finished,
+				 K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+		zassert_equal(0, err, "Discovery %d did not finish: %d", i, err);
+	}
+
+	bt_gatt_dm_data_release(dm_hids);
+	bt_gatt_dm_data_release(dm_dis);
+}
+
+/* Discovery stored to the cache and restored from it */
+void test_gatt_cache(void)
+{
+	static const u8_t db_hash[BT_GATT_DM_DB_HASH_LEN] = { 0x01, 0x02 };
+	static const u8_t db_hash_new[BT_GATT_DM_DB_HASH_LEN] = { 0x03 };
+	struct bt_gatt_dm *dm;
+	int err;
+
+#if CONFIG_BT_GATT_DM_CACHE
+	const struct bt_gatt_attr *attr;
+	const struct bt_gatt_chrc *chrc_val;
+
+	bt_gatt_dm_cache_clear(NULL);
+
+	/* Nothing cached, the service is discovered and stored */
+	err = bt_gatt_dm_start_cached((struct bt_conn *)&dummy_conn,
+				      BT_UUID_HIDS, db_hash,
+				      &test_hids_cb, &dm);
+	zassert_false(err, "bt_gatt_dm_start_cached finished with error: %d", err);
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	zassert_true(bt_gatt_dm_attr_cnt(dm) == 11, "Unexpected number of attributes");
+	zassert_true(bt_gatt_discover_mock_call_cnt() > 0, "Service not discovered");
+	bt_gatt_dm_data_release(dm);
+
+	/* Same peer, service, and hash: restored without discovery */
+	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
+	err = bt_gatt_dm_start_cached((struct bt_conn *)&dummy_conn,
+				      BT_UUID_HIDS, db_hash,
+				      &test_hids_cb, &dm);
+	zassert_false(err, "bt_gatt_dm_start_cached finished with error: %d", err);
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+	zassert_not_null(dm, "Device Manager pointer not set");
+	zassert_equal(0, bt_gatt_discover_mock_call_cnt(),
+		      "Discovery not restored from the cache");
+	zassert_equal(11,
+		      bt_gatt_dm_attr_cnt(dm),
+		      "Unexpected number of attributes restored: %d",
+		      bt_gatt_dm_attr_cnt(dm));
+
+	attr = NULL;
+	for (int i = 2; i <= 11; ++i) {
+		attr = bt_gatt_dm_attr_next(dm, attr);
+		zassert_not_null(attr, "Attr handle: %d", i);
+		zassert_equal(i, attr->handle, "Attr handle: %d", i);
+	}
+	attr = bt_gatt_dm_char_by_uuid(dm, BT_UUID_HIDS_REPORT);
+	zassert_not_null(attr, "Restored characteristic not found");
+	zassert_equal(6, attr->handle, "Unexpected handle: %d", attr->handle);
+	chrc_val = bt_gatt_dm_attr_chrc_val(attr);
+	zassert_not_null(chrc_val, "Restored characteristic value not set");
+	zassert_equal(BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+		      chrc_val->properties,
+		      "Unexpected restored properties");
+	attr = bt_gatt_dm_desc_by_uuid(dm, attr, BT_UUID_GATT_CCC);
+	zassert_not_null(attr, "Restored CCC not found");
+	zassert_equal(8, attr->handle, "Unexpected handle: %d", attr->handle);
+	bt_gatt_dm_data_release(dm);
+
+	/* Changed hash: discovered again */
+	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
+	err = bt_gatt_dm_start_cached((struct bt_conn *)&dummy_conn,
+				      BT_UUID_HIDS, db_hash_new,
+				      &test_hids_cb, &dm);
+	zassert_false(err, "bt_gatt_dm_start_cached finished with error: %d", err);
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+	zassert_true(bt_gatt_discover_mock_call_cnt() > 0,
+		     "Discovery restored with a changed hash");
+	bt_gatt_dm_data_release(dm);
+
+	/* Cleared cache: discovered again */
+	bt_gatt_dm_cache_clear(NULL);
+	bt_gatt_discover_mock_setup(discover_sim, ARRAY_SIZE(discover_sim));
+	err = bt_gatt_dm_start_cached((struct bt_conn *)&dummy_conn,
+				      BT_UUID_HIDS, db_hash_new,
+				      &test_hids_cb, &dm);
+	zassert_false(err, "bt_gatt_dm_start_cached finished with error: %d", err);
+	err = k_sem_take(&discovery_finished, K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+	zassert_equal(0, err, "It seems that no callback function was called: %d", err);
+	zassert_true(bt_gatt_discover_mock_call_cnt() > 0,
+		     "Discovery restored from a cleared cache");
+	bt_gatt_dm_data_release(dm);
+#else
+	err = bt_gatt_dm_start_cached((struct bt_conn *)&dummy_conn,
+				      BT_UUID_HIDS, db_hash,
+				      &test_hids_cb, &dm);
+	zassert_equal(-ENOTSUP, err, "Unexpected error: %d", err);
+	bt_gatt_dm_cache_clear(NULL);
+#endif
+}
+
 void test_main(void)
 {
 	ztest_test_suite(
@@ -387,7 +632,11 @@ void test_main(void)
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_attr_by_handle, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_next_chrc_access, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_chrc_by_uuid, test_setup, unit_test_noop),
-		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop)
+		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_same_conn_busy, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_concurrent_conns, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_instances_busy, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_cache, test_setup, unit_test_noop)
 	);
 
 	ztest_run_test_suite(test_gatt);
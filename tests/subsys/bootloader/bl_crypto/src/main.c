@@ -35,9 +35,37 @@ void test_crypto_root_of_trust(void)
 	zassert_equal(-ESIGINV, retval, "retval was %d", retval);
 }
 
+void test_crypto_root_of_trust_hash(void)
+{
+	u8_t fw_hash[CONFIG_SB_HASH_LEN];
+
+	zassert_true(get_hash(fw_hash, firmware, sizeof(firmware)),
+		     "get_hash failed");
+
+	/* Success. */
+	int retval = crypto_root_of_trust_hash(pk, pk_hash, sig, fw_hash);
+
+	zassert_equal(0, retval, "retval was %d", retval);
+
+	/* pk doesn't match pk_hash. */
+	pk[1]++;
+	retval = crypto_root_of_trust_hash(pk, pk_hash, sig, fw_hash);
+	pk[1]--;
+
+	zassert_equal(-EPKHASHINV, retval, "retval was %d", retval);
+
+	/* hash doesn't match signature */
+	fw_hash[0]++;
+	retval = crypto_root_of_trust_hash(pk, pk_hash, sig, fw_hash);
+	fw_hash[0]--;
+
+	zassert_equal(-ESIGINV, retval, "retval was %d", retval);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(test_bl_crypto,
-			 ztest_unit_test(test_crypto_root_of_trust));
+			 ztest_unit_test(test_crypto_root_of_trust),
+			 ztest_unit_test(test_crypto_root_of_trust_hash));
 	ztest_run_test_suite(test_bl_crypto);
 }
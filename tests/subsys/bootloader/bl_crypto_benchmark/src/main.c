@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <misc/util.h>
+
+#include "bl_crypto.h"
+#include "bl_crypto_internal.h"
+#include "test_vector.c"
+
+/* Each operation is repeated, because the system clock that times it can be
+ * too coarse for a single run.
+ */
+#define REPETITIONS 8
+
+/* Image sizes to hash, in bytes. Sizes above the flash size are skipped. */
+static const u32_t image_sizes[] = {
+	1024, 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024,
+};
+
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC);
+}
+
+static void report(const char *name, u32_t size, u32_t cycles)
+{
+	u32_t us = cycles_to_us(cycles / REPETITIONS);
+
+	printk("bl_crypto benchmark: %s, %u bytes: %u us", name, size, us);
+	if (us > 0) {
+		printk(", %u kB/s", (u32_t)(((u64_t)size * 1000) / us / 1024));
+	}
+	printk("\n");
+}
+
+void test_hash_benchmark(void)
+{
+	/* Hash the flash from its start, like the bootloader hashes the
+	 * image that it boots.
+	 */
+	const u8_t *image = (const u8_t *)CONFIG_FLASH_BASE_ADDRESS;
+	u8_t hash[CONFIG_SB_HASH_LEN];
+
+	for (u32_t i = 0; i < ARRAY_SIZE(image_sizes); i++) {
+		u32_t size = image_sizes[i];
+		u32_t start;
+
+		if (size > CONFIG_FLASH_SIZE * 1024) {
+			break;
+		}
+
+		start = k_cycle_get_32();
+		for (u32_t j = 0; j < REPETITIONS; j++) {
+			zassert_true(get_hash(hash, image, size),
+				     "get_hash failed for %u bytes", size);
+		}
+		report("get_hash", size, k_cycle_get_32() - start);
+	}
+}
+
+void test_sig_benchmark(void)
+{
+	u32_t start;
+	int retval;
+
+	/* The test vector firmware is small, so the time is spent mostly on
+	 * the ECDSA verification.
+	 */
+	start = k_cycle_get_32();
+	for (u32_t i = 0; i < REPETITIONS; i++) {
+		zassert_true(verify_sig(firmware, sizeof(firmware), sig, pk),
+			     "verify_sig failed");
+	}
+	report("verify_sig", sizeof(firmware), k_cycle_get_32() - start);
+
+	start = k_cycle_get_32();
+	for (u32_t i = 0; i < REPETITIONS; i++) {
+		retval = crypto_root_of_trust(pk, pk_hash, sig, firmware,
+					      sizeof(firmware));
+		zassert_equal(0, retval, "retval was %d", retval);
+	}
+	report("crypto_root_of_trust", sizeof(firmware),
+	       k_cycle_get_32() - start);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_bl_crypto_benchmark,
+			 ztest_unit_test(test_hash_benchmark),
+			 ztest_unit_test(test_sig_benchmark));
+	ztest_run_test_suite(test_bl_crypto_benchmark);
+}
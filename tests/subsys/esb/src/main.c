@@ -0,0 +1,712 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <nrf_esb.h>
+#include <nrf_esb_sim.h>
+
+#define SEQ_LEN 4
+#define PAYLOAD_LEN 16
+
+static u32_t tx_success;
+static u32_t tx_failed;
+static u32_t rx_received;
+static u32_t tx_attempts;
+static struct nrf_esb_payload rx_payload;
+
+/* Leave received payloads in the RX queue for the test to read. */
+static bool rx_hold;
+
+/* Last sequence number received on each pipe. */
+static u32_t rx_seq[CONFIG_NRF_ESB_PIPE_COUNT];
+static u32_t rx_out_of_order;
+
+static void event_handler(const struct nrf_esb_evt *event)
+{
+	tx_attempts = event->tx_attempts;
+
+	switch (event->evt_id) {
+	case NRF_ESB_EVENT_TX_SUCCESS:
+		tx_success++;
+		break;
+	case NRF_ESB_EVENT_TX_FAILED:
+		tx_failed++;
+		nrf_esb_flush_tx();
+		break;
+	case NRF_ESB_EVENT_RX_RECEIVED:
+		if (rx_hold) {
+			break;
+		}
+
+		while (nrf_esb_read_rx_payload(&rx_payload) == 0) {
+			u32_t seq;
+
+			rx_received++;
+
+			if (rx_payload.length < SEQ_LEN) {
+				continue;
+			}
+
+			memcpy(&seq, rx_payload.data, sizeof(seq));
+			if (seq <= rx_seq[rx_payload.pipe]) {
+				rx_out_of_order++;
+			}
+			rx_seq[rx_payload.pipe] = seq;
+		}
+		break;
+	}
+}
+
+static void esb_setup(enum nrf_esb_mode mode,
+		      const struct nrf_esb_sim_config *sim_config)
+{
+	struct nrf_esb_config config = NRF_ESB_DEFAULT_CONFIG;
+	int err;
+
+	tx_success = 0;
+	tx_failed = 0;
+	rx_received = 0;
+	tx_attempts = 0;
+	rx_out_of_order = 0;
+	rx_hold = false;
+	memset(rx_seq, 0, sizeof(rx_seq));
+
+	config.mode = mode;
+	config.event_handler = event_handler;
+
+	err = nrf_esb_init(&config);
+	zassert_equal(err, 0, "nrf_esb_init failed: %d", err);
+
+	nrf_esb_sim_configure(sim_config);
+}
+
+static void esb_teardown(void)
+{
+	if (!nrf_esb_is_idle()) {
+		nrf_esb_stop_rx();
+	}
+
+	/* Let the ongoing operation complete. */
+	nrf_esb_sim_run(10000);
+	nrf_esb_disable();
+}
+
+static void payload_write(u8_t pipe)
+{
+	struct nrf_esb_payload payload = {
+		.pipe = pipe,
+		.length = PAYLOAD_LEN,
+	};
+	int err;
+
+	err = nrf_esb_write_payload(&payload);
+	zassert_equal(err, 0, "nrf_esb_write_payload failed: %d", err);
+}
+
+static void test_ptx_ack(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+	};
+	struct nrf_esb_sim_stats stats;
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	payload_write(0);
+	nrf_esb_sim_run(5000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_equal(tx_success, 1, "Packet not acknowledged");
+	zassert_equal(tx_attempts, 1, "Unexpected attempts: %u", tx_attempts);
+	zassert_equal(stats.peer_rx_packets, 1, "Packet not received");
+	zassert_equal(rx_received, 0, "Unexpected acknowledgment payload");
+
+	esb_teardown();
+}
+
+static void test_ptx_loss(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.loss = 100,
+	};
+	struct nrf_esb_sim_stats stats;
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	payload_write(0);
+	nrf_esb_sim_run(20000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_equal(tx_failed, 1, "Packet did not fail");
+	zassert_equal(tx_attempts, 4, "Unexpected attempts: %u", tx_attempts);
+	zassert_equal(stats.tx_frames, 4, "Unexpected frames: %u",
+		      stats.tx_frames);
+	zassert_equal(stats.peer_rx_packets, 0, "Lost packet received");
+
+	esb_teardown();
+}
+
+static void test_ptx_ack_payload(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.ack_payload_length = 8,
+	};
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	payload_write(1);
+	nrf_esb_sim_run(5000);
+
+	zassert_equal(tx_success, 1, "Packet not acknowledged");
+	zassert_equal(rx_received, 1, "Acknowledgment payload not received");
+	zassert_equal(rx_payload.length, 8, "Unexpected length: %u",
+		      rx_payload.length);
+	zassert_equal(rx_payload.pipe, 1, "Unexpected pipe: %u",
+		      rx_payload.pipe);
+
+	esb_teardown();
+}
+
+static void test_prx_contention(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.peer_count = 3,
+		.peer_interval_us = 2000,
+		.peer_payload_length = PAYLOAD_LEN,
+		.peer_retransmit_count = 3,
+		.peer_retransmit_delay = 600,
+	};
+	struct nrf_esb_sim_stats stats;
+	int err;
+
+	esb_setup(NRF_ESB_MODE_PRX, &sim_config);
+
+	err = nrf_esb_start_rx();
+	zassert_equal(err, 0, "nrf_esb_start_rx failed: %d", err);
+
+	nrf_esb_sim_run(1000000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_true(stats.collisions > 0, "No contention");
+	zassert_true(stats.peer_tx_acked > 0, "No packet acknowledged");
+	zassert_equal(rx_out_of_order, 0, "Packets out of order");
+	zassert_true(rx_received >= stats.peer_tx_acked,
+		     "Acknowledged packets not received");
+	zassert_true(rx_received <= stats.peer_tx_packets,
+		     "Duplicate packets received");
+
+	esb_teardown();
+}
+
+static void test_ptx_stats(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.ack_payload_length = 8,
+	};
+	struct nrf_esb_pipe_stats stats;
+	int err;
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	payload_write(2);
+	payload_write(2);
+	nrf_esb_sim_run(5000);
+
+	err = nrf_esb_get_pipe_stats(2, &stats);
+	zassert_equal(err, 0, "nrf_esb_get_pipe_stats failed: %d", err);
+
+	zassert_equal(stats.tx_success, 2, "Unexpected TX success: %u",
+		      stats.tx_success);
+	zassert_equal(stats.tx_failed, 0, "Unexpected TX failure");
+	zassert_equal(stats.tx_attempts[0], 2, "Unexpected attempts: %u",
+		      stats.tx_attempts[0]);
+	zassert_equal(stats.rx_packets, 2, "Unexpected RX packets: %u",
+		      stats.rx_packets);
+	zassert_true(stats.rssi_avg > 0, "No RSSI average");
+
+	err = nrf_esb_get_pipe_stats(0, &stats);
+	zassert_equal(err, 0, "nrf_esb_get_pipe_stats failed: %d", err);
+	zassert_equal(stats.tx_success, 0, "Statistics on the wrong pipe");
+
+	nrf_esb_reset_stats();
+	nrf_esb_get_pipe_stats(2, &stats);
+	zassert_equal(stats.tx_success, 0, "Statistics not reset");
+
+	esb_teardown();
+}
+
+static void test_prx_stats(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 2,
+		.peer_count = 3,
+		.peer_interval_us = 2000,
+		.peer_payload_length = PAYLOAD_LEN,
+		.peer_retransmit_count = 3,
+		.peer_retransmit_delay = 600,
+	};
+	struct nrf_esb_pipe_stats stats;
+	u32_t rx_packets = 0;
+	u32_t rx_crc_errors = 0;
+
+	esb_setup(NRF_ESB_MODE_PRX, &sim_config);
+
+	nrf_esb_start_rx();
+	nrf_esb_sim_run(1000000);
+
+	for (u8_t pipe = 0; pipe < CONFIG_NRF_ESB_PIPE_COUNT; pipe++) {
+		nrf_esb_get_pipe_stats(pipe, &stats);
+		rx_packets += stats.rx_packets;
+		rx_crc_errors += stats.rx_crc_errors;
+	}
+
+	zassert_equal(rx_packets, rx_received, "Unexpected RX packets: %u",
+		      rx_packets);
+	zassert_true(rx_crc_errors > 0, "Collisions not counted");
+
+	esb_teardown();
+}
+
+#if CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT
+/* On a clean link, adaptive retransmission lowers the retransmit count, so
+ * that a packet fails after fewer attempts once the link breaks.
+ */
+static void test_ptx_adaptive(void)
+{
+	struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+	};
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	for (u32_t i = 0; i < 2 * CONFIG_NRF_ESB_ADAPTIVE_WINDOW; i++) {
+		payload_write(0);
+		nrf_esb_sim_run(2000);
+	}
+
+	zassert_equal(tx_success, 2 * CONFIG_NRF_ESB_ADAPTIVE_WINDOW,
+		      "Packets not acknowledged");
+
+	sim_config.loss = 100;
+	nrf_esb_sim_configure(&sim_config);
+
+	payload_write(0);
+	nrf_esb_sim_run(20000);
+
+	zassert_equal(tx_failed, 1, "Packet did not fail");
+	zassert_equal(tx_attempts,
+		      CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT_COUNT_MIN + 1,
+		      "Unexpected attempts: %u", tx_attempts);
+
+	esb_teardown();
+}
+#else
+static void test_ptx_adaptive(void)
+{
+	/* Covered by the configuration with adaptive retransmission. */
+}
+#endif /* CONFIG_NRF_ESB_ADAPTIVE_RETRANSMIT */
+
+#if CONFIG_NRF_ESB_HOPPING
+static const u8_t hop_channels[] = { 2, 12, 22, 32, 42, 52, 62, 72 };
+
+/* Loss of each RF channel, with interference on channels 20 to 40. */
+static u8_t channel_loss[101];
+
+static void congested_spectrum(void)
+{
+	memset(channel_loss, 0, sizeof(channel_loss));
+	memset(&channel_loss[20], 90, 21);
+}
+
+/* A hopping PTX keeps its packets going through on a congested spectrum, and
+ * blacklists the channels that are blocked.
+ */
+static void test_ptx_hopping(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.channel_loss = channel_loss,
+		.hop_channels = hop_channels,
+		.hop_channel_count = ARRAY_SIZE(hop_channels),
+	};
+	struct nrf_esb_sim_stats stats;
+	struct nrf_esb_hop_channel channel;
+	const u32_t packets = 500;
+	u32_t blacklisted = 0;
+	int err;
+
+	congested_spectrum();
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	err = nrf_esb_set_hop_channels(hop_channels, ARRAY_SIZE(hop_channels));
+	zassert_equal(err, 0, "nrf_esb_set_hop_channels failed: %d", err);
+
+	for (u32_t i = 0; i < packets; i++) {
+		payload_write(0);
+		nrf_esb_sim_run(2000);
+	}
+
+	nrf_esb_sim_run(20000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_true(tx_success >= (packets * 98) / 100,
+		     "Packets not acknowledged: %u of %u", packets - tx_success,
+		     packets);
+	zassert_true(stats.peer_rx_packets >= tx_success,
+		     "Acknowledged packets not received by the peer");
+
+	/* Blacklisted channels are tried again after a while, so not all
+	 * blocked channels need to be blacklisted at the end.
+	 */
+	for (u8_t i = 0; i < ARRAY_SIZE(hop_channels); i++) {
+		err = nrf_esb_get_hop_channel(i, &channel);
+		zassert_equal(err, 0, "nrf_esb_get_hop_channel failed: %d",
+			      err);
+
+		if (channel_loss[channel.rf_channel] > 0) {
+			blacklisted += channel.blacklisted;
+		} else {
+			zassert_false(channel.blacklisted,
+				      "Clear channel %u blacklisted",
+				      channel.rf_channel);
+		}
+	}
+
+	zassert_true(blacklisted > 0, "No blocked channel blacklisted");
+
+	printk("ESB hopping: %u of %u packets acknowledged, "
+	       "retransmissions %u per 1000 packets\n",
+	       tx_success, packets,
+	       ((stats.tx_frames - packets) * 1000) / packets);
+
+	esb_teardown();
+	nrf_esb_set_hop_channels(NULL, 0);
+}
+
+/* A hopping PRX stays in step with a hopping PTX on a congested spectrum. The
+ * simulated PTX does not blacklist channels, so it needs enough
+ * retransmissions to get past the blocked ones.
+ */
+static void test_prx_hopping(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.peer_count = 1,
+		.peer_interval_us = 2000,
+		.peer_payload_length = PAYLOAD_LEN,
+		.peer_retransmit_count = 7,
+		.peer_retransmit_delay = 600,
+		.channel_loss = channel_loss,
+		.hop_channels = hop_channels,
+		.hop_channel_count = ARRAY_SIZE(hop_channels),
+	};
+	struct nrf_esb_sim_stats stats;
+	int err;
+
+	congested_spectrum();
+	esb_setup(NRF_ESB_MODE_PRX, &sim_config);
+
+	err = nrf_esb_set_hop_channels(hop_channels, ARRAY_SIZE(hop_channels));
+	zassert_equal(err, 0, "nrf_esb_set_hop_channels failed: %d", err);
+
+	err = nrf_esb_start_rx();
+	zassert_equal(err, 0, "nrf_esb_start_rx failed: %d", err);
+
+	nrf_esb_sim_run(1000000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_true(stats.peer_tx_acked >= (stats.peer_tx_packets * 98) / 100,
+		     "Packets not acknowledged: %u of %u",
+		     stats.peer_tx_packets - stats.peer_tx_acked,
+		     stats.peer_tx_packets);
+	zassert_equal(rx_out_of_order, 0, "Packets out of order");
+	zassert_true(rx_received >= stats.peer_tx_acked,
+		     "Acknowledged packets not received");
+
+	esb_teardown();
+	nrf_esb_set_hop_channels(NULL, 0);
+}
+#else
+static void test_ptx_hopping(void)
+{
+	/* Covered by the configuration with channel hopping. */
+}
+
+static void test_prx_hopping(void)
+{
+	/* Covered by the configuration with channel hopping. */
+}
+#endif /* CONFIG_NRF_ESB_HOPPING */
+
+/* A batch write queues the payloads that fit and stops at the first one
+ * that cannot be queued.
+ */
+static void test_ptx_write_batch(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+	};
+	struct nrf_esb_payload payloads[CONFIG_NRF_ESB_TX_FIFO_SIZE + 2];
+	struct nrf_esb_sim_stats stats;
+	int ret;
+
+	memset(payloads, 0, sizeof(payloads));
+	for (size_t i = 0; i < ARRAY_SIZE(payloads); i++) {
+		payloads[i].length = PAYLOAD_LEN;
+	}
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	/* An invalid payload ends the batch. */
+	payloads[2].length = 0;
+	ret = nrf_esb_write_payloads(payloads, ARRAY_SIZE(payloads));
+	zassert_equal(ret, 2, "Unexpected payloads written: %d", ret);
+
+	ret = nrf_esb_write_payloads(&payloads[2], 1);
+	zassert_equal(ret, -EMSGSIZE, "Invalid payload written: %d", ret);
+	payloads[2].length = PAYLOAD_LEN;
+
+	nrf_esb_sim_run(5000);
+	zassert_equal(tx_success, 2, "Packets not acknowledged: %u",
+		      tx_success);
+
+	/* A full TX queue ends the batch. */
+	ret = nrf_esb_write_payloads(payloads, ARRAY_SIZE(payloads));
+	zassert_equal(ret, CONFIG_NRF_ESB_TX_FIFO_SIZE,
+		      "Unexpected payloads written: %d", ret);
+
+	ret = nrf_esb_write_payloads(payloads, ARRAY_SIZE(payloads));
+	zassert_equal(ret, -ENOMEM, "Payload written to a full queue: %d",
+		      ret);
+
+	nrf_esb_sim_run(20000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_equal(tx_success, CONFIG_NRF_ESB_TX_FIFO_SIZE + 2,
+		      "Packets not acknowledged: %u", tx_success);
+	zassert_equal(stats.peer_rx_packets, CONFIG_NRF_ESB_TX_FIFO_SIZE + 2,
+		      "Packets not received: %u", stats.peer_rx_packets);
+
+	esb_teardown();
+}
+
+/* A TX buffer is filled in place. Payloads cannot be written while it is
+ * reserved, and flushing the queue keeps the reservation.
+ */
+static void test_ptx_payload_alloc(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+	};
+	struct nrf_esb_payload payload = {
+		.length = PAYLOAD_LEN,
+	};
+	struct nrf_esb_payload_buf buf;
+	struct nrf_esb_payload_buf other;
+	struct nrf_esb_sim_stats stats;
+	int err;
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	err = nrf_esb_tx_payload_alloc(&buf);
+	zassert_equal(err, 0, "nrf_esb_tx_payload_alloc failed: %d", err);
+
+	err = nrf_esb_tx_payload_alloc(&other);
+	zassert_equal(err, -EBUSY, "Second buffer allocated: %d", err);
+
+	err = nrf_esb_write_payloads(&payload, 1);
+	zassert_equal(err, -EBUSY, "Payload written while reserved: %d", err);
+
+	err = nrf_esb_flush_tx();
+	zassert_equal(err, 0, "nrf_esb_flush_tx failed: %d", err);
+
+	memset(buf.data, 0xAA, PAYLOAD_LEN);
+	buf.length = PAYLOAD_LEN;
+	buf.pipe = 1;
+
+	err = nrf_esb_tx_payload_submit(&buf);
+	zassert_equal(err, 0, "nrf_esb_tx_payload_submit failed: %d", err);
+
+	err = nrf_esb_tx_payload_submit(&buf);
+	zassert_equal(err, -EINVAL, "Buffer submitted twice: %d", err);
+
+	err = nrf_esb_write_payloads(&payload, 1);
+	zassert_equal(err, 1, "Payload not written after submit: %d", err);
+
+	nrf_esb_sim_run(5000);
+	nrf_esb_sim_stats_get(&stats);
+
+	zassert_equal(tx_success, 2, "Packets not acknowledged: %u",
+		      tx_success);
+	zassert_equal(stats.peer_rx_packets, 2, "Packets not received: %u",
+		      stats.peer_rx_packets);
+
+	esb_teardown();
+}
+
+/* Queue acknowledgment payloads in the RX queue without reading them. */
+static void rx_fill(u32_t count)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.ack_payload_length = 8,
+	};
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+	rx_hold = true;
+
+	for (u32_t i = 0; i < count; i++) {
+		payload_write(i);
+	}
+
+	nrf_esb_sim_run(5000);
+	zassert_equal(tx_success, count, "Packets not acknowledged: %u",
+		      tx_success);
+}
+
+/* A batch read returns the payloads that are queued, in order. */
+static void test_ptx_read_batch(void)
+{
+	struct nrf_esb_payload payloads[3];
+	int ret;
+
+	rx_fill(3);
+
+	ret = nrf_esb_read_rx_payloads(payloads, 2);
+	zassert_equal(ret, 2, "Unexpected payloads read: %d", ret);
+	zassert_equal(payloads[0].pipe, 0, "Unexpected pipe: %u",
+		      payloads[0].pipe);
+	zassert_equal(payloads[1].pipe, 1, "Unexpected pipe: %u",
+		      payloads[1].pipe);
+
+	ret = nrf_esb_read_rx_payloads(payloads, ARRAY_SIZE(payloads));
+	zassert_equal(ret, 1, "Unexpected payloads read: %d", ret);
+	zassert_equal(payloads[0].pipe, 2, "Unexpected pipe: %u",
+		      payloads[0].pipe);
+	zassert_equal(payloads[0].length, 8, "Unexpected length: %u",
+		      payloads[0].length);
+
+	ret = nrf_esb_read_rx_payloads(payloads, ARRAY_SIZE(payloads));
+	zassert_equal(ret, -ENODATA, "Payload read from an empty queue: %d",
+		      ret);
+
+	esb_teardown();
+}
+
+/* Lent payloads block copying reads and are released in order. */
+static void test_ptx_rx_payload_get(void)
+{
+	struct nrf_esb_payload_buf buf[3];
+	struct nrf_esb_payload payload;
+	int err;
+
+	rx_fill(3);
+
+	for (size_t i = 0; i < 2; i++) {
+		err = nrf_esb_rx_payload_get(&buf[i]);
+		zassert_equal(err, 0, "nrf_esb_rx_payload_get failed: %d",
+			      err);
+		zassert_equal(buf[i].pipe, i, "Unexpected pipe: %u",
+			      buf[i].pipe);
+	}
+
+	err = nrf_esb_read_rx_payloads(&payload, 1);
+	zassert_equal(err, -EBUSY, "Payload read while lent: %d", err);
+
+	err = nrf_esb_rx_payload_release(&buf[1]);
+	zassert_equal(err, -EINVAL, "Payload released out of order: %d", err);
+
+	err = nrf_esb_rx_payload_release(&buf[0]);
+	zassert_equal(err, 0, "nrf_esb_rx_payload_release failed: %d", err);
+
+	err = nrf_esb_rx_payload_release(&buf[1]);
+	zassert_equal(err, 0, "nrf_esb_rx_payload_release failed: %d", err);
+
+	err = nrf_esb_rx_payload_get(&buf[2]);
+	zassert_equal(err, 0, "nrf_esb_rx_payload_get failed: %d", err);
+	zassert_equal(buf[2].pipe, 2, "Unexpected pipe: %u", buf[2].pipe);
+
+	err = nrf_esb_rx_payload_get(&buf[0]);
+	zassert_equal(err, -ENODATA, "Payload lent twice: %d", err);
+
+	/* Flushing the queue invalidates the lent payload. */
+	err = nrf_esb_flush_rx();
+	zassert_equal(err, 0, "nrf_esb_flush_rx failed: %d", err);
+
+	err = nrf_esb_rx_payload_release(&buf[2]);
+	zassert_equal(err, -EINVAL, "Flushed payload released: %d", err);
+
+	err = nrf_esb_read_rx_payloads(&payload, 1);
+	zassert_equal(err, -ENODATA, "Payload read after flush: %d", err);
+
+	esb_teardown();
+}
+
+/* Throughput of a PTX that keeps its TX FIFO full, on a lossy channel. */
+static void test_ptx_throughput(void)
+{
+	const struct nrf_esb_sim_config sim_config = {
+		.seed = 1,
+		.loss = 10,
+	};
+	const u32_t duration_us = 1000000;
+	const u32_t step_us = 1000;
+	struct nrf_esb_sim_stats stats;
+	u32_t packets;
+
+	esb_setup(NRF_ESB_MODE_PTX, &sim_config);
+
+	for (u32_t t = 0; t < duration_us; t += step_us) {
+		struct nrf_esb_payload payload = {
+			.length = CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH,
+		};
+
+		while (nrf_esb_write_payload(&payload) == 0) {
+		}
+
+		nrf_esb_sim_run(step_us);
+	}
+
+	nrf_esb_sim_stats_get(&stats);
+	packets = tx_success + tx_failed;
+
+	zassert_true(tx_success > 0, "No packet acknowledged");
+	zassert_true(stats.peer_rx_packets >= tx_success,
+		     "Acknowledged packets not received by the peer");
+
+	printk("ESB throughput: %u packets/s, %u bytes/s, "
+	       "retransmissions %u per 1000 packets\n",
+	       tx_success, tx_success * CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH,
+	       ((stats.tx_frames - packets) * 1000) / packets);
+
+	esb_teardown();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_esb,
+			 ztest_unit_test(test_ptx_ack),
+			 ztest_unit_test(test_ptx_loss),
+			 ztest_unit_test(test_ptx_ack_payload),
+			 ztest_unit_test(test_prx_contention),
+			 ztest_unit_test(test_ptx_stats),
+			 ztest_unit_test(test_prx_stats),
+			 ztest_unit_test(test_ptx_write_batch),
+			 ztest_unit_test(test_ptx_payload_alloc),
+			 ztest_unit_test(test_ptx_read_batch),
+			 ztest_unit_test(test_ptx_rx_payload_get),
+			 ztest_unit_test(test_ptx_adaptive),
+			 ztest_unit_test(test_ptx_hopping),
+			 ztest_unit_test(test_prx_hopping),
+			 ztest_unit_test(test_ptx_throughput));
+	ztest_run_test_suite(test_esb);
+}
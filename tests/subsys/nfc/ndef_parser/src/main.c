@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <misc/byteorder.h>
+#include <nfc/ndef/nfc_ndef_msg.h>
+#include <nfc/ndef/nfc_ndef_parser.h>
+#include <nfc/ndef/nfc_text_rec.h>
+#include <nfc/ndef/nfc_uri_rec.h>
+
+#define MSG_BUF_SIZE 512
+
+#define FUZZ_ITERATIONS 20000
+#define BENCHMARK_ITERATIONS 10000
+
+static const u8_t en_code[] = {'e', 'n'};
+static const u8_t text[] = {'H', 'e', 'l', 'l', 'o', '!'};
+static const u8_t uri[] = {'n', 'o', 'r', 'd', 'i', 'c', 's', 'e', 'm', 'i',
+			   '.', 'c', 'o', 'm'};
+static const u8_t bin_type[] = {'a', '/', 'b'};
+static const u8_t bin_id[] = {'i', 'd'};
+static u8_t bin_payload[300];
+
+static u8_t msg_buf[MSG_BUF_SIZE];
+static u32_t msg_len;
+
+/* Encode a message with a short Text record, a short URI record, and a long
+ * binary record with an ID.
+ */
+static void sample_msg_encode(void)
+{
+	int err;
+
+	NFC_NDEF_TEXT_RECORD_DESC_DEF(text_rec, UTF_8, en_code,
+				      sizeof(en_code), text, sizeof(text));
+	NFC_NDEF_URI_RECORD_DESC_DEF(uri_rec, NFC_URI_HTTP_WWW, uri,
+				     sizeof(uri));
+	NFC_NDEF_RECORD_BIN_DATA_DEF(bin_rec, TNF_MEDIA_TYPE,
+				     bin_id, sizeof(bin_id),
+				     bin_type, sizeof(bin_type),
+				     bin_payload, sizeof(bin_payload));
+	NFC_NDEF_MSG_DEF(msg, 3);
+
+	for (u32_t i = 0; i < sizeof(bin_payload); i++) {
+		bin_payload[i] = i;
+	}
+
+	err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(msg),
+				      &NFC_NDEF_TEXT_RECORD_DESC(text_rec));
+	zassert_equal(err, 0, "Cannot add Text record");
+	err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(msg),
+				      &NFC_NDEF_URI_RECORD_DESC(uri_rec));
+	zassert_equal(err, 0, "Cannot add URI record");
+	err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(msg),
+				      &NFC_NDEF_RECORD_BIN_DATA(bin_rec));
+	zassert_equal(err, 0, "Cannot add binary record");
+
+	msg_len = sizeof(msg_buf);
+	err = nfc_ndef_msg_encode(&NFC_NDEF_MSG(msg), msg_buf, &msg_len);
+	zassert_equal(err, 0, "Cannot encode message");
+}
+
+/* Copy a raw message to the message buffer, with the NLEN field in front if
+ * the parser expects one.
+ */
+static void raw_msg_set(const u8_t *raw, u32_t len)
+{
+	u32_t offset = 0;
+
+	if (IS_ENABLED(CONFIG_NFC_NDEF_MSG_WITH_NLEN)) {
+		sys_put_be16(len, msg_buf);
+		offset = NLEN_FIELD_SIZE;
+	}
+
+	memcpy(&msg_buf[offset], raw, len);
+	msg_len = offset + len;
+}
+
+static bool in_buffer(const u8_t *field, u32_t len)
+{
+	return (field >= msg_buf) && (field + len <= msg_buf + msg_len);
+}
+
+static void assert_record_in_buffer(struct nfc_ndef_parsed_record *record)
+{
+	zassert_true(in_buffer(record->type, record->type_length),
+		     "Type outside of message");
+	zassert_true(in_buffer(record->id, record->id_length),
+		     "ID outside of message");
+	zassert_true(in_buffer(record->payload, record->payload_length),
+		     "Payload outside of message");
+}
+
+static void test_parse_encoded(void)
+{
+	struct nfc_ndef_parser parser;
+	struct nfc_ndef_parsed_record record;
+	struct nfc_text_rec_payload_desc text_desc;
+	struct uri_payload_desc uri_desc;
+	int err;
+
+	sample_msg_encode();
+
+	err = nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+	zassert_equal(err, 0, "Cannot start parsing");
+
+	/* Text record */
+	err = nfc_ndef_parser_next(&parser, &record);
+	zassert_equal(err, 0, "Cannot parse Text record");
+	zassert_equal(record.location, NDEF_FIRST_RECORD, NULL);
+	zassert_false(record.chunked, NULL);
+	assert_record_in_buffer(&record);
+
+	err = nfc_text_rec_parse(&record, &text_desc);
+	zassert_equal(err, 0, "Cannot decode Text record");
+	zassert_equal(text_desc.utf, UTF_8, NULL);
+	zassert_equal(text_desc.lang_code_len, sizeof(en_code), NULL);
+	zassert_mem_equal(text_desc.lang_code, en_code, sizeof(en_code),
+			  NULL);
+	zassert_equal(text_desc.data_len, sizeof(text), NULL);
+	zassert_mem_equal(text_desc.data, text, sizeof(text), NULL);
+	zassert_equal(nfc_uri_rec_parse(&record, &uri_desc), -EINVAL,
+		      "Text record decoded as URI record");
+
+	/* URI record */
+	err = nfc_ndef_parser_next(&parser, &record);
+	zassert_equal(err, 0, "Cannot parse URI record");
+	zassert_equal(record.location, NDEF_MIDDLE_RECORD, NULL);
+	assert_record_in_buffer(&record);
+
+	err = nfc_uri_rec_parse(&record, &uri_desc);
+	zassert_equal(err, 0, "Cannot decode URI record");
+	zassert_equal(uri_desc.uri_id_code, NFC_URI_HTTP_WWW, NULL);
+	zassert_equal(uri_desc.uri_data_len, sizeof(uri), NULL);
+	zassert_mem_equal(uri_desc.uri_data, uri, sizeof(uri), NULL);
+
+	/* Binary record, long format with ID */
+	err = nfc_ndef_parser_next(&parser, &record);
+	zassert_equal(err, 0, "Cannot parse binary record");
+	zassert_equal(record.location, NDEF_LAST_RECORD, NULL);
+	zassert_true(nfc_ndef_parsed_record_type_match(&record,
+						       TNF_MEDIA_TYPE,
+						       bin_type,
+						       sizeof(bin_type)),
+		     "Wrong type");
+	zassert_equal(record.id_length, sizeof(bin_id), NULL);
+	zassert_mem_equal(record.id, bin_id, sizeof(bin_id), NULL);
+	zassert_equal(record.payload_length, sizeof(bin_payload), NULL);
+	zassert_mem_equal(record.payload, bin_payload, sizeof(bin_payload),
+			  NULL);
+	assert_record_in_buffer(&record);
+
+	err = nfc_ndef_parser_next(&parser, &record);
+	zassert_equal(err, -ENOENT, "Record after the last one");
+}
+
+static void test_parse_chunked(void)
+{
+	/* A media type payload in three chunks: "ab", "cd", and "e". */
+	static const u8_t chunked_msg[] = {
+		0xB2, 0x03, 0x02, 'a', '/', 'b', 'a', 'b',
+		0x36, 0x00, 0x02, 'c', 'd',
+		0x56, 0x00, 0x01, 'e',
+	};
+	static const u8_t expected[] = {'a', 'b', 'c', 'd', 'e'};
+	struct nfc_ndef_parser parser;
+	struct nfc_ndef_parsed_record record;
+	u32_t payload_len = 0;
+	u32_t chunks = 0;
+	int err;
+
+	raw_msg_set(chunked_msg, sizeof(chunked_msg));
+	err = nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+	zassert_equal(err, 0, "Cannot start parsing");
+
+	while ((err = nfc_ndef_parser_next(&parser, &record)) == 0) {
+		assert_record_in_buffer(&record);
+		zassert_true(payload_len + record.payload_length <=
+			     sizeof(expected), "Payload too long");
+		zassert_mem_equal(record.payload, &expected[payload_len],
+				  record.payload_length, NULL);
+		payload_len += record.payload_length;
+
+		if (chunks == 0) {
+			zassert_true(nfc_ndef_parsed_record_type_match(
+					&record, TNF_MEDIA_TYPE,
+					bin_type, sizeof(bin_type)),
+				     "Wrong type");
+		} else {
+			zassert_equal(record.tnf, TNF_UNCHANGED, NULL);
+		}
+		zassert_equal(record.chunked, chunks < 2, NULL);
+		chunks++;
+	}
+
+	zassert_equal(err, -ENOENT, "Chunked message not parsed");
+	zassert_equal(chunks, 3, NULL);
+	zassert_equal(payload_len, sizeof(expected), NULL);
+}
+
+static void assert_malformed(const u8_t *raw, u32_t len, const char *msg)
+{
+	struct nfc_ndef_parser parser;
+	struct nfc_ndef_parsed_record record;
+	int err;
+
+	raw_msg_set(raw, len);
+	err = nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+	zassert_equal(err, 0, "Cannot start parsing");
+
+	while ((err = nfc_ndef_parser_next(&parser, &record)) == 0) {
+		assert_record_in_buffer(&record);
+	}
+
+	zassert_equal(err, -EBADMSG, msg);
+	zassert_equal(nfc_ndef_parser_next(&parser, &record), -ENOENT,
+		      "Parsing continued after a malformed record");
+}
+
+static void test_parse_malformed(void)
+{
+	static const u8_t no_mb[] = {0x51, 0x01, 0x00, 'T'};
+	static const u8_t second_mb[] = {
+		0x91, 0x01, 0x00, 'T',
+		0xD1, 0x01, 0x00, 'T',
+	};
+	static const u8_t no_me[] = {0x91, 0x01, 0x00, 'T'};
+	static const u8_t unchanged[] = {0xD6, 0x00, 0x00};
+	static const u8_t chunk_with_type[] = {
+		0xB2, 0x01, 0x01, 'a', 'b',
+		0x56, 0x01, 0x01, 'a', 'c',
+	};
+	static const u8_t chunk_at_end[] = {0xF2, 0x01, 0x01, 'a', 'b'};
+	static const u8_t empty_with_payload[] = {0xD0, 0x00, 0x01, 'a'};
+	static const u8_t long_payload[] = {
+		0xC2, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 'a', 'b',
+	};
+	struct nfc_ndef_parsed_record record;
+	struct nfc_text_rec_payload_desc text_desc;
+	int err;
+
+	assert_malformed(no_mb, sizeof(no_mb), "Missing MB flag accepted");
+	assert_malformed(second_mb, sizeof(second_mb),
+			 "Second MB flag accepted");
+	assert_malformed(no_me, sizeof(no_me), "Missing ME flag accepted");
+	assert_malformed(unchanged, sizeof(unchanged),
+			 "Unchanged TNF outside of chunks accepted");
+	assert_malformed(chunk_with_type, sizeof(chunk_with_type),
+			 "Chunk with type accepted");
+	assert_malformed(chunk_at_end, sizeof(chunk_at_end),
+			 "Chunk with ME flag accepted");
+	assert_malformed(empty_with_payload, sizeof(empty_with_payload),
+			 "Empty record with payload accepted");
+	assert_malformed(long_payload, sizeof(long_payload),
+			 "Payload past the end accepted");
+
+	/* Every truncation of a valid message is detected. */
+	sample_msg_encode();
+	for (u32_t len = 0; len < msg_len; len++) {
+		struct nfc_ndef_parser parser;
+		u32_t full_len = msg_len;
+
+		if (IS_ENABLED(CONFIG_NFC_NDEF_MSG_WITH_NLEN) &&
+		    len >= NLEN_FIELD_SIZE) {
+			/* Keep NLEN consistent with the truncated length, so
+			 * that the records are checked.
+			 */
+			sys_put_be16(len - NLEN_FIELD_SIZE, msg_buf);
+		}
+
+		err = nfc_ndef_parser_init(&parser, msg_buf, len);
+		if (err == 0) {
+			msg_len = len;
+			while ((err = nfc_ndef_parser_next(&parser,
+							   &record)) == 0) {
+				assert_record_in_buffer(&record);
+			}
+			msg_len = full_len;
+		}
+		zassert_equal(err, -EBADMSG, "Truncation to %u accepted",
+			      len);
+	}
+
+	/* Text record with a language code longer than the payload. */
+	record.tnf = TNF_WELL_KNOWN;
+	record.type = nfc_text_rec_type_field;
+	record.type_length = NFC_TEXT_REC_TYPE_LENGTH;
+	record.chunked = false;
+	record.payload = (const u8_t *)"\x05""en";
+	record.payload_length = 3;
+	err = nfc_text_rec_parse(&record, &text_desc);
+	zassert_equal(err, -EBADMSG, "Language code past the payload");
+}
+
+/* Deterministic pseudo-random numbers, so that failures can be
+ * reproduced.
+ */
+static u32_t fuzz_state = 0x12345678;
+
+static u32_t fuzz_rand(void)
+{
+	fuzz_state ^= fuzz_state << 13;
+	fuzz_state ^= fuzz_state >> 17;
+	fuzz_state ^= fuzz_state << 5;
+
+	return fuzz_state;
+}
+
+static void test_parse_fuzz(void)
+{
+	static u8_t valid_msg[MSG_BUF_SIZE];
+	u32_t valid_len;
+	u32_t records = 0;
+
+	sample_msg_encode();
+	memcpy(valid_msg, msg_buf, msg_len);
+	valid_len = msg_len;
+
+	for (u32_t i = 0; i < FUZZ_ITERATIONS; i++) {
+		struct nfc_ndef_parser parser;
+		struct nfc_ndef_parsed_record record;
+		struct nfc_text_rec_payload_desc text_desc;
+		struct uri_payload_desc uri_desc;
+		u32_t mutations = 1 + fuzz_rand() % 4;
+		u32_t count = 0;
+		int err;
+
+		memcpy(msg_buf, valid_msg, valid_len);
+		msg_len = valid_len;
+
+		/* Flip bytes, mostly in the record headers, and sometimes
+		 * cut the message short.
+		 */
+		for (u32_t j = 0; j < mutations; j++) {
+			u32_t pos = fuzz_rand() % (fuzz_rand() % 2 ?
+						   32 : valid_len);
+
+			msg_buf[pos] ^= 1 << (fuzz_rand() % 8);
+		}
+		if (fuzz_rand() % 4 == 0) {
+			msg_len = fuzz_rand() % valid_len;
+		}
+
+		err = nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+		if (err) {
+			zassert_equal(err, -EBADMSG, NULL);
+			continue;
+		}
+
+		while ((err = nfc_ndef_parser_next(&parser, &record)) == 0) {
+			assert_record_in_buffer(&record);
+
+			if (nfc_text_rec_parse(&record, &text_desc) == 0) {
+				zassert_true(in_buffer(text_desc.lang_code,
+						text_desc.lang_code_len),
+					     NULL);
+				zassert_true(in_buffer(text_desc.data,
+						text_desc.data_len),
+					     NULL);
+			}
+			if (nfc_uri_rec_parse(&record, &uri_desc) == 0) {
+				zassert_true(in_buffer(uri_desc.uri_data,
+						uri_desc.uri_data_len),
+					     NULL);
+			}
+
+			/* Every record takes at least 3 bytes. */
+			count++;
+			zassert_true(count <= msg_len / 3, "Parser loops");
+		}
+		zassert_true(err == -ENOENT || err == -EBADMSG,
+			     "Unexpected error %d", err);
+		records += count;
+	}
+
+	printk("NDEF parser fuzz: %u messages, %u records parsed\n",
+	       FUZZ_ITERATIONS, records);
+}
+
+static void test_parse_benchmark(void)
+{
+	struct nfc_ndef_parser parser;
+	struct nfc_ndef_parsed_record record;
+	struct nfc_text_rec_payload_desc text_desc;
+	struct uri_payload_desc uri_desc;
+	u32_t records = 0;
+	u32_t start;
+	u32_t us;
+
+	sample_msg_encode();
+
+	start = k_cycle_get_32();
+	for (u32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		nfc_ndef_parser_init(&parser, msg_buf, msg_len);
+		while (nfc_ndef_parser_next(&parser, &record) == 0) {
+			(void)nfc_text_rec_parse(&record, &text_desc);
+			(void)nfc_uri_rec_parse(&record, &uri_desc);
+			records++;
+		}
+	}
+	us = (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(k_cycle_get_32() - start) /
+		     NSEC_PER_USEC);
+
+	zassert_equal(records, 3 * BENCHMARK_ITERATIONS, NULL);
+
+	printk("NDEF parser benchmark: %u messages of %u bytes in %u us",
+	       BENCHMARK_ITERATIONS, msg_len, us);
+	if (us > 0) {
+		printk(", %u records/s",
+		       (u32_t)((u64_t)records * USEC_PER_SEC / us));
+	}
+	printk("\n");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_nfc_ndef_parser,
+			 ztest_unit_test(test_parse_encoded),
+			 ztest_unit_test(test_parse_chunked),
+			 ztest_unit_test(test_parse_malformed),
+			 ztest_unit_test(test_parse_fuzz),
+			 ztest_unit_test(test_parse_benchmark));
+	ztest_run_test_suite(test_nfc_ndef_parser);
+}